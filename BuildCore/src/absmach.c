@@ -79,10 +79,15 @@
 #include "fileio.h"          /* for nprintf and related messages */
 #include "utils.h"           /* for cnvtup */
 #include "unixif.h"          /* for checksignal */
+#include "parse.h"           /* for parse tree tags used in compact_heap */
+#include "profile.h"         /* for profile_data_held */
 
 
 static nialptr reserve(nialint n);
 static void release(nialptr x);
+static void free_block(nialptr x);
+static void release_items(nialint base, nialint budget);
+static void freespace(nialint * total, nialint * maxx, nialint * cnt);
 static nialint hash(char *s);
 static void allocate_stack(void);
 static void reset_absmach(void);
@@ -92,10 +97,15 @@ static void setup_heap(void);
 static void remove_atom(nialptr x);
 static void rehash(nialint tblsize);
 static void allocate_Cbuffer(void);
+#ifdef SIZECLASSES
+static void link_free(nialptr bx);
+static void unlink_free(nialptr bx);
+static nialptr find_free_block(nialint n);
+#endif
 
-/*
-  static char * my_realloc(char *x,nialint newsize,nialint oldsize);
-*/
+#ifdef RESERVEDHEAP
+static char *my_realloc(char *x, nialint newsize, nialint oldsize);
+#endif
 
 static void allocate_atomtbl(void);
 
@@ -286,6 +296,184 @@ clear_abstract_machine()
 
 /*  Heap management routines.  */
 
+/* Allocator statistics reported by heapstats. The counters are updated
+   by reserve, release, new_create_array and expand_heap with a few
+   increments, so they are always kept. Blocks are counted by kind and by
+   size class, the classes being the block sizes from minsize to
+   SMALLBLOCKLIMIT with one class for all larger blocks. */
+
+#define NOSTATKINDS (faulttype + 1)
+#define NOSTATCLASSES (SMALLBLOCKLIMIT - minsize + 2)
+#define statclass(n) ((n) <= SMALLBLOCKLIMIT ? (n) - minsize : NOSTATCLASSES - 1)
+
+static struct {
+  nialint     allocs[NOSTATKINDS];  /* arrays created by kind */
+  nialint     frees[NOSTATKINDS];   /* arrays released by kind */
+  nialint     classallocs[NOSTATCLASSES];  /* blocks reserved by class */
+  nialint     classfrees[NOSTATCLASSES];   /* blocks released by class */
+  nialint     usedwords;     /* words in allocated blocks */
+  nialint     peakused;      /* largest value of usedwords */
+  nialint     peakmemsize;   /* largest heap size */
+  nialint     expansions;    /* number of heap expansions */
+  double      expansiontime; /* cpu time spent in expand_heap */
+  nialint     compactions;   /* number of heap compactions */
+} heapstats;
+
+#ifdef ATOMSLAB
+
+/* The atom slab is a stack of released blocks of size minsize, which is
+   the size of a block holding an atom. release pushes such a block and
+   reserve pops the most recent one, so scalars are created and freed
+   without searching or merging in the free space. A block in the slab
+   keeps the end marker of an allocated block so that its neighbours do
+   not merge with it, and has SLABTAG in place of its reference count.
+   The slab is emptied into the free space by settle_heap before the
+   heap is scanned block by block. */
+
+static nialptr atomslab[ATOMSLABSIZE];
+static nialint atomslabcnt = 0;
+
+#endif
+
+/* The items of an array of arrays are released with an explicit work
+   list rather than by recursion, so the depth of nesting is not limited
+   by the C stack. An entry on the list is an atype array whose reference
+   count has reached zero together with the index of its next item to be
+   released. The items are released in order and an item that is itself
+   a nonempty array of arrays is pushed and finished first, so the list
+   only grows with the depth of nesting.
+
+   When deferfree is set (by set "deferfree) freeit does at most
+   FREEBATCHSIZE items of work and leaves the rest on the list, so that
+   dropping a very large array does not hold up the action doing it. The
+   rest is done by heap_safepoint when the action is over. It cannot be
+   done at a later allocation since the C code running then may hold an
+   array popped from the stack without a reference count, and the array
+   may still be an item of one on the list. Until the list is finished the
+   items it holds keep their reference counts, which can only stop an
+   array being reused in place. */
+
+typedef struct {
+  nialptr     arr;           /* array whose items are being released */
+  nialint     next;          /* index of the next item to release */
+} freework;
+
+static freework *freeworklist = NULL;
+static nialint freeworksize = 0,
+            freeworkcnt = 0;
+
+
+#ifdef RESERVEDHEAP
+
+/* The heap is placed at the start of a large range of virtual address
+   space that is reserved with mmap but not made accessible. Pages are
+   committed by changing their protection as the heap grows, so an
+   expansion leaves mem where it is and the heap is neither copied nor
+   the C pointers into it reset. Pages only use physical memory once
+   they are touched.
+
+   If the reserved range cannot hold the expanded heap a larger range is
+   reserved and the heap is copied to it, as realloc would have done.
+
+   Once the heap is large, transparent huge pages are requested where
+   the system supports them to cut TLB misses in heap traversals.
+*/
+
+static char *heaparea = NULL;  /* start of the reserved range */
+static size_t heapreserved = 0; /* bytes reserved */
+static size_t heapcommitted = 0;  /* bytes made accessible */
+
+static      size_t
+pageround(size_t n)
+{
+  size_t      pg = (size_t) sysconf(_SC_PAGESIZE);
+
+  return ((n + pg - 1) / pg) * pg;
+}
+
+/* routine to reserve an address range that can hold at least nbytes.
+   The request is halved until the system grants it, so a limit on the
+   address space only reduces the room for growth. */
+
+static char *
+reserve_heap_area(size_t nbytes, size_t * reserved)
+{
+  size_t      want = HEAPRESERVESIZE;
+  int         flags = MAP_PRIVATE | MAP_ANON;
+  void       *p;
+
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  nbytes = pageround(nbytes);
+  if (want < 2 * nbytes)
+    want = 2 * nbytes;
+  while (true) {
+    if (want < nbytes)
+      want = nbytes;
+    p = mmap(NULL, want, PROT_NONE, flags, -1, 0);
+    if (p != MAP_FAILED) {
+      *reserved = want;
+      return (char *) p;
+    }
+    if (want == nbytes)
+      return NULL;
+    want = want / 2;
+  }
+}
+
+/* routine to make the first nbytes of the reserved range accessible */
+
+static int
+commit_heap_area(size_t nbytes)
+{
+  nbytes = pageround(nbytes);
+  if (nbytes > heapreserved)
+    return false;
+  if (nbytes > heapcommitted) {
+    if (mprotect(heaparea + heapcommitted, nbytes - heapcommitted,
+                 PROT_READ | PROT_WRITE) != 0)
+      return false;
+#ifdef MADV_HUGEPAGE
+    if (nbytes >= HUGEPAGEHEAPSIZE && heapcommitted < HUGEPAGEHEAPSIZE)
+      madvise(heaparea, heapreserved, MADV_HUGEPAGE);
+#endif
+    heapcommitted = nbytes;
+  }
+  return true;
+}
+
+/* routine to create or grow the heap area. It returns x unchanged
+   unless the reserved range is exhausted. Returns NULL on failure. */
+
+static char *
+my_realloc(char *x, nialint newsize, nialint oldsize)
+{
+  char       *oldarea = heaparea;
+  size_t      oldreserved = heapreserved,
+              oldcommitted = heapcommitted;
+
+  if (x != NULL && commit_heap_area((size_t) newsize))
+    return x;
+
+  heaparea = reserve_heap_area((size_t) newsize, &heapreserved);
+  heapcommitted = 0;
+  if (heaparea == NULL || !commit_heap_area((size_t) newsize)) {
+    if (heaparea != NULL)
+      munmap(heaparea, heapreserved);
+    heaparea = oldarea;      /* leave the old heap in place */
+    heapreserved = oldreserved;
+    heapcommitted = oldcommitted;
+    return NULL;
+  }
+  if (x != NULL) {
+    memcpy(heaparea, x, (size_t) oldsize);
+    munmap(oldarea, oldreserved);
+  }
+  return heaparea;
+}
+
+#endif /* RESERVEDHEAP */
 
 /* routine to allocate the heap as a contiguous block of nialptrs or words */
 
@@ -327,7 +515,17 @@ allocate_heap(nialint initialmemsize)
   {
 
     memsize = initialmemsize;
+#ifdef PTRS32
+    if (memsize > MAXHEAPWORDS) {
+      printf("requested heap is larger than 32 bit offsets can address");
+      longjmp(init_buf, NC_FATAL);
+    }
+#endif
+#ifdef RESERVEDHEAP
+    mem = (nialword *) my_realloc(NULL, memsize * sizeof(nialword), 0);
+#else
     mem = (nialword *) malloc(memsize * sizeof(nialword));
+#endif
     if (mem == NULL) {         /* malloc failed */
       printf("unable to allocate heap of requested size");
       /* exit using longjmp directly since the mem has not been allocated */
@@ -335,6 +533,7 @@ allocate_heap(nialint initialmemsize)
     }
   }
   setup_heap();
+  reset_heapstats();
 }
 
 /* routine to free the heap memory area */
@@ -349,7 +548,13 @@ deallocate_heap()
   else
 #endif
       
+#ifdef RESERVEDHEAP
+  munmap(heaparea, heapreserved);
+  heaparea = NULL;
+  heapreserved = heapcommitted = 0;
+#else
     free(mem);
+#endif
 }
 
 #ifdef OMITTED
@@ -444,6 +649,17 @@ setup_heap()
     
     /* set up the large block */
     membase += flhsize;
+#ifdef SIZECLASSES
+    /* the free list header and trailer block only reserve the space in
+       front of membase. The free blocks are held in the size classes. */
+    fwdlink(freelisthdr) = TERMINATOR;
+    bcklink(endblock) = freelisthdr;
+    fwdlink(endblock) = TERMINATOR;
+    clear_freelists();
+    blksize(membase) = memsize - membase;
+    link_free(membase);
+    free = membase;
+#else
     fwdlink(freelisthdr) = membase;
     blksize(membase) = memsize - membase;
     set_freetag(membase);
@@ -455,6 +671,7 @@ setup_heap()
     /* Link in trailer block */
     bcklink(endblock) = membase;
     fwdlink(endblock) = TERMINATOR;
+#endif
 }
 
 /* routine to expand the heap if required and allowed.
@@ -469,6 +686,8 @@ setup_heap()
 
    The expansion is done with a realloc with the hope that the current
    area can be extended in place without copying on some operating systems.
+   With RESERVEDHEAP it is done by committing more of the reserved address
+   range, which is always in place unless the reservation is exhausted.
    If the realloc fails then control jumps to top level with a warning.
    If expansions continue to be called, and a recovery routine is
    present then a limit is placed on the number of recoveries attempted
@@ -485,6 +704,7 @@ expand_heap(nialint n)
   static int  donottry = false; /* used to prevent the small expansion done
                                  * to permit recovery to be done repeatedly
                                  * if expansion not turned on. */
+  double      starttime = get_cputime();
 
   if (donottry) {
     exit_cover1("Out of memory. Cannot continue",NC_FATAL);
@@ -501,6 +721,14 @@ expand_heap(nialint n)
                                      * MINHEAPSPACE if more is needed */
       memincr = n + MINHEAPSPACE;
     memincr = ALIGNED_WORD_COUNT(memincr);   /* ensure even sized memarea */
+#ifdef PTRS32
+    /* stop at the words a 32 bit offset can address */
+    if (memsize + memincr > MAXHEAPWORDS) {
+      if (memsize + n + MINHEAPSPACE > MAXHEAPWORDS)
+        exit_cover1("Heap size limit of the 32 bit offset build reached", NC_WARNING);
+      memincr = (MAXHEAPWORDS - memsize) & ~1;
+    }
+#endif
     nprintf(OF_MESSAGE_LOG, "expanding heap to %d words\n", memsize + memincr);
   }
   mspace = (memsize + memincr) * (sizeof(nialword));
@@ -520,9 +748,13 @@ expand_heap(nialint n)
   blksize(newblk) = memincr;
 
   memsize = memsize + memincr;  /* adjust memsize */
-  release(arrayptr(newblk)); /* to link it into the chain, possibly merging
+  free_block(arrayptr(newblk)); /* to link it into the chain, possibly merging
                               * it with an existing free block at the top of
                               * mem */
+  heapstats.expansions++;
+  heapstats.expansiontime += get_cputime() - starttime;
+  if (memsize > heapstats.peakmemsize)
+    heapstats.peakmemsize = memsize;
 }
 
 /* routine to reset the explicit global C pointers into the heap area. */
@@ -539,6 +771,703 @@ reset_absmach(void)
 }
 
 
+#ifdef SIZECLASSES
+
+/* Free space management using size classes.
+
+   Free blocks of up to SMALLBLOCKLIMIT words are kept in exact size
+   class lists, one list per block size, so a request for an atom, a
+   pair or a short list is usually satisfied by taking the first block
+   of its own class. The lists are doubly linked through fwdlink and
+   bcklink. The first block in a class list has a negative bcklink that
+   encodes the class, so a block can be unlinked without a header block
+   for each class. The bit map smallclasses records which classes are
+   non-empty.
+
+   Larger free blocks are kept in a binary search tree ordered by size
+   and then by address, with fwdlink and bcklink used as the left and
+   right subtree links. The leftmost block of adequate size is the best
+   fit. The tree is kept as a treap using a hash of the block address as
+   the priority, so its expected depth stays logarithmic whatever the
+   order in which blocks are freed.
+
+   The block layout and the boundary tags are unchanged, so release
+   still merges a block with free neighbours found from either end.
+*/
+
+#define NOSIZECLASSES (SMALLBLOCKLIMIT - minsize + 1)
+#define classhead(c) (-(16 + (c)))  /* bcklink of the first block in a class */
+#define isclasshead(p) ((p) <= classhead(0))
+#define classof(p) (-(p) - 16)
+
+#define leftblk(bx) fwdlink(bx)
+#define rightblk(bx) bcklink(bx)
+#define blkprio(bx) ((unialint)(bx) * 2654435761u)
+#define blkless(x,y) (blksize(x) < blksize(y) || \
+                      (blksize(x) == blksize(y) && (x) < (y)))
+
+static nialptr sizeclass[NOSIZECLASSES];
+static unsigned long long smallclasses;
+static nialptr largeroot;
+static nialint freeblockcnt;  /* number of free blocks */
+
+/* routine to find the lowest set bit in a non-zero bit map */
+
+static int
+lowestbit(unsigned long long m)
+{
+#ifdef __GNUC__
+  return __builtin_ctzll(m);
+#else
+  int         i = 0;
+
+  while ((m & 1) == 0) {
+    m >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
+static      nialptr
+tree_insert(nialptr t, nialptr bx)
+{
+  if (t == TERMINATOR) {
+    leftblk(bx) = TERMINATOR;
+    rightblk(bx) = TERMINATOR;
+    return bx;
+  }
+  if (blkless(bx, t)) {
+    nialptr     l = tree_insert(leftblk(t), bx);
+
+    if (blkprio(l) > blkprio(t)) { /* rotate l up */
+      leftblk(t) = rightblk(l);
+      rightblk(l) = t;
+      return l;
+    }
+    leftblk(t) = l;
+  }
+  else {
+    nialptr     r = tree_insert(rightblk(t), bx);
+
+    if (blkprio(r) > blkprio(t)) { /* rotate r up */
+      rightblk(t) = leftblk(r);
+      leftblk(r) = t;
+      return r;
+    }
+    rightblk(t) = r;
+  }
+  return t;
+}
+
+/* joins two trees where all blocks in a precede those in b */
+
+static      nialptr
+tree_join(nialptr a, nialptr b)
+{
+  if (a == TERMINATOR)
+    return b;
+  if (b == TERMINATOR)
+    return a;
+  if (blkprio(a) > blkprio(b)) {
+    rightblk(a) = tree_join(rightblk(a), b);
+    return a;
+  }
+  leftblk(b) = tree_join(a, leftblk(b));
+  return b;
+}
+
+/* removes bx from the tree. blksize(bx) must not have been changed
+   since bx was inserted. */
+
+static      nialptr
+tree_remove(nialptr t, nialptr bx)
+{
+  if (t == bx)
+    return tree_join(leftblk(t), rightblk(t));
+  if (blkless(bx, t))
+    leftblk(t) = tree_remove(leftblk(t), bx);
+  else
+    rightblk(t) = tree_remove(rightblk(t), bx);
+  return t;
+}
+
+/* routine to empty the free space structures. Used when the heap is
+   set up and when a workspace is loaded. */
+
+void
+clear_freelists(void)
+{
+  int         c;
+
+  for (c = 0; c < NOSIZECLASSES; c++)
+    sizeclass[c] = TERMINATOR;
+  smallclasses = 0;
+  largeroot = TERMINATOR;
+  freeblockcnt = 0;
+#ifdef ATOMSLAB
+  atomslabcnt = 0;           /* the slab blocks are part of the old heap */
+#endif
+}
+
+/* routine to mark block bx as free and place it in its size class or
+   in the tree. blksize(bx) must already be set. */
+
+static void
+link_free(nialptr bx)
+{
+  nialint     n = blksize(bx);
+
+  set_freetag(bx);
+  set_endinfo(bx);
+  freeblockcnt++;
+  if (n <= SMALLBLOCKLIMIT) {
+    int         c = n - minsize;
+    nialptr     next = sizeclass[c];
+
+    fwdlink(bx) = next;
+    bcklink(bx) = classhead(c);
+    if (next != TERMINATOR)
+      bcklink(next) = bx;
+    sizeclass[c] = bx;
+    smallclasses |= (1ULL << c);
+  }
+  else
+    largeroot = tree_insert(largeroot, bx);
+}
+
+/* routine to remove free block bx from its size class or from the tree */
+
+static void
+unlink_free(nialptr bx)
+{
+  freeblockcnt--;
+  if (blksize(bx) <= SMALLBLOCKLIMIT) {
+    nialptr     prev = bcklink(bx),
+                next = fwdlink(bx);
+
+    if (isclasshead(prev)) {
+      int         c = classof(prev);
+
+      sizeclass[c] = next;
+      if (next == TERMINATOR)
+        smallclasses &= ~(1ULL << c);
+    }
+    else
+      fwdlink(prev) = next;
+    if (next != TERMINATOR)
+      bcklink(next) = prev;
+  }
+  else
+    largeroot = tree_remove(largeroot, bx);
+}
+
+/* routine used by wsload to enter a free area found between the
+   allocated blocks of a loaded workspace */
+
+void
+link_free_block(nialptr bx, nialint n)
+{
+  blksize(bx) = n;
+  link_free(bx);
+}
+
+/* routine to find a free block of at least n words. The search order
+   is: the exact class, a small class that can be split leaving a
+   valid block, the best fit in the tree, and finally a small class
+   that has to be allocated whole. Returns TERMINATOR if none exists. */
+
+static      nialptr
+find_free_block(nialint n)
+{
+  unsigned long long m;
+  nialptr     t,
+              best;
+
+  if (n <= SMALLBLOCKLIMIT) {
+    int         c = n - minsize;
+
+    if (smallclasses & (1ULL << c))
+      return sizeclass[c];
+    if (c + minsize < NOSIZECLASSES) {
+      m = smallclasses & (~0ULL << (c + minsize));
+      if (m)
+        return sizeclass[lowestbit(m)];
+    }
+  }
+
+  best = TERMINATOR;
+  t = largeroot;
+  while (t != TERMINATOR) {
+    if (blksize(t) >= n) {
+      best = t;
+      t = leftblk(t);
+    }
+    else
+      t = rightblk(t);
+  }
+  if (best != TERMINATOR || n > SMALLBLOCKLIMIT)
+    return best;
+
+  m = smallclasses & (~0ULL << (n - minsize));
+  return (m ? sizeclass[lowestbit(m)] : TERMINATOR);
+}
+
+static void
+tree_totals(nialptr t, nialint * total, nialint * maxx, nialint * cnt)
+{
+  while (t != TERMINATOR) {
+    *total += blksize(t);
+    if (blksize(t) > *maxx)
+      *maxx = blksize(t);
+    (*cnt)++;
+    tree_totals(leftblk(t), total, maxx, cnt);
+    t = rightblk(t);
+  }
+}
+
+/* routine to find the size of the largest free block */
+
+static      nialint
+largest_free(void)
+{
+  nialptr     t = largeroot;
+  int         c;
+
+  if (t != TERMINATOR) {
+    while (rightblk(t) != TERMINATOR)
+      t = rightblk(t);
+    return blksize(t);
+  }
+  if (smallclasses == 0)
+    return 0;
+  for (c = NOSIZECLASSES - 1; ((smallclasses >> c) & 1) == 0; c--);
+  return c + minsize;
+}
+
+#endif /* SIZECLASSES */
+
+/* routine to total the free space, finding the largest free block and
+   the number of free blocks. */
+
+static void
+freespace(nialint * total, nialint * maxx, nialint * cnt)
+{
+  nialptr     p;
+
+  *total = *maxx = *cnt = 0;
+#ifdef SIZECLASSES
+  {
+    int         c;
+
+    for (c = 0; c < NOSIZECLASSES; c++)
+      for (p = sizeclass[c]; p != TERMINATOR; p = fwdlink(p)) {
+        *total += blksize(p);
+        if (blksize(p) > *maxx)
+          *maxx = blksize(p);
+        (*cnt)++;
+      }
+    tree_totals(largeroot, total, maxx, cnt);
+  }
+#else
+  p = fwdlink(freelisthdr);
+  while (p != TERMINATOR) {
+    *total += blksize(p);
+    if (blksize(p) > *maxx)
+      *maxx = blksize(p);
+    p = fwdlink(p);
+    (*cnt)++;
+  }
+#endif
+}
+
+#if defined(DEBUG) && defined(SIZECLASSES)
+
+/* debugging routines used by chkfl and memchk in diag.c */
+
+static void
+chktree(nialptr t)
+{
+  while (t != TERMINATOR) {
+    if (freetag(t) != FREETAG || endptr(t) != -t || blksize(t) <= SMALLBLOCKLIMIT) {
+      nprintf(OF_DEBUG_LOG, "chkfl: block %d in free tree not tagged properly\n", t);
+      nabort(NC_ABORT);
+    }
+    chktree(leftblk(t));
+    t = rightblk(t);
+  }
+}
+
+void
+chkfreelists(void)
+{
+  int         c;
+  nialptr     p;
+
+  for (c = 0; c < NOSIZECLASSES; c++) {
+    if (((smallclasses >> c) & 1) != (sizeclass[c] != TERMINATOR)) {
+      nprintf(OF_DEBUG_LOG, "chkfl: size class map wrong for class %d\n", c);
+      nabort(NC_ABORT);
+    }
+    for (p = sizeclass[c]; p != TERMINATOR; p = fwdlink(p)) {
+      if (freetag(p) != FREETAG || endptr(p) != -p || blksize(p) != c + minsize) {
+        nprintf(OF_DEBUG_LOG, "chkfl: block %d in size class %d not tagged properly\n", p, c);
+        nabort(NC_ABORT);
+      }
+      if ((isclasshead(bcklink(p)) ? sizeclass[c] : fwdlink(bcklink(p))) != p) {
+        nprintf(OF_DEBUG_LOG, "chkfl: block %d in size class %d backward not linked properly\n", p, c);
+        nabort(NC_ABORT);
+      }
+    }
+  }
+  chktree(largeroot);
+}
+
+/* returns true if free block bx is held in the free space structures */
+
+int
+onfreelist(nialptr bx)
+{
+  nialptr     p;
+
+  if (blksize(bx) <= SMALLBLOCKLIMIT) {
+    for (p = sizeclass[blksize(bx) - minsize]; p != TERMINATOR; p = fwdlink(p))
+      if (p == bx)
+        return true;
+    return false;
+  }
+  p = largeroot;
+  while (p != TERMINATOR && p != bx)
+    p = (blkless(bx, p) ? leftblk(p) : rightblk(p));
+  return p == bx;
+}
+
+#endif
+
+#ifdef HEAPCOMPACTION
+
+/* Heap compaction.
+
+   compact_heap slides the allocated blocks towards the start of the
+   heap so that the free space is gathered into one block at the top,
+   and then gives back to the system the part of that block the heap
+   does not need. A moved block is copied down and every reference to
+   it is rewritten: the items of atype arrays, which include the stack
+   and the atom table, and the array references held in G and G1.
+   This is only correct where no other C variable holds an array, so
+   it is done at the top level through heap_safepoint.
+
+   A parse tree variable or identifier node holds the addresses of its
+   symbol table and entry as integers. The blocks named by such nodes
+   are pinned and stay where they are. Blocks keep their order, and a
+   run of moved blocks is moved back where needed so that each gap left
+   in front of a pinned block is empty or big enough to be a free block.
+
+   The positions are kept in tables in C memory, in heap order, and a
+   reference is mapped by a binary search of the old positions.
+*/
+
+static nialptr *cmpold = NULL;  /* block positions before compaction */
+static nialptr *cmpnew = NULL;  /* block positions after compaction */
+static char *cmppinned = NULL;  /* marks blocks that cannot move */
+static nialint cmpcnt = 0;      /* number of allocated blocks */
+
+static int  compactrequested = false;  /* set by icompact */
+static nialint checkedmemsize = 0;  /* memsize when the fragmentation was
+                                       last examined */
+
+/* routine to find the table index of the block holding array x.
+   Returns -1 if x is not an allocated array. */
+
+static      nialint
+cmpindex(nialptr x)
+{
+  nialptr     bx;
+  nialint     lo = 0,
+              hi = cmpcnt - 1;
+
+  if (x < arrayptr(membase) || x >= memsize)
+    return -1;
+  bx = blockptr(x);
+  while (lo <= hi) {
+    nialint     m = lo + (hi - lo) / 2;
+
+    if (cmpold[m] == bx)
+      return m;
+    if (cmpold[m] < bx)
+      lo = m + 1;
+    else
+      hi = m - 1;
+  }
+  return -1;
+}
+
+static void
+cmppin(nialptr x)
+{
+  nialint     i = cmpindex(x);
+
+  if (i >= 0)
+    cmppinned[i] = true;
+}
+
+/* routine to rewrite the n array references starting at p */
+
+static void
+relocate_refs(nialptr * p, nialint n)
+{
+  nialint     i,
+              k;
+
+  for (i = 0; i < n; i++)
+    if (p[i] > 0 && (k = cmpindex(p[i])) >= 0)
+      p[i] = arrayptr(cmpnew[k]);
+}
+
+/* routine to pin the blocks named by a parse tree node that holds
+   them as integers. See b_variable, b_expression and b_identifier. */
+
+static void
+pin_hidden_refs(nialptr x)
+{
+  if (valence(x) != 1)
+    return;
+  if (kind(x) == inttype && (tally(x) == 3 || tally(x) == 4)) {
+    if ((fetch_int(x, 0) == t_variable && tally(x) == 4) ||
+        (fetch_int(x, 0) == t_expression && tally(x) == 3)) {
+      cmppin((nialptr) fetch_int(x, 1));
+      cmppin((nialptr) fetch_int(x, 2));
+    }
+  }
+  else if (kind(x) == atype && tally(x) == 4) {
+    nialptr     tg = fetch_array(x, 0),
+                sym = fetch_array(x, 1),
+                entr = fetch_array(x, 2);
+
+    if (cmpindex(tg) >= 0 && cmpindex(sym) >= 0 && cmpindex(entr) >= 0 &&
+        isint(tg) && intval(tg) == t_identifier && isint(sym) && isint(entr)) {
+      cmppin((nialptr) intval(sym));
+      cmppin((nialptr) intval(entr));
+    }
+  }
+}
+
+/* routine to choose the new block positions. The gap in front of a
+   pinned block, or at the top of the heap, must be empty or at least
+   minsize words. If not, the blocks of the run before it are put back
+   in their old places, from the last one, until it is. The gaps between
+   blocks in their old places are free blocks, so this ends. */
+
+static      nialptr
+place_blocks(void)
+{
+  nialint     i,
+              j,
+              runstart = 0;
+  nialptr     f = membase,
+              runbase = membase,
+              stop;
+
+  for (i = 0; i <= cmpcnt; i++) {
+    if (i < cmpcnt && !cmppinned[i]) {
+      cmpnew[i] = f;
+      f += blksize(cmpold[i]);
+      continue;
+    }
+    stop = (i < cmpcnt ? cmpold[i] : memsize);
+    j = i;
+    while (stop - f > 0 && stop - f < minsize && j > runstart) {
+      j--;
+      cmpnew[j] = cmpold[j];
+      stop = cmpold[j];
+      f = (j > runstart ? cmpnew[j - 1] + blksize(cmpold[j - 1]) : runbase);
+    }
+    if (i < cmpcnt) {
+      cmpnew[i] = cmpold[i];
+      f = cmpold[i] + blksize(cmpold[i]);
+      runstart = i + 1;
+      runbase = f;
+    }
+    else if (j < i)          /* the top run was moved back */
+      f = cmpnew[i - 1] + blksize(cmpold[i - 1]);
+  }
+  return f;
+}
+
+/* routine to give back the heap beyond newsize words */
+
+static void
+shrink_heap(nialint newsize)
+{
+#ifdef RESERVEDHEAP
+  size_t      nbytes = pageround((size_t) newsize * sizeof(nialword));
+
+  if (nbytes < heapcommitted) {
+#ifdef MADV_DONTNEED
+    madvise(heaparea + nbytes, heapcommitted - nbytes, MADV_DONTNEED);
+#endif
+    mprotect(heaparea + nbytes, heapcommitted - nbytes, PROT_NONE);
+    heapcommitted = nbytes;
+  }
+#else
+  nialword   *newmem;
+
+  newmem = (nialword *) my_realloc((char *) mem, newsize * sizeof(nialword),
+                                   memsize * sizeof(nialword));
+  if (newmem != NULL)
+    mem = newmem;
+#endif
+  memsize = newsize;
+}
+
+/* routine to compact the heap. Only called from heap_safepoint. */
+
+static void
+compact_heap(void)
+{
+  nialptr     bx,
+              heaptop,
+              newsize;
+  nialint     i;
+
+#ifdef PROFILE
+  if (profile_data_held())   /* the profiler identifies entries by address */
+    return;
+#endif
+
+  settle_heap();
+
+  /* build the table of allocated blocks */
+  cmpcnt = 0;
+  for (bx = membase; bx < memsize; bx += blksize(bx))
+    if (allocated(bx))
+      cmpcnt++;
+  cmpold = (nialptr *) malloc((cmpcnt + 1) * sizeof(nialptr));
+  cmpnew = (nialptr *) malloc((cmpcnt + 1) * sizeof(nialptr));
+  cmppinned = (char *) calloc(cmpcnt + 1, 1);
+  if (cmpold == NULL || cmpnew == NULL || cmppinned == NULL)
+    goto cleanup;            /* not enough C memory, leave the heap alone */
+  i = 0;
+  for (bx = membase; bx < memsize; bx += blksize(bx))
+    if (allocated(bx))
+      cmpold[i++] = bx;
+
+  for (i = 0; i < cmpcnt; i++)
+    pin_hidden_refs(arrayptr(cmpold[i]));
+  heaptop = place_blocks();
+
+  /* rewrite the references while the blocks are in their old places */
+  for (i = 0; i < cmpcnt; i++) {
+    nialptr     x = arrayptr(cmpold[i]);
+
+    if (kind(x) == atype)
+      relocate_refs(pfirstitem(x), tally(x));
+  }
+  relocate_refs(intvals, NOINTS);
+  relocate_refs(charvals, HIGHCHAR - LOWCHAR + 1);
+  relocate_refs(bnames, NOBNAMES);
+  relocate_refs(&filenames, &memotable - &filenames + 1);
+  relocate_refs(&Zero, &global_symtab - &Zero + 1);
+  relocate_refs(&no_excode, &eachrightcode - &no_excode + 1);
+  relocate_refs(&atomtblbase, 1);
+  relocate_refs(&stkareabase, 1);
+  relocate_refs(&nonlocs, 1);
+  relocate_refs(&current_env, 1);
+
+  /* move the blocks down in heap order and rebuild the free space */
+  for (i = 0; i < cmpcnt; i++)
+    if (cmpnew[i] != cmpold[i])
+      memmove(&mem[cmpnew[i]], &mem[cmpold[i]], blksize(cmpold[i]) * sizeof(nialword));
+  clear_freelists();
+  bx = membase;
+  for (i = 0; i < cmpcnt; i++) {
+    if (cmpnew[i] > bx)
+      link_free_block(bx, cmpnew[i] - bx);
+    bx = cmpnew[i] + blksize(cmpnew[i]);
+  }
+
+  /* keep the headroom that expand_heap would add */
+  newsize = heaptop + (heaptop - membase) / 5;
+  if (newsize < heaptop + MINHEAPSPACE)
+    newsize = heaptop + MINHEAPSPACE;
+  if (newsize < initmemsize)
+    newsize = initmemsize;
+  newsize = ALIGNED_WORD_COUNT(newsize);
+  if (newsize < memsize)
+    shrink_heap(newsize);
+  if (memsize > heaptop)
+    link_free_block(heaptop, memsize - heaptop);
+  reset_absmach();
+  heapstats.compactions++;
+
+cleanup:
+  free(cmpold);
+  free(cmpnew);
+  free(cmppinned);
+  cmpold = cmpnew = NULL;
+  cmppinned = NULL;
+  cmpcnt = 0;
+}
+
+/* routine called at the points where no array is held in a C variable
+   other than the globals. It compacts the heap if that has been asked
+   for, or if the heap has been expanded and more than COMPACTFREEPERCENT
+   of it is free. The check is done once after each expansion. Any
+   releases deferred by freeit are finished first. */
+
+void
+heap_safepoint(void)
+{
+  int         due = compactrequested;
+
+  release_items(0, -1);      /* finish releases deferred by freeit */
+
+  if (!due && memsize > initmemsize && memsize != checkedmemsize) {
+    nialint     total,
+                maxx,
+                cnt;
+
+    freespace(&total, &maxx, &cnt);
+    due = total > memsize / 100 * COMPACTFREEPERCENT;
+  }
+  if (due)
+    compact_heap();
+  compactrequested = false;
+  checkedmemsize = memsize;
+}
+
+#endif /* HEAPCOMPACTION */
+
+/* routine to implement the expression compact. The heap cannot be
+   compacted while an expression is being evaluated, so the request is
+   noted and carried out when the current top level action is done. */
+
+void
+icompact(void)
+{
+#ifdef HEAPCOMPACTION
+  compactrequested = true;
+#endif
+  apush(Nullexpr);
+}
+
+/* routine to restart the statistics. It is used when the heap is set up
+   and when a workspace is loaded, and takes the words in use from the
+   free space. */
+
+void
+reset_heapstats(void)
+{
+  nialint     total,
+              maxx,
+              cnt;
+
+  memset(&heapstats, 0, sizeof heapstats);
+  freespace(&total, &maxx, &cnt);
+  heapstats.usedwords = heapstats.peakused = memsize - membase - total;
+  heapstats.peakmemsize = memsize;
+}
+
 /* routine to reserve n words of space in the heap.
    reserve allocates a block of appropriate size from the free list
    if possible.
@@ -552,6 +1481,9 @@ reset_absmach(void)
    space is placed back in the free list in the same place.
    Putting it there helps keep the free list with the largest free block
    near the end of the list which reduces fragmentation.
+
+   If SIZECLASSES is set the block is found by find_free_block instead
+   and the left over space is returned to the free space structures.
 */
 
 
@@ -559,8 +1491,10 @@ reset_absmach(void)
 static      nialptr
 reserve(nialint n)
 {
-  nialptr freeptr,
-    nextfree;
+  nialptr nextfree;
+#ifndef SIZECLASSES
+  nialptr freeptr;
+#endif
   nialint k;
     
   n = ALIGNED_WORD_COUNT(n); /* ensure request is of even size for alignment */
@@ -575,12 +1509,33 @@ reserve(nialint n)
     longjmp(error_env, NC_WARNING);
         
   }
+
+#ifdef ATOMSLAB
+  if (n <= minsize && atomslabcnt > 0) {
+    nextfree = atomslab[--atomslabcnt];
+    goto reserved;
+  }
+#endif
     
  retry:                       /* come back here after expanding heap */
 #ifdef DEBUG
   chkfl();                   /* debugging test to check that free list is OK */
 #endif
     
+#ifdef SIZECLASSES
+  nextfree = find_free_block(n);
+  if (nextfree == TERMINATOR) {
+    expand_heap(n);
+    checksignal(NC_CS_NORMAL);
+    goto retry;
+  }
+  unlink_free(nextfree);
+  k = blksize(nextfree) - n; /* size of unneeded part of nextfree block */
+  if (k >= minsize) {        /* return the remainder to the free space */
+    blksize(nextfree) = n;
+    link_free_block(nextfree + n, k);
+  }
+#else
   /* search the free list for the first block that fits */
   freeptr = freelisthdr;
   nextfree = fwdlink(freeptr);
@@ -630,6 +1585,7 @@ reserve(nialint n)
     set_endinfo(newnextfree);
     blksize(nextfree) = n;
   }
+#endif
    
 #ifdef DEBUG
   if (nextfree <= 0 || nextfree >= memsize) {
@@ -648,6 +1604,13 @@ reserve(nialint n)
      -----
   */
 #endif
+#ifdef ATOMSLAB
+reserved:
+#endif
+  heapstats.classallocs[statclass(blksize(nextfree))]++;
+  heapstats.usedwords += blksize(nextfree);
+  if (heapstats.usedwords > heapstats.peakused)
+    heapstats.peakused = heapstats.usedwords;
   reset_freetag(nextfree);   /* zeros the refcnt also */
   reset_endinfo(nextfree);   /* marks the block to be allocated */
 #ifdef DEBUG
@@ -705,13 +1668,47 @@ static nialint validate_block(nialptr x) {
 
 static void
 release(nialptr x)
+/* returns the array x to the free list, counting it in the statistics */
+{
+  nialint     n = blksize(blockptr(x));
+
+  heapstats.frees[(int) kind(x)]++;
+  heapstats.classfrees[statclass(n)]++;
+  heapstats.usedwords -= n;
+#ifdef ATOMSLAB
+  if (n == minsize && atomslabcnt < ATOMSLABSIZE) {
+    x = blockptr(x);
+    set_slabtag(x);
+    atomslab[atomslabcnt++] = x;
+    return;
+  }
+#endif
+  free_block(x);
+}
+
+/* routine to return the blocks held in the atom slab to the free space.
+   It is used by settle_heap and before the free space is reported. */
+
+void
+flush_atomslab(void)
+{
+#ifdef ATOMSLAB
+  while (atomslabcnt > 0)
+    free_block(arrayptr(atomslab[--atomslabcnt]));
+#endif
+}
+
+static void
+free_block(nialptr x)
 /* returns the block at x to the free list */
 {
   register nialptr p,
-    q,
-    next;
-  register nialint n,
-    sz;
+    q;
+  register nialint n;
+#ifndef SIZECLASSES
+  register nialptr next;
+  register nialint sz;
+#endif
 
   x = blockptr(x);
 
@@ -745,6 +1742,22 @@ release(nialptr x)
   n = blksize(x);
 #endif
 
+#ifdef SIZECLASSES
+  /* absorb free neighbours, taking them out of the free space first
+     since their sizes determine where they are held */
+  if (0 < (x+n) && (x+n) < memsize && isfree(x + n)) {
+    q = x + n;
+    unlink_free(q);
+    n += blksize(q);
+  }
+  if (0 < prevblk(x) && prevblk(x) < memsize && isprevfree(x)) {
+    p = prevblk(x);
+    unlink_free(p);
+    n += blksize(p);
+    x = p;
+  }
+  link_free_block(x, n);
+#else
   if (0 < (x+n) && (x+n) < memsize && isfree(x + n)) {
     /* the following block is free */
     q = x + n;
@@ -833,6 +1846,7 @@ release(nialptr x)
       set_freetag(x);
       set_endinfo(x);
     }
+#endif
 
 #ifdef DEBUG
   if (x == fwdlink(x) || x == bcklink(x)) {
@@ -878,6 +1892,96 @@ nialint set_delayed_release_flag(nialint flag) {
 #endif
       
 
+/* routine to release an array with no items left to release */
+
+static void
+free_array(nialptr x)
+{
+  int         k = kind(x);
+
+  if (k == phrasetype || k == faulttype) /* Adjust hash table address */
+    remove_atom(x);
+  release(x);
+}
+
+/* routine to place an array on the work list. It returns false if the
+   list cannot be made bigger. */
+
+static int
+push_freework(nialptr x)
+{
+  if (freeworkcnt == freeworksize) {
+    nialint     newsize = (freeworksize == 0 ? FREEWORKSIZE : 2 * freeworksize);
+    freework   *newlist = (freework *) realloc(freeworklist,
+                                               newsize * sizeof(freework));
+
+    if (newlist == NULL)
+      return false;
+    freeworklist = newlist;
+    freeworksize = newsize;
+  }
+  freeworklist[freeworkcnt].arr = x;
+  freeworklist[freeworkcnt].next = 0;
+  freeworkcnt++;
+  return true;
+}
+
+/* routine to do the work on the list above entry base, stopping after
+   budget items unless budget is negative. */
+
+static void
+release_items(nialint base, nialint budget)
+{
+  while (freeworkcnt > base && budget != 0) {
+    freework   *w = &freeworklist[freeworkcnt - 1];
+    nialptr     x = w->arr;
+    nialptr    *items = (nialptr *) pfirstitem(x); /* safe: no expansion done */
+    nialint     tlx = tally(x);
+    int         pushed = false;
+
+    while (w->next < tlx && budget != 0 && !pushed) {
+      nialptr     it = items[w->next++];
+
+      budget--;
+#ifdef DEBUG
+      if (it == 0) {
+        nprintf(OF_DEBUG, "invalid item of 0 in an atype, aborting\n");
+        nabort(NC_ABORT);
+      }
+#endif
+      if (it != invalidptr &&/* unused portions of atype arrays */
+          refcnt(it) > 0) {  /* it could possibly be 0 due to a release
+                              * abandoned by a jump to top level */
+        decrrefcnt(it);
+        if (refcnt(it) == 0) {
+          if (kind(it) != atype || tally(it) == 0)
+            free_array(it);
+          else if (push_freework(it))
+            pushed = true;   /* w is no longer valid */
+          else               /* no C memory for the list */
+            freeit(it);
+        }
+      }
+    }
+    if (!pushed && w->next >= tlx) {
+      freeworkcnt--;
+      release(x);
+    }
+  }
+}
+
+/* routine to finish any deferred releases and return the blocks in the
+   atom slab to the free space. It is used before the heap is scanned
+   block by block. */
+
+void
+settle_heap(void)
+{
+  release_items(0, -1);
+  flush_atomslab();
+}
+
+
 /* routine to used to test whether an array is free and if so release
    its space.
    freeit is called in two ways.
@@ -885,7 +1989,7 @@ nialint set_delayed_release_flag(nialint flag) {
    it is not set freeit must test the refcnt.
 
    For an array containing references to other arrays, their reference
-   counts are reduced and freeit called recursively. For phrases and faults
+   counts are reduced using the work list above. For phrases and faults
    the corresponding entry in the hash table is also removed. */
 
 
@@ -893,8 +1997,6 @@ void
 freeit(nialptr x)
 /* frees space used for an array representation */
 {
-  int         k;
-
   int rc;
   /* Check that we have a valid block to release */
   rc = validate_block(blockptr(x));
@@ -947,16 +2049,6 @@ freeit(nialptr x)
   }
 #endif
 
-  /* check for stack / heap clash */
-   
-  if (CSTACKFULL)  {
-    printf("C stack full in freeit\n)");
-        
-    longjmp(error_env, NC_WARNING);
-        
-  }
- 
-
 #ifndef FREEUPMACRO
   /* the refcnt test is already true if freeit has been called
      from the macro. */
@@ -964,38 +2056,41 @@ freeit(nialptr x)
     return;
 #endif
 
+  if (kind(x) != atype || tally(x) == 0)
+    free_array(x);
+  else {
+    nialint     base = freeworkcnt;
 
-  k = kind(x);
-  if (k == atype) {          /* items are arrays to be freed if possible */
-    nialptr     it;
-    nialptr    *topx = (nialptr*)pfirstitem(x); /* safe: no expansion done */
-    nialint     i,
-      tlx = tally(x);
+    if (push_freework(x))
+#ifdef HEAPCOMPACTION
+      release_items(base, (deferfree ? FREEBATCHSIZE : -1));
+#else
+      release_items(base, -1);  /* there is no heap_safepoint to finish it */
+#endif
+    else {                   /* no C memory for the list, use recursion */
+      nialptr    *items = (nialptr *) pfirstitem(x);
+      nialint     i,
+                  tlx = tally(x);
 
+      /* check for stack / heap clash */
+      if (CSTACKFULL) {
+        printf("C stack full in freeit\n)");
+
+        longjmp(error_env, NC_WARNING);
 
-    for (i = 0; i < tlx; i++) {
-      it = *topx++;
-#ifdef DEBUG
-      if (it == 0) {
-        nprintf(OF_DEBUG, "invalid item of 0 in an atype, aborting\n");
-        nabort(NC_ABORT);
       }
-#endif
-      if (it != invalidptr &&/* unused portions of atype arrays */
-          refcnt(it) > 0) {  /* it could possibly be 0 due to aborted freeit
-                              * done earlier. The abort can occur if freeit
-                              * is freeing a very deep array and the C stack
-                              * gets used up */
-        decrrefcnt(it);
-        if (refcnt(it) == 0)
-          freeit(it);
+      for (i = 0; i < tlx; i++) {
+        nialptr     it = items[i];
+
+        if (it != invalidptr && refcnt(it) > 0) {
+          decrrefcnt(it);
+          if (refcnt(it) == 0)
+            freeit(it);
+        }
       }
+      release(x);
     }
   }
-  else if (k == phrasetype || k == faulttype) /* Adjust hash table address */
-    remove_atom(x);
-
-  release(x);
 }
 
 
@@ -1009,6 +2104,7 @@ clearheap()
 {
   nialint     next;
 
+  settle_heap();             /* arrays on the work list have refcnt 0 */
   next = membase;
   do {
     if (CSTACKFULL)  {
@@ -1130,7 +2226,7 @@ new_create_array(int k, int v, nialint len, nialint *extents)
     /* compute number of words (nialptrs or nialints) in data part */
     switch (k) {
     case atype:
-      n = t * WParray;
+      n = t / ptrsPW + ((t % ptrsPW) == 0 ? 0 : 1);
       break;
     case booltype:
       n = t / boolsPW + ((t % boolsPW) == 0 ? 0 : 1);
@@ -1165,6 +2261,10 @@ new_create_array(int k, int v, nialint len, nialint *extents)
     m = hdrsize + n + v*WPint;
     if (v == 0)
       m += WParray;                   /* space for endtag nialptr if nonatomic single */
+#ifdef COMPACTHEADER
+    else if (v > 1)
+      m += WPint;                     /* space for the tally after the shape */
+#endif
     if (m < minsize)
       m = minsize;
   }
@@ -1176,7 +2276,8 @@ new_create_array(int k, int v, nialint len, nialint *extents)
   set_kind(z, k);
   set_valence(z, v);
   set_sorted(z, false);
-  tally(z) = tly;
+  set_tally(z, tly);
+  heapstats.allocs[k]++;
   /* the refcnt will have been set to zero by reserve when it resets the
    * freetag field */
   if (k == chartype)
@@ -1216,6 +2317,51 @@ new_create_array(int k, int v, nialint len, nialint *extents)
 }
 
 
+/* routine to create a list of kind k with tally n in a block that has space
+   for room further items. The spare space is the unused area U ahead of the
+   shape, so the list can later be extended in place by append or hitch. */
+
+nialptr
+new_create_list(int k, nialint n, nialint room)
+{
+  nialptr     z;
+  nialint     cap = n + room;
+
+  if (room < 0 || cap > LARGEINT)
+    cap = n;
+  z = new_create_array(k, 1, 0, &cap);
+  set_tally(z, n);
+  *shpptr(z, 1) = n;
+  if (k == chartype)
+    store_char(z, n, '\0');  /* move the terminating null */
+  return z;
+}
+
+/* routine to count the items that can be added to the list x in the unused
+   area of its block. Only lists of kinds with word or byte sized items are
+   extended this way, others report no room. */
+
+nialint
+listroom(nialptr x)
+{
+  nialint     t = tally(x),
+              avail;
+
+  avail = (char *) shpptr(x, 1) - (char *) pfirstint(x);
+  switch (kind(x)) {
+  case atype:
+    return (avail / (nialint) sizeof(nialptr) - t);
+  case inttype:
+    return (avail / (nialint) sizeof(nialint) - t);
+  case realtype:
+    return (avail / (nialint) sizeof(double) - t);
+  case chartype:
+    return (avail - t - 1);  /* keep the terminating null */
+  default:
+    return (0);
+  }
+}
+
 /* routines to create atoms of each type */
 
 nialptr
@@ -1223,8 +2369,8 @@ createint(nialint x)
 {
    
 
-  if (x >= 0 && x < NOINTS)
-    return (intvals[x]);
+  if (x >= LOWINT && x < LOWINT + NOINTS)
+    return (intvals[x - LOWINT]);
   else {
     nialint   dummy;       /* need empty extents list */
     nialptr     z = new_create_array(inttype, 0, 1, &dummy);
@@ -1248,12 +2394,7 @@ createbool(int x)
 nialptr
 createchar(char c)
 {
-  nialptr     z;
-  nialint   dummy;         /* needed for empty extents list */
-
-  z = new_create_array(chartype, 0, 1, &dummy);
-  store_char(z, 0, c);
-  return (z);
+  return (charvals[(unsigned char) c - LOWCHAR]);
 }
 
 nialptr
@@ -1886,24 +3027,16 @@ clearstack()
 void
 istatus(void)
 {
-  nialptr     p,
-    z;
+  nialptr     z;
   nialint     seven = 7,
     maxx,
     total,
     cnt;
 
-  /* scan the free list to compute space free, freelist size, and largest
+  /* scan the free space to compute space free, freelist size, and largest
    * available block */
-  p = fwdlink(freelisthdr);
-  maxx = total = cnt = 0;
-  while (p != TERMINATOR) {
-    total = total + blksize(p);
-    if (blksize(p) > maxx)
-      maxx = blksize(p);
-    p = fwdlink(p);
-    cnt++;
-  }
+  flush_atomslab();
+  freespace(&total, &maxx, &cnt);
 
   /* create the result container and fill */
   z = new_create_array(inttype, 1, 0, &seven);
@@ -1917,6 +3050,90 @@ istatus(void)
   apush(z);
 }
 
+/* routine to build an integer list from n counters */
+
+static      nialptr
+statlist(nialint * v, nialint n)
+{
+  nialptr     z = new_create_array(inttype, 1, 0, &n);
+  nialint     i;
+
+  for (i = 0; i < n; i++)
+    store_int(z, i, v[i]);
+  return (z);
+}
+
+/* routine to push a statistic as its name followed by its value */
+
+static void
+pushstat(char *name, nialptr val)
+{
+  apush(makephrase(name));
+  apush(val);
+}
+
+#define NOHEAPSTATS 15       /* number of rows in the heapstats result */
+
+/* routine to implement the expression heapstats. The result is a table
+   with a row for each statistic holding its name and its value. Counts by kind are for atype, booltype,
+   inttype, realtype, chartype, phrasetype and faulttype in that order.
+   Counts by size class are for block sizes from minsize to
+   SMALLBLOCKLIMIT followed by the count for larger blocks. Unlike status
+   it does not scan the free space when SIZECLASSES is set. */
+
+void
+iheapstats(void)
+{
+  static int  kinds[] = {atype, booltype, inttype, realtype, chartype,
+                         phrasetype, faulttype};
+  nialptr     x,
+              z;
+  nialint     shape[2] = {NOHEAPSTATS, 2},
+              nokinds = sizeof kinds / sizeof kinds[0],
+              allocs[sizeof kinds / sizeof kinds[0]],
+              frees[sizeof kinds / sizeof kinds[0]],
+              i,
+              maxx,
+              total,
+              cnt;
+
+  flush_atomslab();
+  for (i = 0; i < nokinds; i++) {
+    allocs[i] = heapstats.allocs[kinds[i]];
+    frees[i] = heapstats.frees[kinds[i]];
+  }
+#ifdef SIZECLASSES
+  total = memsize - membase - heapstats.usedwords;
+  maxx = largest_free();
+  cnt = freeblockcnt;
+#else
+  freespace(&total, &maxx, &cnt);
+#endif
+
+  pushstat("heapwords", createint(memsize));
+  pushstat("peakheapwords", createint(heapstats.peakmemsize));
+  pushstat("usedwords", createint(memsize - membase - total));
+  pushstat("peakusedwords", createint(heapstats.peakused));
+  pushstat("freewords", createint(total));
+  pushstat("freeblocks", createint(cnt));
+  pushstat("largestfree", createint(maxx));
+  /* the share of the free space outside the largest free block */
+  pushstat("fragmentation", createreal(total == 0 ? 0.0 : 1.0 - (double) maxx / total));
+  pushstat("expansions", createint(heapstats.expansions));
+  pushstat("expansiontime", createreal(heapstats.expansiontime));
+  pushstat("compactions", createint(heapstats.compactions));
+  pushstat("allocations", statlist(allocs, nokinds));
+  pushstat("releases", statlist(frees, nokinds));
+  pushstat("classallocations", statlist(heapstats.classallocs, NOSTATCLASSES));
+  pushstat("classreleases", statlist(heapstats.classfrees, NOSTATCLASSES));
+  mklist(2 * NOHEAPSTATS);
+  x = apop();
+  z = new_create_array(atype, 2, 0, shape);
+  copy(z, 0, x, 0, 2 * NOHEAPSTATS);
+  freeup(x);
+  apush(z);
+}
+
 /*--------routines to support filling of array containers------*/
 
 /* routine to copy a portion of an array to another of the same kind.
@@ -2578,26 +3795,15 @@ fetch_array(nialptr x, nialint i)
     nialint
       checkavailspace()
     {
-      nialptr     start,
-	p;
-      nialint     total;
+      nialint     total,
+	maxx,
+	cnt;
 
-#ifdef DEBUG
-      int         cnt = 1;
-
-#endif
-
-      start = freelisthdr;
-      p = fwdlink(start);
-      total = blksize(start);
+      freespace(&total, &maxx, &cnt);
 #ifdef DEBUG
       if (debug)
-	nprintf(OF_DEBUG, " in checkavailspace: freeblock fhl %d at %d has size %d\n", cnt, start, blksize(start));
+	nprintf(OF_DEBUG, " in checkavailspace: %d free blocks, largest has size %d\n", cnt, maxx);
 #endif
-      while (p != TERMINATOR) {
-	total = total + blksize(p);
-	p = fwdlink(p);
-      }
       if (total < MINHEAPSPACE) {
 
 	if (firsttry && expansion) {
@@ -2625,6 +3831,7 @@ fetch_array(nialptr x, nialint i)
       nialptr     start,
 	p;
       /*  printf("in checkfortemps\n"); */
+      settle_heap();
       start = freelisthdr;
       p = start + blksize(start);
       while (p < memsize) {
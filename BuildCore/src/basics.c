@@ -107,6 +107,7 @@ ishape,
 isolitary,
 itally,
 itell,
+icount,
 iisboolean,
 iisinteger,
 iisreal,
@@ -153,6 +154,7 @@ ieach,
 ieachleft,
 ieachright,
 igage,
+igradekeys,
 icutall,
 icut,
 iup,
@@ -161,6 +163,8 @@ ibykey,
 irecur,
 iacross,
 idown,
+imemo,
+ipeach,
 isetformat,
 iread,
 iexecute,
@@ -168,6 +172,7 @@ ierase,
 ieval,
 ifault,
 isetwidth,
+isetthreads,
 idisplay,
 ivalue,
 itoupper,
@@ -219,6 +224,9 @@ ifromraw,
 ifilestatus,
 irestart,
 istatus,
+icompact,
+iheapstats,
+imemostats,
 ibreak,
 icallstack,
 iwatchlist,
@@ -388,6 +396,7 @@ init_primname("SHAPE",'U');
 init_primname("SOLITARY",'U');
 init_primname("TALLY",'U');
 init_primname("TELL",'U');
+init_primname("COUNT",'U');
 init_primname("ISBOOLEAN",'U');
 init_primname("ISINTEGER",'U');
 init_primname("ISREAL",'U');
@@ -434,6 +443,7 @@ init_primname("EACH",'T');
 init_primname("EACHLEFT",'T');
 init_primname("EACHRIGHT",'T');
 init_primname("GAGE",'U');
+init_primname("GRADEKEYS",'U');
 init_primname("CUTALL",'B');
 init_primname("CUT",'B');
 init_primname("UP",'B');
@@ -442,6 +452,8 @@ init_primname("BYKEY",'T');
 init_primname("RECUR",'T');
 init_primname("ACROSS",'T');
 init_primname("DOWN",'T');
+init_primname("MEMO",'T');
+init_primname("PEACH",'T');
 init_primname("SETFORMAT",'U');
 init_primname("READ",'U');
 init_primname("EXECUTE",'U');
@@ -449,6 +461,7 @@ init_primname("ERASE",'U');
 init_primname("EVAL",'U');
 init_primname("FAULT",'U');
 init_primname("SETWIDTH",'U');
+init_primname("SETTHREADS",'U');
 init_primname("DISPLAY",'U');
 init_primname("VALUE",'U');
 init_primname("TOUPPER",'U');
@@ -500,6 +513,9 @@ init_primname("FROMRAW",'U');
 init_primname("FILESTATUS",'E');
 init_primname("RESTART",'E');
 init_primname("STATUS",'E');
+init_primname("COMPACT",'E');
+init_primname("HEAPSTATS",'E');
+init_primname("MEMOSTATS",'E');
 init_primname("BREAK",'E');
 init_primname("CALLSTACK",'E');
 init_primname("WATCHLIST",'E');
@@ -129,6 +129,7 @@ extern void ishape(void);
 extern void isolitary(void);
 extern void itally(void);
 extern void itell(void);
+extern void icount(void);
 extern void iisboolean(void);
 extern void iisinteger(void);
 extern void iisreal(void);
@@ -175,6 +176,7 @@ extern void ieach(void);
 extern void ieachleft(void);
 extern void ieachright(void);
 extern void igage(void);
+extern void igradekeys(void);
 extern void icutall(void);
 extern void b_cutall(void);
 extern void icut(void);
@@ -186,6 +188,8 @@ extern void ibykey(void);
 extern void irecur(void);
 extern void iacross(void);
 extern void idown(void);
+extern void imemo(void);
+extern void ipeach(void);
 extern void isetformat(void);
 extern void iread(void);
 extern void iexecute(void);
@@ -193,6 +197,7 @@ extern void ierase(void);
 extern void ieval(void);
 extern void ifault(void);
 extern void isetwidth(void);
+extern void isetthreads(void);
 extern void idisplay(void);
 extern void ivalue(void);
 extern void itoupper(void);
@@ -244,6 +249,9 @@ extern void ifromraw(void);
 extern void ifilestatus(void);
 extern void irestart(void);
 extern void istatus(void);
+extern void icompact(void);
+extern void iheapstats(void);
+extern void imemostats(void);
 extern void ibreak(void);
 extern void icallstack(void);
 extern void iwatchlist(void);
@@ -0,0 +1,17 @@
+/*==============================================================
+
+  BYKEY.H:  header for BYKEY.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+  This contains the prototype for BYKEY on lists grouped by a hash
+  table of the keys
+
+================================================================*/
+
+#ifndef _BYKEY_H_
+#define _BYKEY_H_
+
+extern nialptr bykey_groups(nialptr f, nialptr a, nialptr b);
+
+#endif
@@ -16,5 +16,12 @@ extern int equal(nialptr x, nialptr y);
 extern int up(nialptr x, nialptr y);
    /* used by atops.c, trs.c */
 
+extern nialint hasharray(nialptr x);
+   /* used by trs.c */
+
+extern void maxintscalarvector(nialint x, nialint * y, nialint * z, nialint n);
+extern void minintscalarvector(nialint x, nialint * y, nialint * z, nialint n);
+   /* used by outer.c */
+
 
 
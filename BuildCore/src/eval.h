@@ -26,6 +26,14 @@ extern void apply(nialptr fn);
 extern int  assign(nialptr varlist, nialptr val, int trsw, int valneeded);
 extern nialptr fetch_var(nialptr sym, nialptr entr);
 extern int  store_var(nialptr sym, nialptr entr, nialptr v);
+extern nialptr fetch_varnode(nialptr var);
+extern int  store_varnode(nialptr var, nialptr v);
+#ifdef TAILCALLS
+extern int  tailcall(nialptr op);
+#endif
+#ifdef FORRANGES
+extern nialptr forrange(nialptr exp, nialint * start);
+#endif
 extern void coerceop(void);
 extern int  b_closure(void);
 extern void clear_call_stack(void);
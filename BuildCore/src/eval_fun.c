@@ -75,15 +75,31 @@ recur:
       case t_variable:       /* A code tree denoting a variable that has an
                               * array value. Returns the variable value on
                               * stack. */
-          apush(fetch_var(get_sym(exp), get_entry(exp)));
+          apush(fetch_varnode(exp));
           break;
 
       case t_basic_binopcall:/* infix call of a basic binary operation */
           {
             nialptr     arg = Null,
-                        fn = get_op(exp);
+                        fn = get_op(exp),
+                        var = invalidptr;
             int         argflag = false;
 
+            /* note if the call is A append X or X hitch A on the right of
+               an assignment to A. The flag is taken before the arguments
+               are evaluated so that no inner call sees it */
+            if (exp == updateexp) {
+              if (fn == appendcode || fn == hitchcode)
+                var = updatevar;
+              updateexp = invalidptr;
+            }
+
+#if defined(FUSION) && !defined(EVAL_DEBUG)
+            /* a chain of arithmetic on arrays is done in one loop */
+            if (fused_eval(exp))
+              break;
+#endif
+
             /* evaluate the left and then the right argument on the stack */
 #ifdef EVAL_DEBUG
             d_eval(get_argexpr(exp));
@@ -103,7 +119,10 @@ recur:
             }
             /* apply the basic binary operation here to avoid expense
                of apply call */
+            if (var != invalidptr)
+              updatevalue = fetch_varnode(var);
             APPLYBINARYPRIM(fn);
+            updatevalue = invalidptr;
 #ifdef FP_EXCEPTION_FLAG
             fp_checksignal();
 #endif
@@ -119,7 +138,20 @@ recur:
              is curried it is necessary to evaluate the curried arg first to
              get expected semantics. */
           {
-            nialptr     op = get_op(exp);
+            nialptr     op = get_op(exp),
+                        var = invalidptr;
+
+            /* note an update such as A := (X I) place A on the right of an
+               assignment to A. The flag is taken before the arguments are
+               evaluated so that no inner call sees it */
+            if (exp == updateexp) {
+              nialptr     fn = tag(op) == t_curried ? get_op(op) : op;
+
+              if (fn == placecode || fn == placeallcode ||
+                  fn == appendcode || fn == hitchcode)
+                var = updatevar;
+              updateexp = invalidptr;
+            }
 
 #ifdef EVAL_DEBUG
 
@@ -137,12 +169,19 @@ recur:
 
             if (tag(op) == t_basic) { /* do the apply here to avoid expense
                                        of apply call */
+#if defined(FUSION) && !defined(EVAL_DEBUG)
+              if (fused_eval(exp))
+                break;
+#endif
 #ifdef EVAL_DEBUG
               d_eval(get_argexpr(exp)); /* evaluate the opcall argument */
 #else
               n_eval(get_argexpr(exp)); /* evaluate the opcall argument */
 #endif
+              if (var != invalidptr)
+                updatevalue = fetch_varnode(var);
               APPLYPRIMITIVE(op);
+              updatevalue = invalidptr;
 #ifdef FP_EXCEPTION_FLAG
               fp_checksignal();
 #endif
@@ -183,7 +222,13 @@ recur:
                 apush(top);  /* to protect the argument in weird cases. */
               rightval = apop();
               pair(leftval, rightval);
-              apply(get_op(op));  /* apply the op within the curried optn */
+              if (var != invalidptr)
+                updatevalue = fetch_varnode(var);
+#ifdef TAILCALLS
+              if (var != invalidptr || !is_tailcall(exp) || !tailcall(get_op(op)))
+#endif
+                apply(get_op(op));  /* apply the op within the curried optn */
+              updatevalue = invalidptr;
               if (rightflag) {
                 swap();
                 freeup(apop()); /* free right arg val if it is temporary */
@@ -199,7 +244,10 @@ recur:
 #else
               n_eval(get_argexpr(exp)); /* evaluate the opcall argument */
 #endif
-              apply(op);     /* apply the opcall optn */
+#ifdef TAILCALLS
+              if (!is_tailcall(exp) || !tailcall(op))
+#endif
+                apply(op);     /* apply the opcall optn */
             }
 #ifdef EVAL_DEBUG
             /* restore the onestep variable as we leave here if we saved it */
@@ -394,12 +442,20 @@ recur:
             nialptr     idlist;
 
             idlist = get_idlist(exp);
+            /* a primitive call on the right of a single variable assignment
+               may update the variable's value in place. Record the pair
+               so that the call can recognize itself */
+            if (tally(idlist) == 2) {
+              updateexp = get_expr(exp);
+              updatevar = fetch_array(idlist, 1);
+            }
             /* evaluate right hand side */
 #ifdef EVAL_DEBUG
             d_eval(get_expr(exp));  
 #else
             n_eval(get_expr(exp)); 
 #endif
+            updateexp = invalidptr;
             /* do the assignment and check for success */
             if (!assign(idlist, top, false, true)) {
               freeup(apop());
@@ -430,7 +486,7 @@ recur:
               buildfault(errmsg);
             }
             else {           /* lookup variable name in specified scope */
-              var_id = Blookup(get_root(fun_sym), varphrase);
+              var_id = symfind(fun_sym, varphrase);
 
               /* if it is found and a variable then continue */
               if (var_id != notfound) {
@@ -503,6 +559,10 @@ recur:
           break;
 
       case t_whileexpr:      /* While expression.  */
+#if defined(BYTECODE) && !defined(EVAL_DEBUG)
+          if (vm_ready && vm_eval(exp, exp))
+            break;           /* the loop was run as bytecode */
+#endif
           {
             nialptr     test,
                         tval,
@@ -607,6 +667,10 @@ recur:
           break;
 
       case t_repeatexpr:     /* Repeat expression */
+#if defined(BYTECODE) && !defined(EVAL_DEBUG)
+          if (vm_ready && vm_eval(exp, exp))
+            break;           /* the loop was run as bytecode */
+#endif
           {
             nialptr     test,
                         body,
@@ -705,6 +769,10 @@ recur:
           break;
 
       case t_forexpr:        /* For expression */
+#if defined(BYTECODE) && !defined(EVAL_DEBUG)
+          if (vm_ready && vm_eval(exp, exp))
+            break;           /* the loop was run as bytecode */
+#endif
           {
             nialptr     idlist,
                         body,
@@ -716,11 +784,33 @@ recur:
 
 #endif
             nialint     cnt,
-                        i;
+                        i,
+                        start = 0;
+            int         ranged = false; /* stepping through integers */
+#ifdef FORRANGES
+            nialptr     rangearg = forrange(get_expr(exp), &start);
+#endif
 
             nialexitflag = false;
             idlist = get_idlist(exp);
             body = get_fexprseq(exp);
+#ifdef FORRANGES
+            if (rangearg != invalidptr) {
+              /* eval the argument of tell or count */
+#ifdef EVAL_DEBUG
+              d_eval(rangearg);
+#else
+              n_eval(rangearg);
+#endif
+              if (isint(top) && intval(top) >= 0)
+                ranged = true;
+              else if (start == 0)
+                itell();
+              else
+                icount();
+            }
+            else
+#endif
             /* eval the with expression */
 #ifdef EVAL_DEBUG
             d_eval(get_expr(exp));  
@@ -728,7 +818,7 @@ recur:
             n_eval(get_expr(exp));  
 #endif
             ival = apop();
-            cnt = tally(ival);
+            cnt = (ranged ? intval(ival) : tally(ival));
             apush(Nullexpr);
 #ifdef EVAL_DEBUG
             d_inloop = true;
@@ -736,7 +826,8 @@ recur:
             for (i = 0; i < cnt; i++) {
               /* free last value and assign variable */
               freeup(apop());
-              assign(idlist, fetchasarray(ival, i), false, false);
+              assign(idlist, (ranged ? createint(start + i) : fetchasarray(ival, i)),
+                     false, false);
 #ifdef EVAL_DEBUG
               d_eval(body);
 #else
@@ -0,0 +1,22 @@
+/*==============================================================
+
+  FUSE.H:  header for FUSE.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+  This contains the prototypes for the fused evaluation of
+  chains of elementwise arithmetic
+
+================================================================*/
+
+#ifndef _FUSE_H_
+#define _FUSE_H_
+
+#ifdef FUSION
+
+extern int  fusable(nialptr exp);
+extern int  fused_eval(nialptr exp);
+
+#endif
+
+#endif
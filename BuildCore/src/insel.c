@@ -57,10 +57,11 @@
 
 static int  pick(nialptr a, nialptr addr);
 static int  reach(nialptr a, nialptr path);
-static int  place(nialptr a, nialptr addr, nialptr x, int *changed);
+static int  place(nialptr a, nialptr addr, nialptr x, int *changed, int owned);
 static int  deepplace(nialptr a, nialptr path, nialptr x, int *changed);
 static int  pathup(nialptr target, nialptr path, nialint i, nialint cnt, nialptr val, int *changed);
-static int  placeall(nialptr a, nialptr addrs, nialptr vals, int *changed);
+static int  placeall(nialptr a, nialptr addrs, nialptr vals, int *changed,
+                      int owned);
 static void splace(nialptr entr, nialptr sym, nialptr addr, nialptr x);
 static void sdeepplace(nialptr entr, nialptr sym, nialptr path, nialptr val);
 static void splaceall(nialptr entr, nialptr sym, nialptr addrs, nialptr vals);
@@ -525,7 +526,8 @@ iplace(void)
               a,
               addr,
               x;
-  int         changed = false;  /* needed as a dummy argument in place */
+  int         changed = false,  /* needed as a dummy argument in place */
+              owned;
 
   if (kind(top) == faulttype && top != Nullexpr &&
       top != Eoffault && top != Zenith && top != Nadir)
@@ -545,9 +547,11 @@ iplace(void)
     return;
   }
   splitfb(xaddr, &x, &addr);
-  if (!place(a, addr, x, &changed)) /* changed is not examined. The freeup of
-                                       z below will free a if it has changed
-                                       and z is temporary */
+  /* in A := (X I) place A the pair and A are the only holders of a */
+  owned = a == updatevalue && refcnt(a) == 2 && refcnt(z) == 0;
+  if (!place(a, addr, x, &changed, owned)) /* changed is not examined. The
+                                       freeup of z below will free a if it
+                                       has changed and z is temporary */
     apush(makefault("?address"));
   freeup(xaddr);             /* needed if xaddr is homogeneous */
   freeup(z);
@@ -558,7 +562,9 @@ iplace(void)
    is safe to directly replace a compatible item. This is safe
    because the array argument to place and placeall belonging to
    a variable will have refcnt 2, one because it is a variable
-   and another because of the pair.
+   and another because of the pair. The exception is an update such
+   as A := (X I) place A, where iplace sets owned since the result
+   replaces the variable's value, and a refcnt of 2 is also safe.
    Place returns the updated array as its result.
 
    An invalid address returns false so that the
@@ -587,7 +593,7 @@ iplace(void)
 */
 
 static int
-place(nialptr a, nialptr addr, nialptr x, int *changed)
+place(nialptr a, nialptr addr, nialptr x, int *changed, int owned)
 {
   nialint     index = -1,
               tlyaddr,
@@ -655,8 +661,9 @@ place(nialptr a, nialptr addr, nialptr x, int *changed)
         *changed = true;
       }
     }
-    if (!*changed && refcnt(a) > 1) { 
-      /* force a copy to unshare an array with 2 or more refcnts */
+    if (!*changed && refcnt(a) > (owned ? 2 : 1)) { 
+      /* force a copy to unshare an array with 2 or more refcnts, or 3 if
+         owned says the second is the variable being assigned the result */
       a = copy_array(a);
       *changed = true;
     }
@@ -828,7 +835,7 @@ pathup(nialptr target, nialptr path, nialint i, nialint cnt, nialptr val, int *c
                       them if temporary */
         /* insert the value returned by pathup into the target.
            It leave the updated result on the stack */
-        place(target, addr, newval, changed);
+        place(target, addr, newval, changed, false);
       }
       /* the cleanup of newtarget is done in the recursive call to pathup in
          case the path fails at this point */
@@ -859,7 +866,8 @@ iplaceall(void)
               a,
               x,
               addrs;
-  int         changed = false;  /* needed for dummy parameter to placeall */
+  int         changed = false,  /* needed for dummy parameter to placeall */
+              owned;
 
   if (kind(top) == faulttype && top != Nullexpr &&
       top != Eoffault && top != Zenith && top != Nadir)
@@ -886,7 +894,9 @@ iplaceall(void)
     reshape(createint(ta), x);
     x = apop();
   }
-  if (!placeall(a, addrs, x, &changed)) 
+  /* in A := (X I) placeall A the pair and A are the only holders of a */
+  owned = a == updatevalue && refcnt(a) == 2 && refcnt(z) == 0;
+  if (!placeall(a, addrs, x, &changed, owned)) 
          /* changed is not examined. The freeup of z below will 
             free a if it has changed and z is temporary */
     apush(makefault("?addresses"));
@@ -905,7 +915,7 @@ iplaceall(void)
    */
 
 static int
-placeall(nialptr a, nialptr addrs, nialptr vals, int *changed)
+placeall(nialptr a, nialptr addrs, nialptr vals, int *changed, int owned)
 {
   nialptr     v1 = 0,
               addr,
@@ -946,7 +956,7 @@ placeall(nialptr a, nialptr addrs, nialptr vals, int *changed)
     val = (v == 0 ? vals : fetchasarray(vals, i));
     a = apop();              /* target for next place */
     addr = fetchasarray(addrs, i);
-    validaddrs = place(a, addr, val, changed);
+    validaddrs = place(a, addr, val, changed, owned && !*changed);
     if (!validaddrs && *changed)
       freeup(a);       /* it may be temporary from an earlier call on place */
     i++;
@@ -1494,7 +1504,7 @@ splace(nialptr entr, nialptr sym, nialptr addr, nialptr x)
   else
     freeflag = false;
   /* place leaves value on stack if validaddr */
-  validaddr = place(a, addr, x, &changed);
+  validaddr = place(a, addr, x, &changed, false);
   if (!validaddr)
     buildfault("address");
   else if (changed)
@@ -1546,7 +1556,7 @@ splaceall(nialptr entr, nialptr sym, nialptr addrs, nialptr vals)
 
   a = fetch_var(sym, entr);
   /* placeall leaves value on stack if validaddrs */
-  validaddrs = placeall(a, addrs, vals, &changed);
+  validaddrs = placeall(a, addrs, vals, &changed, false);
   if (!validaddrs)
     buildfault("addresses");
   else if (changed)
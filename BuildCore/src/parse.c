@@ -90,6 +90,7 @@ static void finishcollection(void);
 static nialptr popexpr(void);
 static void parentop(void);
 static nialptr varinstall(nialptr id, int role, nialptr sym);
+static void setoffset(nialptr var, nialint offset);
 static void chopstack(void);
 static nialint  Xpp(void);
 static nialint  Xp_(void);
@@ -486,7 +487,7 @@ DEFN(nialptr * tree, int inblock)
     newvar = varinstall(get_id(var), oldrole, sym); /* put var in symbol tble sym */
     entr = get_entry(newvar);
     if (symprop(sym) != stpglobal) {
-      st_s_valu(entr, createint(localcnt)); /* offset in local area */
+      setoffset(newvar, localcnt); /* offset in local area */
       localcnt++;
     }
     replace_array(idlist, 1, newvar); /* update the idlist with the installed var */
@@ -2280,7 +2281,6 @@ OP_FORM(nialptr * tree)
 {
   nialptr     args,
               body,
-              entr,
               sym,
               id,
               s_env;
@@ -2321,8 +2321,7 @@ OP_FORM(nialptr * tree)
       var = fetchasarray(args, j);  /* select identifier */
       id = get_id(var);
       newvar = varinstall(id, Rvar, sym);
-      entr = get_entry(newvar);
-      st_s_valu(entr, createint(localcnt)); /* offset to the argument */
+      setoffset(newvar, localcnt); /* offset to the argument */
       localcnt++;
       replace_array(args, j, newvar);
     }
@@ -2403,7 +2402,6 @@ TR_FORM(nialptr * tree)
               newvar,
               id,
               args,
-              entr,
               body;
   int         res,
               nargs,
@@ -2434,8 +2432,7 @@ TR_FORM(nialptr * tree)
         var = fetchasarray(args, (nialint) (j + 1));  /* select identifier */
         id = get_id(var);
         newvar = varinstall(id, Roptn, sym);
-        entr = get_entry(newvar);
-        st_s_valu(entr, createint((nialint) (j)));
+        setoffset(newvar, (nialint) j);
         /* j  is the argument offset */
         replace_array(args, (nialint) (j + 1), newvar);
       }
@@ -2754,7 +2751,7 @@ BLOCKBODY(nialptr sym, nialptr args, nialptr * block)
     for (j = 1; j <= nlocs; j++) {
       id = get_id(fetch_array(locallist, j)); /* select identifier */
       newvar = varinstall(id, Rvar, sym);
-      st_s_valu(get_entry(newvar), createint(localcnt));  /* offset */
+      setoffset(newvar, localcnt);  /* offset */
       localcnt++;
       replace_array(locallist, j, newvar);
     }
@@ -3196,7 +3193,7 @@ ASSIGN_EXPR(nialptr * tree)
           /* assignment allowed, install the new variable */
           newvar = varinstall(id, Rvar, sym);
           if (symprop(sym) == stpclosed) {  /* record in local list */
-            st_s_valu(get_entry(newvar), createint(localcnt));
+            setoffset(newvar, localcnt);
             localcnt++;
           }
           replace_array(t1, (nialint) j, newvar);
@@ -3502,7 +3499,7 @@ FOR_EXPR(nialptr * tree)
     /* install the new variable */
     newvar = varinstall(id, Rvar, sym);
     if (symprop(sym) == stpclosed) {  /* record in local list */
-      st_s_valu(get_entry(newvar), createint(localcnt));
+      setoffset(newvar, localcnt);
       localcnt++;
     }
     replace_array(t1, 1, newvar);
@@ -4063,6 +4060,17 @@ varinstall(nialptr id, int role, nialptr sym)
   return (tree);
 }
 
+/* setoffset gives a local installed by varinstall its offset in the
+   activation record, both in its entry and in the variable node. Later
+   references built by ID get the offset from the entry. */
+
+static void
+setoffset(nialptr var, nialint offset)
+{
+  st_s_valu(get_entry(var), createint(offset));
+  store_int(var, 3, offset);
+}
+
 
 /*
     ROUTINE NAME  :   IX_VAR
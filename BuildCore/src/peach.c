@@ -0,0 +1,389 @@
+/*==============================================================
+
+  MODULE   PEACH.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+
+  The transformer PEACH, which applies an operation to the items of
+  an array in several processes.
+
+================================================================*/
+
+/* EACH f A with f defined in Nial cannot be run on threads, since the
+   interpreter's state, stack and heap are global. PEACH f A divides
+   the items of A into one contiguous part per worker and forks a child
+   process for each part. A child starts with a copy-on-write copy of
+   the whole workspace, so f, A and every definition and variable it
+   uses are already there and nothing is sent to it. It applies f to the
+   items of its part and writes the results to a pipe as blocks of
+   bytes in the format used for direct access files, then exits. The
+   parent reads the parts in order and stores the results as EACH does.
+
+   The processes are made for each use of PEACH rather than kept in a
+   pool, so that a worker always sees the current workspace. Forking
+   shares the pages of the heap and costs far less than sending the
+   argument. The number of workers is the number of threads set by
+   setthreads.
+
+   Anything f does besides computing its result, such as assigning a
+   global variable or writing a file, happens in the child and is lost
+   or unordered, so f should have no side effects. If a worker fails,
+   for example on an error or an interrupt, PEACH falls back to EACH in
+   the parent, which reports the error in the usual way.
+
+   Without the PROCESSEACH switch PEACH is EACH.
+*/
+
+#include "switches.h"
+
+/* standard library header files */
+
+/* IOLIB */
+#include <stdio.h>
+#include <errno.h>
+
+/* STLIB */
+#include <stdlib.h>
+#include <string.h>
+
+/* SJLIB */
+#include <setjmp.h>
+
+#ifdef PROCESSEACH
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+/* Q'Nial header files */
+
+#include "peach.h"
+#include "qniallim.h"
+#include "absmach.h"
+#include "basics.h"
+#include "lib_main.h"
+#include "if.h"
+
+#include "eval.h"            /* for do_apply */
+#include "blders.h"          /* for tag */
+#include "getters.h"         /* for get macros */
+#include "parse.h"           /* for parse tree node tags */
+
+
+#ifdef PROCESSEACH
+
+/* a buffered pipe end */
+
+typedef struct {
+  int         fd;
+  size_t      n,
+              pos;
+  char        buf[PEACHBUFSIZE];
+} pebuf;
+
+static int
+pe_flush(pebuf * b)
+{
+  size_t      done = 0;
+
+  while (done < b->n) {
+    ssize_t     w = write(b->fd, b->buf + done, b->n - done);
+
+    if (w < 0 && errno == EINTR)
+      continue;
+    if (w <= 0)
+      return false;
+    done += w;
+  }
+  b->n = 0;
+  return true;
+}
+
+static int
+pe_put(pebuf * b, void *p, size_t n)
+{
+  char       *s = p;
+
+  while (n > 0) {
+    size_t      m = PEACHBUFSIZE - b->n;
+
+    if (m == 0) {
+      if (!pe_flush(b))
+        return false;
+      continue;
+    }
+    if (m > n)
+      m = n;
+    memcpy(b->buf + b->n, s, m);
+    b->n += m;
+    s += m;
+    n -= m;
+  }
+  return true;
+}
+
+static int
+pe_get(pebuf * b, void *p, size_t n)
+{
+  char       *s = p;
+
+  while (n > 0) {
+    size_t      m = b->n - b->pos;
+
+    if (m == 0) {
+      ssize_t     r = read(b->fd, b->buf, PEACHBUFSIZE);
+
+      if (r < 0 && errno == EINTR)
+        continue;
+      if (r <= 0)
+        return false;
+      b->n = r;
+      b->pos = 0;
+      continue;
+    }
+    if (m > n)
+      m = n;
+    memcpy(s, b->buf + b->pos, m);
+    b->pos += m;
+    s += m;
+    n -= m;
+  }
+  return true;
+}
+
+/* routine to give the number of bytes of data of a homogeneous array or
+   of the text of a phrase or fault */
+
+static nialint
+pe_datasize(int k, nialint t)
+{
+  switch (k) {
+    case booltype:
+        return ((t / boolsPW + ((t % boolsPW) == 0 ? 0 : 1)) * sizeof(nialint));
+    case inttype:
+        return (t * sizeof(nialint));
+    case realtype:
+        return (t * sizeof(double));
+#ifdef COMPLEX
+    case cplxtype:
+        return (t * 2 * sizeof(double));
+#endif
+    default:                 /* chartype, phrasetype and faulttype */
+        return (t + 1);
+  }
+}
+
+/* routines to write and read an array. The layout is that of block_array
+   in fileio.c: the kind, valence, tally or text length, the shape, then
+   the data or the items. */
+
+static int
+pe_putarray(pebuf * b, nialptr x)
+{
+  int         k = kind(x);
+  nialint     v = valence(x),
+              t = (k == phrasetype || k == faulttype ? (nialint) strlen(pfirstchar(x)) : tally(x)),
+              i;
+
+  if (!pe_put(b, &k, sizeof(int)) || !pe_put(b, &v, sizeof(nialint)) ||
+      !pe_put(b, &t, sizeof(nialint)))
+    return false;
+  if (v > 0 && !pe_put(b, shpptr(x, v), v * sizeof(nialint)))
+    return false;
+  if (k != atype)
+    return (pe_put(b, pfirstchar(x), pe_datasize(k, t)));
+  for (i = 0; i < t; i++)
+    if (!pe_putarray(b, fetch_array(x, i)))
+      return false;
+  return true;
+}
+
+static int
+pe_getarray(pebuf * b, nialptr * z)
+{
+  int         k;
+  nialint     v,
+              t,
+              i;
+  nialptr     x,
+              sh;
+
+  if (!pe_get(b, &k, sizeof(int)) || !pe_get(b, &v, sizeof(nialint)) ||
+      !pe_get(b, &t, sizeof(nialint)) || v < 0 || t < 0)
+    return false;
+  sh = new_create_array(inttype, 1, 0, &v);
+  if (v > 0 && !pe_get(b, pfirstint(sh), v * sizeof(nialint))) {
+    freeup(sh);
+    return false;
+  }
+  if (k == phrasetype || k == faulttype) {
+    char       *s = malloc(t + 1);
+    int         ok = (s != NULL && pe_get(b, s, t + 1));
+
+    if (ok)
+      *z = (k == phrasetype ? makephrase(s) : makefault(s));
+    free(s);
+    freeup(sh);
+    return ok;
+  }
+  x = new_create_array(k, (int) v, 0, pfirstint(sh));
+  freeup(sh);
+  if (k != atype) {
+    if (!pe_get(b, pfirstchar(x), pe_datasize(k, t))) {
+      freeup(x);
+      return false;
+    }
+  }
+  else
+    for (i = 0; i < t; i++) {
+      nialptr     it;
+
+      if (!pe_getarray(b, &it)) {
+        freeup(x);
+        return false;
+      }
+      store_array(x, i, it);
+    }
+  *z = x;
+  return true;
+}
+
+/* routine run in a child to apply f to the items lo to hi-1 of x and
+   write the results to fd. It does not return. */
+
+static void
+pe_child(nialptr f, nialptr x, nialint lo, nialint hi, int fd)
+{
+  static pebuf b;
+  nialint     i;
+
+  if (setjmp(error_env) != 0) {
+    fflush(NULL);
+    _exit(1);
+  }
+  b.fd = fd;
+  b.n = 0;
+  for (i = lo; i < hi; i++) {
+    nialptr     res;
+
+    apush(fetchasarray(x, i));
+    do_apply(f);
+    res = apop();
+    if (!pe_putarray(&b, res))
+      _exit(1);
+    freeup(res);
+  }
+  fflush(NULL);
+  _exit(pe_flush(&b) ? 0 : 1);
+}
+
+/* routine to do PEACH in worker processes. It pushes the result and
+   returns true, or returns false with nothing done if the work could
+   not be divided or a worker failed. */
+
+static int
+peach(nialptr f, nialptr x)
+{
+  static pebuf b;
+  pid_t       pids[PARMAXTHREADS];
+  int         fds[PARMAXTHREADS],
+              nw = parthreads,
+              w,
+              ok = true;
+  nialint     tx = tally(x),
+              chunk,
+              i;
+  int         v = valence(x);
+  nialptr     z;
+
+  if (v == 0 || tx < 2 || nw < 2 || debugging_on)
+    return false;
+  if (nw > tx)
+    nw = (int) tx;
+  chunk = (tx + nw - 1) / nw;
+  nw = (int) ((tx + chunk - 1) / chunk);
+
+  fflush(NULL);              /* so that a child does not repeat output */
+  for (w = 0; w < nw; w++) {
+    int         p[2];
+
+    if (pipe(p) < 0)
+      break;
+    pids[w] = fork();
+    if (pids[w] == 0) {
+      close(p[0]);
+      pe_child(f, x, w * chunk, (w + 1) * chunk < tx ? (w + 1) * chunk : tx, p[1]);
+    }
+    close(p[1]);
+    if (pids[w] < 0) {
+      close(p[0]);
+      break;
+    }
+    fds[w] = p[0];
+  }
+  if (w < nw) {              /* not all workers started */
+    nw = w;
+    ok = false;
+  }
+
+  /* gather the results in order */
+  z = new_create_array(atype, v, 0, shpptr(x, v));
+  for (w = 0; w < nw; w++) {
+    b.fd = fds[w];
+    b.n = b.pos = 0;
+    for (i = w * chunk; ok && i < (w + 1) * chunk && i < tx; i++) {
+      nialptr     res;
+
+      if (pe_getarray(&b, &res)) {
+        store_array(z, i, res);
+      }
+      else
+        ok = false;
+    }
+    close(fds[w]);
+  }
+  for (w = 0; w < nw; w++) {
+    int         status;
+
+    while (waitpid(pids[w], &status, 0) < 0 && errno == EINTR);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      ok = false;
+  }
+  if (!ok) {
+    freeup(z);
+#ifdef USER_BREAK_FLAG
+    checksignal(NC_CS_NORMAL);
+#endif
+    return false;
+  }
+  if (homotest(z)) {         /* result can be made homogeneous */
+    incrrefcnt(x);
+    z = implode(z);
+    decrrefcnt(x);
+  }
+  apush(z);
+  freeup(x);
+  return true;
+}
+
+#endif /* PROCESSEACH */
+
+
+/* routine to implement the transformer PEACH. The arguments are pushed
+   as for EACH, which is used when the work is not divided. */
+
+void
+ipeach()
+{
+#ifdef PROCESSEACH
+  nialptr     f = apop(),
+              x = apop();
+
+  if (peach(f, x))
+    return;
+  apush(x);
+  apush(f);
+#endif
+  ieach();
+}
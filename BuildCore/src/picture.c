@@ -884,7 +884,7 @@ ipaste()
 
   /* pick up and check vertical pad */
   ta = fetchasarray(x, 0);
-  if (kind(ta) != inttype || valence(ta) != 0 || intval(x) < 0) {
+  if (kind(ta) != inttype || valence(ta) != 0 || intval(ta) < 0) {
     buildfault("vertical pad for paste must be integer");
     freeup(ta);
     goto cleanup;
@@ -894,7 +894,7 @@ ipaste()
 
 /* pick up and check horizontal pad */
   ta = fetchasarray(x, 1);
-  if (kind(ta) != inttype || valence(ta) != 0 || intval(x) < 0) {
+  if (kind(ta) != inttype || valence(ta) != 0 || intval(ta) < 0) {
     buildfault("horizontal pad for paste must be integer");
     freeup(ta);
     goto cleanup;
@@ -904,7 +904,7 @@ ipaste()
 
 /* pick up and check vertical lines */
   ta = fetchasarray(x, 2);
-  if (kind(ta) != inttype || valence(ta) != 0 || intval(x) < 0) {
+  if (kind(ta) != inttype || valence(ta) != 0 || intval(ta) < 0) {
     buildfault("vertical lines flag for paste must be integer");
     freeup(ta);
     goto cleanup;
@@ -914,7 +914,7 @@ ipaste()
 
 /* pick up and check horizontal lines */
   ta = fetchasarray(x, 3);
-  if (kind(ta) != inttype || valence(ta) != 0 || intval(x) < 0) {
+  if (kind(ta) != inttype || valence(ta) != 0 || intval(ta) < 0) {
     buildfault("horizontal lines flag for paste must be integer");
     freeup(ta);
     goto cleanup;
@@ -211,6 +211,9 @@ static nialptr tree_to_array(struct node *);
 static void
 build_symbol_table()
 {                      /* initialize the symtab array */
+  nialptr     tbl;
+  nialint     i;
+
   if (!symtab) {
     symtab = (symentry **)
     malloc(SYMLISTSIZE * sizeof(symentry *));
@@ -219,8 +222,11 @@ build_symbol_table()
     }
     symtabsize = 0;
     symspace = SYMLISTSIZE;
-    /* call the recursive routine to sweep the Nial symbol table */
-    profilelookup(global_symtab, get_root(global_symtab), 0);
+    /* call the recursive routine on each entry of the hash table of
+       the global symbol table */
+    tbl = get_hashtbl(global_symtab);
+    for (i = 0; i < tally(tbl); i++)
+      profilelookup(global_symtab, fetch_array(tbl, i), 0);
   }
 }
 
@@ -1137,4 +1143,13 @@ clear_profiler()
   }
 }
 
+/* routine used by the heap compaction, which must not move the entries
+   that the profiler identifies by address */
+
+int
+profile_data_held(void)
+{
+  return !newprofile;
+}
+
 #endif             /* PROFILE ) */
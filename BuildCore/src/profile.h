@@ -29,3 +29,4 @@
 extern void profile_ops_start(nialptr entr);
 extern void profile_ops_stop(nialptr entr);
 extern void clear_profiler(void);
+extern int profile_data_held(void);
@@ -0,0 +1,18 @@
+/*==============================================================
+
+  RADIXSORT.H:  header for RADIXSORT.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+  This contains the prototypes for radix sorting of homogeneous
+  arrays and parallel merge sorting for SORT and GRADE
+
+================================================================*/
+
+#ifndef _RADIXSORT_H_
+#define _RADIXSORT_H_
+
+extern nialptr radixsort(nialptr x, int descending, int gradesw);
+extern nialptr mergesort_up(nialptr x, int gradesw);
+
+#endif
@@ -44,6 +44,10 @@
 #define get_sp(sym)    fetch_array(sym,1)
 #define symprop(sym)   intval(fetch_array(sym,2))
 #define set_symtabname(sym,name)   replace_array(sym,3,name)
+#define get_hashtbl(sym) fetch_array(sym,4)
+#define get_hashcnt(sym) intval(fetch_array(sym,5))
+#define store_hashtbl(sym,t) replace_array(sym,4,t)
+#define store_hashcnt(sym,n) replace_array(sym,5,createint(n))
 #define replace_symprop(sym,prop)  replace_array(sym,2,createint(prop))
 
 #define notfound       (nialptr)(-2)  /* Used in 'blookup'. */
@@ -81,4 +85,6 @@ extern nialptr mkSymtabEntry(nialptr sym, nialptr name, nialptr role,
 extern nialptr lookup(nialptr name, nialptr * sym, int searchtype);
    /* called in eval.c lib_main.c mainlp.c parse.c symtab.c */
 extern nialptr Blookup(nialptr entr, nialptr name);
+   /* called in symtab.c */
+extern nialptr symfind(nialptr sym, nialptr name);
    /* called in eval.c eval_fun.c scan.c symtab.c */
@@ -113,6 +113,22 @@ iset(void)
       keeplog = false;
     }
   }
+  else if (equalsymbol(name, "DEFERFREE")) {
+    msg = (deferfree ? "deferfree" : "nodeferfree");
+    deferfree = true;
+  }
+  else if (equalsymbol(name, "NODEFERFREE")) {
+    msg = (deferfree ? "deferfree" : "nodeferfree");
+    deferfree = false;
+  }
+  else if (equalsymbol(name, "BYTECODE")) {
+    msg = (bytecode ? "bytecode" : "nobytecode");
+    bytecode = true;
+  }
+  else if (equalsymbol(name, "NOBYTECODE")) {
+    msg = (bytecode ? "bytecode" : "nobytecode");
+    bytecode = false;
+  }
 #ifdef DEBUG
   else if (equalsymbol(name, "DEBUG")) {
     msg = (debug ? "debug" : "nodebug");
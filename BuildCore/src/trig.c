@@ -44,15 +44,29 @@
 #include "lib_main.h"
 
 #include "trs.h"             /* for int_each */
+#include "utils.h"           /* for int_to_real */
 
 
 
+/* routine to convert an array of integers to reals, so that the
+   primitives below apply the C function to its items in one loop rather
+   than one item at a time. The results are the same. */
+
+static nialptr
+realarg(nialptr x)
+{
+  if (kind(x) == inttype && !atomic(x) && tally(x) > 0)
+    return (int_to_real(x));
+  return (x);
+}
+
+
 /* routine to implement pervasive operation sin */
 
 void
 isin()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -98,7 +112,7 @@ joinreal: r = sin(r);
 void
 icos()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -145,7 +159,7 @@ joinreal: r = cos(r);
 void
 isinh()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -190,7 +204,7 @@ joinreal: r = sinh(r);
 void
 icosh()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
 
@@ -236,7 +250,7 @@ joinreal: r = cosh(r);
 void
 iarcsin()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -297,7 +311,7 @@ use_each:
 void
 iarccos()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -359,7 +373,7 @@ use_each:
 void
 iarctan()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -405,7 +419,7 @@ joinreal: r = atan(r);
 void
 iexp()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -449,7 +463,7 @@ joinreal:r = exp(r);
 void
 iln()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -509,7 +523,7 @@ use_each:
 void
 ilog()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
@@ -572,7 +586,7 @@ use_each:
 void
 isqrt()
 {
-  nialptr     x = apop();
+  nialptr     x = realarg(apop());
   double      r;
 
   if (atomic(x)) {
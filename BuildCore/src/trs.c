@@ -43,13 +43,18 @@
 #include "eval.h"            /* for apply */
 #include "faults.h"          /* for Logical */
 #include "ops.h"             /* for simple up etc. */
-#include "compare.h"         /* for up */
+#include "compare.h"         /* for up, hasharray */
 #include "blders.h"          /* for getters and builders */
 #include "getters.h"         /* for getters */
 #include "parse.h"           /* for parse tree node tags */
 #include "arith.h"           /* for prodints */
 #include "insel.h"           /* for choose */
 #include "profile.h"         /* for profile switch */
+#include "parallel.h"        /* for par_for */
+#include "accum.h"           /* for accumulate_scan */
+#include "outer.h"           /* for outer_table */
+#include "bykey.h"           /* for bykey_groups */
+#include "radixsort.h"       /* for radixsort, mergesort_up */
 #include "nialconsts.h"	     /* for INTS32 or INTS64 switch */
 
 
@@ -285,17 +290,35 @@ int_each(void (*f) (void), nialptr x)
 
 /* routine to implement the EACH transformer when f is the C function
    that maps a double to a double. It is used in the scientific primitives
-   called in trig.c .
+   called in trig.c . Large arrays are done on several threads.
 */
 
+struct realeach {
+  double      (*f) (double);
+  double     *xptr,
+             *zptr;
+};
+
+static int
+real_each_part(nialint lo, nialint hi, void *arg)
+{
+  struct realeach *r = arg;
+  double      (*f) (double) = r->f;
+  double     *xptr = r->xptr,
+             *zptr = r->zptr;
+  nialint     i;
+
+  for (i = lo; i < hi; i++)
+    zptr[i] = (*f) (xptr[i]);
+  return true;
+}
+
 void
 real_each(double (*f) (double), nialptr x)
 {
   nialptr     z;
-  nialint     i,
-              tx = tally(x);
-  double     *xptr,
-             *zptr;
+  nialint     tx = tally(x);
+  struct realeach r;
   int         v = valence(x);
   int         usex = refcnt(x) == 0;
 
@@ -306,10 +329,10 @@ real_each(double (*f) (double), nialptr x)
     z = new_create_array(realtype, v, 0, shpptr(x, v));
 
   /* set up pointers and loop over the items applying f */
-  xptr = pfirstreal(x);      /* safe */
-  zptr = pfirstreal(z);      /* safe */
-  for (i = 0; i < tx; i++)
-    *zptr++ = (*f) (*xptr++);
+  r.f = f;
+  r.xptr = pfirstreal(x);    /* safe */
+  r.zptr = pfirstreal(z);    /* safe */
+  par_for(tx, real_each_part, &r);
 
   apush(z);
   if (!usex)
@@ -344,7 +367,7 @@ ieachleft()
   }
 
   else { /* arg is a pair, split it into x and y */
-    int         prop = get_prop(f);
+    int         prop = (tag(f) == t_basic ? get_prop(f) : 0);
 
     splitfb(z, &x, &y);
 
@@ -414,7 +437,7 @@ ieachright()
 
   else { /* arg is a pair, split it into x and y */
 
-    int         prop = get_prop(f);
+    int         prop = (tag(f) == t_basic ? get_prop(f) : 0);
 
     splitfb(z, &x, &y);
     if (!atomic(x)) {
@@ -454,7 +477,8 @@ ieachright()
 /* routine to implement the primitive OUTER using the identity
        OUTER f A = EACH f cart A
    It optimizes the case where f is a basic operation and A
-   has two items.
+   has two items. For the binary pervasive primitives on two
+   arrays of numbers the table is computed by outer_table.
 */
 
 void
@@ -523,6 +547,20 @@ iouter()
     
     /* non-empty result */
 
+    /* compute the table in C loops if possible */
+    z = outer_table(f, a, b, vz, pfirstint(shz));
+    if (z != invalidptr) {
+#ifdef FP_EXCEPTION_FLAG
+      fp_checksignal();
+#endif
+      freeup(shz);
+      apush(z);
+      freeup(a);
+      freeup(b);
+      freeup(c);
+      return;
+    }
+
     /* compute first result item get expected result type */
     pair(fetchasarray(a, 0), fetchasarray(b, 0));
     APPLYPRIMITIVE(f);
@@ -710,7 +748,7 @@ ieachboth()
     nialptr     x,
                 y,
                 z = apop();
-    int         prop = get_prop(f);
+    int         prop = (tag(f) == t_basic ? get_prop(f) : 0);
 
     splitfb(z, &x, &y);
 
@@ -1054,10 +1092,13 @@ igrade()
 /* The following routine compute sort f x or grade f x, for a comparator f, where
    gradesw=1 implies grade f x, otherwise sort f x.
 
-   The routine uses 2 different approaches depending on the type of the
+   The routine uses 3 different approaches depending on the type of the
    data argument: 
-      If x is an integer array and the comparator is <= or "up" then a radix sort 
-      is done.
+      If x is a large homogeneous array and the comparator is <=, >= or "up"
+      then a radix sort is done by radixsort in radixsort.c.
+
+      If x is a large array of atoms or homogeneous arrays and the comparator
+      is "up" then mergesort_up in radixsort.c sorts it on several threads.
 
       Otherwise a merge sort from Knuth's book is used. It is described
       by the implmenter Jean Michel as follows:
@@ -1081,8 +1122,8 @@ igrade()
        Distribution sort is faster for discrete types (characters, booleans). 
        The algorithm uses extra space (an integer array l of length n+2) . 
    
-   A radix sort for real arrays was tested but did not improve 
-   performance significantly.
+   A result of SORT with "up", or with <= on a homogeneous array, is marked
+   as sorted.
 
    The sort routine is used in several of the primitives array operations
    to achieve N (log N) performance rather than N * N . The array representation
@@ -1106,6 +1147,7 @@ sort(nialptr f, nialptr x, int gradesw)
   int         lteflag,
               gteflag,
               speedup,
+              upsorted,
               tv = false;
   if (atomic(x)) {
     if (gradesw) {
@@ -1119,8 +1161,8 @@ sort(nialptr f, nialptr x, int gradesw)
     nialint     n2;
 
     kx = kind(x);
-    if ((is_sorted(x) || check_sorted(x)) &&
-          (f == upcode || (f == ltecode && (kx == inttype || kx == realtype))))
+    upsorted = f == upcode || (f == ltecode && homotype(kx));
+    if ((is_sorted(x) || check_sorted(x)) && upsorted)
     { /* array is already sorted */
       if (gradesw)
       { /* build the grade result */  
@@ -1144,6 +1186,32 @@ sort(nialptr f, nialptr x, int gradesw)
       kx = atype;
     }
 
+    /* use a radix sort or a parallel merge sort if possible */
+    if (speedup) {
+      m = invalidptr;
+      if (homotype(kx) && tally(x) >= RADIXMINITEMS)
+        m = radixsort(x, gteflag, gradesw);
+      else if (kx == atype && lteflag)
+        m = mergesort_up(x, gradesw);
+      if (m != invalidptr) {
+        v = valence(x);
+        if (gradesw && v != 1) {  /* convert the indices to addresses */
+          nialptr     ind = m;
+
+          n = tally(x);
+          m = new_create_array(atype, v, 0, shpptr(x, v));
+          for (s = 0; s < n; s++)
+            store_array(m, s, ToAddress(fetch_int(ind, s), shpptr(x, v), v));
+          freeup(ind);
+        }
+        else if (!gradesw && upsorted)
+          set_sorted(m, true);
+        apush(m);
+        freeup(x);
+        return;
+      }
+    }
+
     /* start of algorithm from Knuth */
     n = tally(x);
     n2 = n + 2;
@@ -1370,7 +1438,7 @@ sort(nialptr f, nialptr x, int gradesw)
 
       if (homotest(m))  /* test if the result is homogeneous */
         m = implode(m);
-      if (f == upcode || (f == ltecode && (kx == inttype || kx == realtype)))
+      if (upsorted)
       {
         set_sorted(m, true); /* record that the result is sorted by "up" */
       }
@@ -2202,6 +2270,15 @@ leftaccumulate(nialptr f)
   if (tally(top) <= 1)
     return;                  /* accumulate on an empty or solitary has no effect */
   x = apop();                /* get the argument */
+#ifdef NATIVESCAN
+  /* use a C loop for an array of numbers or truth-values */
+  z = accumulate_scan(f, x);
+  if (z != invalidptr) {
+    apush(z);
+    freeup(x);
+    return;
+  }
+#endif
   tx = tally(x);
   vx = valence(x);
 
@@ -2511,8 +2588,17 @@ ibykey()
     return;
   }
 
-  /* split the data arg into a and b and protect a */
+  /* split the data arg into a and b */
   splitfb(x, &a, &b);
+
+  /* group lists in one pass if possible */
+  z = bykey_groups(f, a, b);
+  if (z != invalidptr) {
+    freeup(x);
+    apush(z);
+    return;
+  }
+
   apush(a);                  /* to protect a for below */
 
   /* get the gradeup of a */
@@ -2563,3 +2649,298 @@ ibykey()
   apush(z);
 }
 
+
+
+/* routines to implement the transformer MEMO, where MEMO f A gives the
+   value of f A and remembers it. When MEMO f is applied again to an
+   array equal to A the value is given without applying f. It is meant
+   for operations that always give the same value for the same argument
+   such as a recursive definition that would otherwise compute the same
+   values many times.
+
+   The values are kept in memotable, which holds a list of the
+   operations and arguments, a list of the values and an integer list
+   of links. MEMOSIZE values are kept. The links chain the entries of
+   each hash bucket and keep the entries in order of use, so that the
+   one used least recently is replaced when the table is full. Faults
+   are not kept. An operation is known by its parse tree, which the
+   table holds so that it is not freed and its place reused. A closure
+   is known by the operation it closes, since a local operation gets a
+   new closure each time it is used.
+
+   A curried operation such as (K +) is applied as its operation on the
+   pair of the value of K and the argument, so it is remembered that
+   way, with the value of K part of the argument. An operation that can
+   refer to the local names of an enclosing operation, or that has a
+   curried operation inside it, can give a different value each time it
+   is used, so it is applied without being remembered.
+*/
+
+#define MEMOHDR 4            /* count, first and last in use order, first free */
+#define mt_count 0
+#define mt_first 1
+#define mt_last 2
+#define mt_free 3
+#define mt_bucket(h) (MEMOHDR + ((h) & (MEMOSIZE - 1)))
+#define mt_next(i) (MEMOHDR + MEMOSIZE + (i)) /* bucket chain or free list */
+#define mt_newer(i) (MEMOHDR + 2 * MEMOSIZE + (i))
+#define mt_older(i) (MEMOHDR + 3 * MEMOSIZE + (i))
+#define mt_hash(i) (MEMOHDR + 4 * MEMOSIZE + (i))
+
+#define memokeys fetch_array(memotable, 0)
+#define memovals fetch_array(memotable, 1)
+#define memolinks (pfirstint(fetch_array(memotable, 2)))
+
+static struct {
+  nialint     hits,
+              misses,
+              evictions;
+} memostats;
+
+static void
+memo_create(void)
+{
+  nialptr     keys,
+              vals,
+              links;
+  nialint     nkeys = 2 * MEMOSIZE,
+              nvals = MEMOSIZE,
+              nlinks = MEMOHDR + 5 * MEMOSIZE,
+              i;
+  nialint    *p;
+
+  keys = new_create_array(atype, 1, 0, &nkeys);
+  for (i = 0; i < nkeys; i++)
+    store_array(keys, i, Null);
+  vals = new_create_array(atype, 1, 0, &nvals);
+  for (i = 0; i < nvals; i++)
+    store_array(vals, i, Null);
+  links = new_create_array(inttype, 1, 0, &nlinks);
+  p = pfirstint(links);
+  p[mt_count] = 0;
+  p[mt_first] = p[mt_last] = -1;
+  p[mt_free] = 0;
+  for (i = 0; i < MEMOSIZE; i++) {
+    p[mt_bucket(i)] = -1;
+    p[mt_next(i)] = (i < MEMOSIZE - 1 ? i + 1 : -1);
+  }
+  decrrefcnt(memotable);
+  freeup(memotable);
+  memotable = mkatriple(keys, vals, links);
+  incrrefcnt(memotable);
+}
+
+/* routines to take an entry out of the use order and to put it first */
+
+static void
+memo_unlink(nialint * p, nialint i)
+{
+  nialint     newer = p[mt_newer(i)],
+              older = p[mt_older(i)];
+
+  if (newer >= 0)
+    p[mt_older(newer)] = older;
+  else
+    p[mt_first] = older;
+  if (older >= 0)
+    p[mt_newer(older)] = newer;
+  else
+    p[mt_last] = newer;
+}
+
+static void
+memo_linkfirst(nialint * p, nialint i)
+{
+  p[mt_newer(i)] = -1;
+  p[mt_older(i)] = p[mt_first];
+  if (p[mt_first] >= 0)
+    p[mt_newer(p[mt_first])] = i;
+  else
+    p[mt_last] = i;
+  p[mt_first] = i;
+}
+
+/* routine to find the entry for f applied to x. x must be protected
+   since equal frees an unused argument. */
+
+static      nialint
+memo_find(nialptr f, nialptr x, nialint h)
+{
+  nialptr     keys = memokeys;
+  nialint    *p = memolinks,
+              i;
+
+  for (i = p[mt_bucket(h)]; i >= 0; i = p[mt_next(i)])
+    if (p[mt_hash(i)] == h && fetch_array(keys, 2 * i) == f &&
+        equal(x, fetch_array(keys, 2 * i + 1)))
+      return i;
+  return -1;
+}
+
+/* routine to make room by removing the entry used least recently */
+
+static void
+memo_evict(void)
+{
+  nialptr     keys = memokeys,
+              vals = memovals;
+  nialint    *p = memolinks,
+              i = p[mt_last],
+              at = mt_bucket(p[mt_hash(i)]);
+
+  memo_unlink(p, i);
+  while (p[at] != i)
+    at = mt_next(p[at]);
+  p[at] = p[mt_next(i)];
+  p[mt_next(i)] = p[mt_free];
+  p[mt_free] = i;
+  p[mt_count]--;
+  memostats.evictions++;
+  replace_array(keys, 2 * i, Null);
+  replace_array(keys, 2 * i + 1, Null);
+  replace_array(vals, i, Null);
+}
+
+static void
+memo_insert(nialptr f, nialptr x, nialint h, nialptr v)
+{
+  nialint    *p,
+              i;
+
+  if (memotable == Null)
+    memo_create();
+  if (memolinks[mt_free] < 0)
+    memo_evict();
+  p = memolinks;
+  i = p[mt_free];
+  p[mt_free] = p[mt_next(i)];
+  p[mt_hash(i)] = h;
+  p[mt_next(i)] = p[mt_bucket(h)];
+  p[mt_bucket(h)] = i;
+  memo_linkfirst(p, i);
+  p[mt_count]++;
+  replace_array(memokeys, 2 * i, f);
+  replace_array(memokeys, 2 * i + 1, x);
+  replace_array(memovals, i, v);
+}
+
+/* routine to test whether the values of f can be remembered. A named
+   operation is taken to depend only on its argument. An operation form
+   can refer to local names unless it is written outside any operation,
+   in which case its environment holds only its own names. */
+
+static int
+memo_cacheable(nialptr f)
+{
+  nialint     i;
+
+  switch (tag(f)) {
+    case t_basic:
+        return true;
+    case t_opform:
+        return (tally(get_env(f)) == 1);
+    case t_closure:
+        return (memo_cacheable(get_op(f)));
+    case t_variable:
+        return (get_sym(f) == global_symtab);
+    case t_composition:
+    case t_atlas:
+        for (i = 1; i < tally(f); i++)
+          if (!memo_cacheable(fetch_array(f, i)))
+            return false;
+        return true;
+    case t_transform:
+        return (memo_cacheable(get_argop(f)));
+    case t_parendobj:
+    case t_dottedobj:
+        return (memo_cacheable(get_obj(f)));
+    default:                 /* curried operations */
+        return false;
+  }
+}
+
+void
+imemo()
+{
+  nialptr     f = apop(),
+              x = apop(),
+              key,
+              v;
+  nialint     h,
+              i;
+
+  /* use the operation of a curried operation on the pair of the value
+     of its left argument and x */
+  while (tag(f) == t_curried) {
+    apush(x);                /* to protect x during the evaluation */
+    eval(get_argexpr(f));
+    v = apop();
+    pair(v, apop());
+    x = apop();
+    f = get_op(f);
+  }
+  if (!memo_cacheable(f)) {
+    apush(x);
+    do_apply(f);
+    return;
+  }
+
+  key = (tag(f) == t_closure ? get_op(f) : f);
+  h = hasharray(x);
+  apush(x);                  /* to protect x across calls of equal */
+  i = (memotable == Null ? -1 : memo_find(key, x, h));
+  if (i >= 0) {
+    memostats.hits++;
+    memo_unlink(memolinks, i);
+    memo_linkfirst(memolinks, i);
+    freeup(apop());
+    apush(fetch_array(memovals, i));
+    return;
+  }
+  memostats.misses++;
+  apush(x);
+  do_apply(f);
+  v = apop();
+  x = apop();
+  if (kind(v) != faulttype) {
+    /* a recursive use of f may have kept this value already */
+    apush(x);
+    apush(v);
+    if (memotable == Null || memo_find(key, x, h) < 0)
+      memo_insert(key, x, h, v);
+    v = apop();
+    x = apop();
+  }
+  freeup(x);
+  apush(v);
+}
+
+#define NOMEMOSTATS 5        /* number of rows in the memostats result */
+
+/* routine to implement the expression memostats. The result is a table
+   with a row for each statistic holding its name and its value. */
+
+void
+imemostats()
+{
+  nialptr     x,
+              z;
+  nialint     shape[2] = {NOMEMOSTATS, 2};
+
+  apush(makephrase("hits"));
+  apush(createint(memostats.hits));
+  apush(makephrase("misses"));
+  apush(createint(memostats.misses));
+  apush(makephrase("evictions"));
+  apush(createint(memostats.evictions));
+  apush(makephrase("entries"));
+  apush(createint(memotable == Null ? 0 : memolinks[mt_count]));
+  apush(makephrase("capacity"));
+  apush(createint(MEMOSIZE));
+  mklist(2 * NOMEMOSTATS);
+  x = apop();
+  z = new_create_array(atype, 2, 0, shape);
+  copy(z, 0, x, 0, 2 * NOMEMOSTATS);
+  freeup(x);
+  apush(z);
+}
@@ -6,6 +6,9 @@
  Contrubuted by John Gibbons.
  *
  * For Linux and Mac OSX this wraps the dlfnc capabilities of the OS.
+ *
+ * It also compiles numeric Nial operations to C, builds them with the
+ * system C compiler and loads the result (see ndlCompile below).
  * 
  */
 
@@ -22,6 +25,7 @@
 #include <unistd.h>
 #include <sys/mman.h>
 #include <sys/fcntl.h>
+#include <sys/wait.h>
 
 /* LIMITLIB */
 #include <limits.h>
@@ -29,6 +33,9 @@
 /* STDLIB */
 #include <stdlib.h>
 
+/* STDARG */
+#include <stdarg.h>
+
 /* SJLIB */
 #include <setjmp.h>
 
@@ -41,6 +48,13 @@
 #include "lib_main.h"
 #include "absmach.h"
 #include "ops.h"
+#include "parse.h"
+#include "blders.h"
+#include "getters.h"
+#include "symtab.h"
+#include "roles.h"
+#include "utils.h"
+#include "eval.h"
 
 #include <dlfcn.h>
 #include <string.h>
@@ -52,6 +66,7 @@ typedef void (*NialPrimFunction)(void);
 /* Flags to identify type of struct */ 
 #define NDL_LIBRARY_CAST 1
 #define NDL_FUNCTION_CAST 2
+#define NDL_KERNEL_CAST 3
 
 
 /* Routine to move between structs and arrays of integers */
@@ -72,6 +87,20 @@ typedef struct {
   void *ptrVal;
 } PointerCast;
 
+/* Struct for an operation compiled by ndlCompile. Its handle holds
+   this with the operation form, which is applied where the compiled
+   versions do not give the result. */
+typedef struct {
+  nialint castType;
+  void *intVersion;    /* for integer arguments, or NULL */
+  void *realVersion;   /* for real arguments, or NULL */
+  nialint nargs;
+  nialint intResult, realResult;   /* the kinds of their results */
+} KernelCast;
+
+/* Routine to apply a compiled operation */
+static void ndl_kernelcall(KernelCast *k, nialptr form, nialptr args);
+
 
 /**
  * Copy a struct to an array of integers
@@ -217,7 +246,19 @@ void indlCall(void) {
   if (tally(x) == 2) {
     splitfb(x, &fun, &funargs);
 
-    if (NDL_RESTORE_STRUCT(PointerCast, &funcast, fun) != -1 && funcast.castType == NDL_FUNCTION_CAST) {
+    if (kind(fun) == atype && tally(fun) == 2) {
+      /* apply an operation compiled by ndlCompile, held with its form */
+      KernelCast kcast;
+
+      if (NDL_RESTORE_STRUCT(KernelCast, &kcast, fetch_array(fun, 0)) == -1 ||
+          kcast.castType != NDL_KERNEL_CAST) {
+        apush(makefault("?dynfun"));
+      } else {
+        ndl_kernelcall(&kcast, fetch_array(fun, 1), funargs);
+      }
+    } else if (NDL_RESTORE_STRUCT(PointerCast, &funcast, fun) == -1) {
+      apush(makefault("?dynfun"));
+    } else if (funcast.castType == NDL_FUNCTION_CAST) {
       /* invoke the externalfunction */
       NialPrimFunction nfptr = (NialPrimFunction)(funcast.ptrVal);
       apush(funargs);
@@ -235,4 +276,1549 @@ void indlCall(void) {
 }
 
 
+/**
+ * Ahead-of-time compilation of numeric operations.
+ *
+ * ndlCompile translates a set of operations defined by operation forms
+ * into C, compiles the C into a shared library with the system C
+ * compiler and loads it. The result for each operation is a handle
+ * that ndlCall applies to numbers or to arrays of numbers of the same
+ * shape, the loop over the items being done in C.
+ *
+ * The operations may use their parameters and local variables,
+ * numeric constants, the arithmetic, comparison, logical and scientific
+ * primitives, assignment, IF, WHILE, REPEAT, FOR over TELL, EXIT and
+ * calls of the other operations in the set. A form that uses anything
+ * else is reported by a fault naming it.
+ *
+ * Each C value has the type, truth-value, integer or real, that the
+ * value has in Nial, found from the types of the parameters. So each
+ * operation is translated in a version for integer arguments and one
+ * for real arguments, and a call between the operations uses a version
+ * for the types of its arguments. A version in which a value could
+ * have either of two types, or a variable could be used before it is
+ * assigned, is left out.
+ *
+ * Where Nial gives a fault or a value that the C arithmetic does not,
+ * as on integer overflow, division by zero or a real that is not
+ * finite, the C code notes it and ndlCall applies the operation form
+ * in the interpreter instead. It does the same for arguments there is
+ * no version for, so the result is always the one Nial gives.
+ *
+ * The compiler is taken from the environment variable NIALCC, or is
+ * NDL_COMPILER below. It is split into words at spaces and run without
+ * a shell on files in a new private directory. ndlCsource gives the C
+ * text without compiling.
+ */
+
+#define NDL_COMPILER "cc -O2 -shared -fPIC"
+#define NDL_MAXOPS 64    /* operations compiled together */
+#define NDL_MAXARGS 16   /* parameters of a compiled operation */
+#define NDL_MAXLOCALS 256 /* local variables of a compiled operation */
+#define NDL_MAXVERSIONS 256 /* typed versions of the operations */
+#define NDL_MAXWORDS 64  /* words of the compiler command */
+
+/* A value passed to and from the compiled code */
+typedef union {
+  nialint i;
+  double r;
+} NdlValue;
+
+typedef int (*NialKernel)(const NdlValue *, NdlValue *);
+
+/* The types of the C values. ty_none is a type not found yet and
+   ty_bad that of a value no one type fits. */
+enum {
+  ty_none, ty_bool, ty_int, ty_real, ty_bad
+};
+
+#define ndl_isint(ty) ((ty) == ty_bool || (ty) == ty_int)
+
+/* A version of an operation for given types of its parameters */
+typedef struct {
+  nialint op;
+  int params[NDL_MAXARGS];
+  int locals[NDL_MAXLOCALS];   /* the types of the locals */
+  int result;
+  int bad, unknown;
+  const char *why;             /* the reason it is bad */
+} NdlVersion;
+
+/* A growing buffer for the C text */
+typedef struct {
+  char *s;
+  size_t len, cap;
+} NdlText;
+
+static struct {
+  nialint nops;
+  nialptr names[NDL_MAXOPS];   /* the names as phrases */
+  nialptr forms[NDL_MAXOPS];   /* their operation forms */
+  nialint nargs[NDL_MAXOPS];
+  nialint entry[NDL_MAXOPS][2]; /* their versions for integers and reals */
+  NdlVersion versions[NDL_MAXVERSIONS];
+  nialint nversions;
+  nialint cur, curop;          /* the version being translated */
+  nialptr locals[NDL_MAXLOCALS]; /* entries of the locals of the current form */
+  char assigned[NDL_MAXLOCALS];  /* the locals certain to have a value */
+  nialint nlocals, nparams;
+  int loopdepth, nlimits, failed, changed;
+  char err[MAXIDSIZE + 100];
+} ndl;
+
+
+static void ndl_puts(NdlText *t, const char *str) {
+  size_t n = strlen(str);
+
+  if (t->len + n + 1 > t->cap) {
+    size_t cap = 2 * (t->len + n + 1) + 1024;
+    char *s = realloc(t->s, cap);
+
+    if (s == NULL) {
+      ndl.failed = true;
+      strcpy(ndl.err, "?ndlCompile: out of memory");
+      return;
+    }
+    t->s = s;
+    t->cap = cap;
+  }
+  memcpy(t->s + t->len, str, n + 1);
+  t->len += n;
+}
+
+static void ndl_printf(NdlText *t, const char *fmt, ...) {
+  char buf[MAXIDSIZE + 100];
+  va_list ap;
+
+  va_start(ap, fmt);
+  vsnprintf(buf, sizeof buf, fmt, ap);
+  va_end(ap);
+  ndl_puts(t, buf);
+}
+
+/* Put pre a mid b post, leaving out mid b when b is NULL */
+static void ndl_form(NdlText *t, const char *pre, const char *a,
+                     const char *mid, const char *b, const char *post) {
+  ndl_puts(t, pre);
+  ndl_puts(t, a);
+  if (b != NULL) {
+    ndl_puts(t, mid);
+    ndl_puts(t, b);
+  }
+  ndl_puts(t, post);
+}
+
+static const char *ndl_str(NdlText *t) {
+  return (t->s == NULL ? "" : t->s);
+}
+
+/* Record the first reason the translation fails */
+static void ndl_fail(const char *why, nialptr name) {
+  if (!ndl.failed) {
+    ndl.failed = true;
+    snprintf(ndl.err, sizeof ndl.err, "?ndlCompile: %s%s%s", why,
+             (name == invalidptr ? "" : " "),
+             (name == invalidptr ? "" : pfirstchar(name)));
+  }
+}
+
+/* Note that the version being translated has no C equivalent */
+static int ndl_untyped(const char *why) {
+  NdlVersion *v = &ndl.versions[ndl.cur];
+
+  if (!v->bad) {
+    v->bad = true;
+    v->why = why;
+    ndl.changed = true;
+  }
+  return ty_bad;
+}
+
+/* Note a value whose type is not found yet */
+static int ndl_unknown(void) {
+  ndl.versions[ndl.cur].unknown = true;
+  return ty_none;
+}
+
+/* Give a variable or result in *slot a value of type ty */
+static void ndl_settype(int *slot, int ty, const char *why) {
+  if (ty == ty_none || ty == ty_bad || ty == *slot)
+    return;
+  if (*slot == ty_none) {
+    *slot = ty;
+    ndl.changed = true;
+  } else
+    ndl_untyped(why);
+}
+
+/* The type of a value that is one of values of types a and b */
+static int ndl_either(int a, int b) {
+  if (a == ty_bad || b == ty_bad)
+    return ty_bad;
+  if (a == ty_none || a == b)
+    return b;
+  if (b == ty_none)
+    return a;
+  return ndl_untyped("an IF with values of different types in");
+}
+
+static const char *ndl_ctype(int ty) {
+  return (ty == ty_real ? "double" : "ndl_int");
+}
+
+/* Put a Nial name as a C identifier, escaping characters C does not allow */
+static void ndl_cname(NdlText *t, const char *prefix, nialptr name) {
+  char *p = pfirstchar(name);
+
+  ndl_puts(t, prefix);
+  for (; *p; p++) {
+    if ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') || (*p >= '0' && *p <= '9')) {
+      char c[2] = {*p, 0};
+      ndl_puts(t, c);
+    } else
+      ndl_printf(t, "_%02x", (unsigned char) *p);
+  }
+}
+
+/* Put the name of the C function for version vi, ending in a letter
+   for the type of each parameter */
+static void ndl_vname(NdlText *t, const char *prefix, nialint vi) {
+  NdlVersion *v = &ndl.versions[vi];
+  nialint i;
+
+  ndl_cname(t, prefix, ndl.names[v->op]);
+  ndl_puts(t, "_");
+  for (i = 0; i < ndl.nargs[v->op]; i++)
+    ndl_puts(t, (v->params[i] == ty_bool ? "b" : v->params[i] == ty_int ? "i" : "r"));
+}
+
+
+/* The C code put before the operations. The helpers set ndl_bad where
+   Nial gives a fault or a value C does not. */
+static const char ndl_prelude[] =
+  "typedef union {\n  ndl_int i;\n  double r;\n} ndl_value;\n\n"
+  "static int ndl_bad;\n\n"
+  "static double ndl_real(double x)\n{\n"
+  "  if (!isfinite(x))\n    ndl_bad = 1;\n  return x;\n}\n\n"
+  "static ndl_int ndl_add(ndl_int a, ndl_int b)\n{\n  ndl_int z;\n\n"
+  "  if (__builtin_add_overflow(a, b, &z))\n    ndl_bad = 1;\n  return z;\n}\n\n"
+  "static ndl_int ndl_sub(ndl_int a, ndl_int b)\n{\n  ndl_int z;\n\n"
+  "  if (__builtin_sub_overflow(a, b, &z))\n    ndl_bad = 1;\n  return z;\n}\n\n"
+  "static ndl_int ndl_mul(ndl_int a, ndl_int b)\n{\n  ndl_int z;\n\n"
+  "  if (__builtin_mul_overflow(a, b, &z) || z == NDL_INTMIN)\n    ndl_bad = 1;\n"
+  "  return z;\n}\n\n"
+  "static ndl_int ndl_iabs(ndl_int a)\n{\n  return (a < 0 ? ndl_sub(0, a) : a);\n}\n\n"
+  "static double ndl_rabs(double a)\n{\n  return (a < 0 ? -a : a);\n}\n\n"
+  "static ndl_int ndl_imax(ndl_int a, ndl_int b)\n{\n  return (a >= b ? a : b);\n}\n\n"
+  "static ndl_int ndl_imin(ndl_int a, ndl_int b)\n{\n  return (a <= b ? a : b);\n}\n\n"
+  "static double ndl_rmax(double a, double b)\n{\n  return (a >= b ? a : b);\n}\n\n"
+  "static double ndl_rmin(double a, double b)\n{\n  return (a <= b ? a : b);\n}\n\n"
+  "static ndl_int ndl_mod(ndl_int a, ndl_int b)\n{\n  ndl_int m;\n\n"
+  "  if (b < 0) {\n    ndl_bad = 1;\n    return 0;\n  }\n"
+  "  if (b == 0)\n    return a;\n"
+  "  m = a % b;\n  return (m < 0 ? m + b : m);\n}\n\n"
+  "static ndl_int ndl_quot(ndl_int a, ndl_int b)\n{\n"
+  "  if (b < 0) {\n    ndl_bad = 1;\n    return 0;\n  }\n"
+  "  if (b == 0)\n    return 0;\n"
+  "  return (a >= 0 ? a / b : (a + 1) / b - 1);\n}\n\n"
+  "static ndl_int ndl_floor(double x)\n{\n  x = floor(x);\n"
+  "  if (!(x >= (double) NDL_INTMIN && x < -(double) NDL_INTMIN)) {\n"
+  "    ndl_bad = 1;\n    return 0;\n  }\n  return (ndl_int) x;\n}\n\n"
+  "static ndl_int ndl_ceil(double x)\n{\n  return ndl_sub(0, ndl_floor(0.0 - x));\n}\n\n"
+  "static ndl_int ndl_ipow(ndl_int a, ndl_int b)\n{\n  ndl_int z = 1;\n\n"
+  "  if (b < 0) {\n    ndl_bad = 1;\n    return 0;\n  }\n"
+  "  while (b > 0 && !ndl_bad) {\n    if (b & 1)\n      z = ndl_mul(z, a);\n"
+  "    b >>= 1;\n    if (b > 0)\n      a = ndl_mul(a, a);\n  }\n  return z;\n}\n\n"
+  "static double ndl_rpowi(double a, ndl_int b)\n{\n  double y = 1.0;\n  int n;\n\n"
+  "  if (b <= INT_MIN || b > INT_MAX) {\n    ndl_bad = 1;\n    return 0.0;\n  }\n"
+  "  for (n = (b < 0 ? -b : b); n > 0; n--)\n    y *= a;\n"
+  "  if (b < 0) {\n    if (y == 0.0) {\n      ndl_bad = 1;\n      return 0.0;\n    }\n"
+  "    y = 1.0 / y;\n  }\n  return ndl_real(y);\n}\n\n"
+  "static double ndl_rpow(double a, double b)\n{\n"
+  "  if (a == 0.0)\n    return (b != 0.0 ? 0.0 : 1.0);\n"
+  "  if (a < 0.0) {\n    ndl_bad = 1;\n    return 0.0;\n  }\n"
+  "  return ndl_real(exp(b * log(a)));\n}\n\n";
+
+
+/* The primitives with a C equivalent. p_real is a scientific function
+   given by the name of its C function. */
+enum {
+  p_plus, p_minus, p_times, p_divide, p_lt, p_lte, p_gt, p_gte, p_eq,
+  p_ne, p_max, p_min, p_power, p_mod, p_quotient, p_and, p_or, p_not,
+  p_opposite, p_abs, p_floor, p_ceiling, p_reciprocal, p_real
+};
+
+static struct {
+  char *name;
+  int nargs, code;
+  char *cname;
+} ndlprims[] = {
+  {"+", 2, p_plus, NULL},
+  {"PLUS", 2, p_plus, NULL},
+  {"-", 2, p_minus, NULL},
+  {"*", 2, p_times, NULL},
+  {"TIMES", 2, p_times, NULL},
+  {"/", 2, p_divide, NULL},
+  {"<", 2, p_lt, "<"},
+  {"<=", 2, p_lte, "<="},
+  {">", 2, p_gt, ">"},
+  {">=", 2, p_gte, ">="},
+  {"=", 2, p_eq, NULL},
+  {"~=", 2, p_ne, NULL},
+  {"MAX", 2, p_max, NULL},
+  {"MIN", 2, p_min, NULL},
+  {"POWER", 2, p_power, NULL},
+  {"MOD", 2, p_mod, NULL},
+  {"QUOTIENT", 2, p_quotient, NULL},
+  {"AND", 2, p_and, NULL},
+  {"OR", 2, p_or, NULL},
+  {"NOT", 1, p_not, NULL},
+  {"OPPOSITE", 1, p_opposite, NULL},
+  {"ABS", 1, p_abs, NULL},
+  {"FLOOR", 1, p_floor, NULL},
+  {"CEILING", 1, p_ceiling, NULL},
+  {"RECIPROCAL", 1, p_reciprocal, NULL},
+  {"SQRT", 1, p_real, "sqrt"},
+  {"EXP", 1, p_real, "exp"},
+  {"LN", 1, p_real, "log"},
+  {"LOG", 1, p_real, "log10"},
+  {"SIN", 1, p_real, "sin"},
+  {"COS", 1, p_real, "cos"},
+  {"TAN", 1, p_real, "tan"},
+  {"ARCSIN", 1, p_real, "asin"},
+  {"ARCCOS", 1, p_real, "acos"},
+  {"ARCTAN", 1, p_real, "atan"},
+  {"SINH", 1, p_real, "sinh"},
+  {"COSH", 1, p_real, "cosh"},
+  {"TANH", 1, p_real, "tanh"},
+  {NULL, 0, 0, NULL}
+};
+
+static int ndl_findprim(nialptr op) {
+  char *nm = pfirstchar(bnames[get_index(op)]);
+  int i;
+
+  for (i = 0; ndlprims[i].name != NULL; i++)
+    if (strcmp(ndlprims[i].name, nm) == 0)
+      return i;
+  return -1;
+}
+
+/* Put the C text for primitive p applied to a of type ta and, if it is
+   binary, b of type tb. The result is the type Nial gives the value. */
+static int ndl_primtext(NdlText *t, int p, int ta, const char *a, int tb, const char *b) {
+  int ints = ndl_isint(ta) && (b == NULL || ndl_isint(tb));
+  char mid[32];
+
+  if (ta == ty_bad || (b != NULL && tb == ty_bad))
+    return ty_bad;
+  if (ta == ty_none || (b != NULL && tb == ty_none))
+    return ndl_unknown();
+  switch (ndlprims[p].code) {
+    case p_plus:
+      if (ints) {
+        ndl_form(t, "ndl_add(", a, ", ", b, ")");
+        return ty_int;
+      }
+      ndl_form(t, "ndl_real((double) (", a, ") + (double) (", b, "))");
+      return ty_real;
+
+    case p_minus:
+      if (ints) {
+        ndl_form(t, "ndl_sub(", a, ", ", b, ")");
+        return ty_int;
+      }
+      ndl_form(t, "ndl_real((double) (", a, ") - (double) (", b, "))");
+      return ty_real;
+
+    case p_times:
+      if (ints) {
+        ndl_form(t, "ndl_mul(", a, ", ", b, ")");
+        return ty_int;
+      }
+      ndl_form(t, "ndl_real((double) (", a, ") * (double) (", b, "))");
+      return ty_real;
+
+    case p_divide:
+      ndl_form(t, "ndl_real((double) (", a, ") / (double) (", b, "))");
+      return ty_real;
+
+    case p_lt:
+    case p_lte:
+    case p_gt:
+    case p_gte:
+      if (ints) {
+        snprintf(mid, sizeof mid, ") %s (", ndlprims[p].cname);
+        ndl_form(t, "(ndl_int) ((", a, mid, b, "))");
+      } else {
+        snprintf(mid, sizeof mid, ") %s (double) (", ndlprims[p].cname);
+        ndl_form(t, "(ndl_int) ((double) (", a, mid, b, "))");
+      }
+      return ty_bool;
+
+    case p_eq:
+    case p_ne:
+      /* atoms of different types are never equal */
+      if (ta == tb)
+        ndl_form(t, "(ndl_int) ((", a, (ndlprims[p].code == p_eq ? ") == (" : ") != ("), b, "))");
+      else
+        ndl_form(t, "((void) (", a, "), (void) (", b,
+                 (ndlprims[p].code == p_eq ? "), (ndl_int) 0)" : "), (ndl_int) 1)"));
+      return ty_bool;
+
+    case p_max:
+    case p_min:
+      if (ints) {
+        ndl_form(t, (ndlprims[p].code == p_max ? "ndl_imax(" : "ndl_imin("), a, ", ", b, ")");
+        return (ta == ty_bool && tb == ty_bool ? ty_bool : ty_int);
+      }
+      ndl_form(t, (ndlprims[p].code == p_max ? "ndl_rmax((double) (" : "ndl_rmin((double) ("),
+               a, "), (double) (", b, "))");
+      return ty_real;
+
+    case p_power:
+      if (ints) {
+        ndl_form(t, "ndl_ipow(", a, ", ", b, ")");
+        return ty_int;
+      }
+      if (ta == ty_real && tb == ty_int)
+        ndl_form(t, "ndl_rpowi(", a, ", ", b, ")");
+      else
+        ndl_form(t, "ndl_rpow((double) (", a, "), (double) (", b, "))");
+      return ty_real;
+
+    case p_mod:
+    case p_quotient:
+      if (!ints)
+        return ndl_untyped("MOD or QUOTIENT of a real in");
+      ndl_form(t, (ndlprims[p].code == p_mod ? "ndl_mod(" : "ndl_quot("), a, ", ", b, ")");
+      return ty_int;
+
+    case p_and:
+    case p_or:
+      if (ta != ty_bool || tb != ty_bool)
+        return ndl_untyped("AND or OR of a number in");
+      ndl_form(t, "((", a, (ndlprims[p].code == p_and ? ") & (" : ") | ("), b, "))");
+      return ty_bool;
+
+    case p_not:
+      if (ta != ty_bool)
+        return ndl_untyped("NOT of a number in");
+      ndl_form(t, "(ndl_int) !(", a, NULL, NULL, ")");
+      return ty_bool;
+
+    case p_opposite:
+      if (ints) {
+        ndl_form(t, "ndl_sub(0, ", a, NULL, NULL, ")");
+        return ty_int;
+      }
+      ndl_form(t, "(0.0 - (", a, NULL, NULL, "))");
+      return ty_real;
+
+    case p_abs:
+      ndl_form(t, (ints ? "ndl_iabs(" : "ndl_rabs("), a, NULL, NULL, ")");
+      return (ints ? ty_int : ty_real);
+
+    case p_floor:
+      ndl_form(t, (ints ? "(" : "ndl_floor("), a, NULL, NULL, ")");
+      return ty_int;
+
+    case p_ceiling:
+      ndl_form(t, (ints ? "ndl_sub(0, ndl_sub(0, " : "ndl_ceil("), a, NULL, NULL,
+               (ints ? "))" : ")"));
+      return ty_int;
+
+    case p_reciprocal:
+      ndl_form(t, "ndl_real(1.0 / (double) (", a, NULL, NULL, "))");
+      return ty_real;
+
+    default:
+      ndl_puts(t, "ndl_real(");
+      ndl_puts(t, ndlprims[p].cname);
+      ndl_form(t, "((double) (", a, NULL, NULL, ")))");
+      return ty_real;
+  }
+}
+
+/* Find the compiled operation a call refers to */
+static nialint ndl_findop(nialptr op) {
+  nialint i;
+
+  if (tag(op) != t_variable || get_sym(op) != global_symtab)
+    return -1;
+  for (i = 0; i < ndl.nops; i++)
+    if (strcmp(pfirstchar(ndl.names[i]), pfirstchar(get_var_pv(op))) == 0)
+      return i;
+  return -1;
+}
+
+/* Find or make the version of operation k for parameters of types ty.
+   The result is -1 if there are too many versions. */
+static nialint ndl_version(nialint k, int *ty) {
+  NdlVersion *v;
+  nialint i;
+
+  for (i = 0; i < ndl.nversions; i++) {
+    v = &ndl.versions[i];
+    if (v->op == k && memcmp(v->params, ty, ndl.nargs[k] * sizeof(int)) == 0)
+      return i;
+  }
+  if (ndl.nversions == NDL_MAXVERSIONS)
+    return -1;
+  v = &ndl.versions[ndl.nversions];
+  memset(v, 0, sizeof *v);
+  v->op = k;
+  memcpy(v->params, ty, ndl.nargs[k] * sizeof(int));
+  ndl.changed = true;
+  return ndl.nversions++;
+}
+
+/* Note a local variable so that it is declared. The result is its
+   index, or -1 if there are too many. */
+static nialint ndl_local(nialptr var) {
+  nialptr entr = get_entry(var);
+  nialint i;
+
+  for (i = 0; i < ndl.nlocals; i++)
+    if (ndl.locals[i] == entr)
+      return i;
+  if (ndl.nlocals == NDL_MAXLOCALS) {
+    ndl_fail("too many local variables in", ndl.names[ndl.curop]);
+    return -1;
+  }
+  ndl.locals[ndl.nlocals] = entr;
+  ndl.assigned[ndl.nlocals] = false;
+  return ndl.nlocals++;
+}
+
+static int ndl_expr(NdlText *t, nialptr e);
+
+static int ndl_prim(NdlText *t, int p, nialptr ea, nialptr eb) {
+  NdlText a = {NULL, 0, 0},
+          b = {NULL, 0, 0};
+  int ta, tb = ty_none, ty;
+
+  ta = ndl_expr(&a, ea);
+  if (eb != invalidptr)
+    tb = ndl_expr(&b, eb);
+  ty = ndl_primtext(t, p, ta, ndl_str(&a), tb, (eb == invalidptr ? NULL : ndl_str(&b)));
+  free(a.s);
+  free(b.s);
+  return ty;
+}
+
+/* Put a call of the version of compiled operation k for n values of
+   types ty given as C text */
+static int ndl_calltext(NdlText *t, nialint k, nialint n, int *ty, const char **arg) {
+  nialint i, vi;
+
+  if (n != ndl.nargs[k]) {
+    ndl_fail("wrong number of arguments in a call of", ndl.names[k]);
+    return ty_bad;
+  }
+  for (i = 0; i < n; i++)
+    if (ty[i] == ty_bad)
+      return ty_bad;
+  for (i = 0; i < n; i++)
+    if (ty[i] == ty_none)
+      return ndl_unknown();
+  vi = ndl_version(k, ty);
+  if (vi < 0)
+    return ndl_untyped("too many versions of the operations for");
+  if (ndl.versions[vi].bad)
+    return ndl_untyped("a call that cannot be compiled for its types in");
+  ndl_vname(t, "k_", vi);
+  ndl_puts(t, "(");
+  for (i = 0; i < n; i++) {
+    if (i > 0)
+      ndl_puts(t, ", ");
+    ndl_puts(t, arg[i]);
+  }
+  ndl_puts(t, ")");
+  if (ndl.versions[vi].result == ty_none)
+    return ndl_unknown();
+  return ndl.versions[vi].result;
+}
+
+/* Put a call of compiled operation k. args holds n expressions */
+static int ndl_call(NdlText *t, nialint k, nialptr *args, nialint n) {
+  NdlText a[NDL_MAXARGS];
+  const char *s[NDL_MAXARGS];
+  int ty[NDL_MAXARGS], res;
+  nialint i;
+
+  if (n != ndl.nargs[k]) {
+    ndl_fail("wrong number of arguments in a call of", ndl.names[k]);
+    return ty_bad;
+  }
+  for (i = 0; i < n; i++) {
+    a[i].s = NULL;
+    a[i].len = a[i].cap = 0;
+    ty[i] = ndl_expr(&a[i], args[i]);
+  }
+  for (i = 0; i < n; i++)
+    s[i] = ndl_str(&a[i]);
+  res = ndl_calltext(t, k, n, ty, s);
+  for (i = 0; i < n; i++)
+    free(a[i].s);
+  return res;
+}
+
+static int ndl_compose(NdlText *t, nialptr op, nialint last, const char *arg, int ty);
+
+/* Put an application of op to a single value of type ty given as C
+   text. This is used for the operations of a composition after the
+   first is applied. */
+static int ndl_apply(NdlText *t, nialptr op, const char *arg, int ty) {
+  nialint k;
+  int p;
+
+  if (ndl.failed)
+    return ty_bad;
+  switch (tag(op)) {
+    case t_basic:
+      p = ndl_findprim(op);
+      if (p < 0 || ndlprims[p].nargs != 1) {
+        ndl_fail("no C equivalent for", bnames[get_index(op)]);
+        return ty_bad;
+      }
+      return ndl_primtext(t, p, ty, arg, ty_none, NULL);
+
+    case t_curried:
+      {
+        nialptr op1 = get_op(op);
+        NdlText a = {NULL, 0, 0};
+        int res = ty_bad;
+
+        if (tag(op1) == t_basic) {
+          p = ndl_findprim(op1);
+          if (p < 0 || ndlprims[p].nargs != 2)
+            ndl_fail("no C equivalent for", bnames[get_index(op1)]);
+          else {
+            int ta = ndl_expr(&a, get_argexpr(op));
+
+            res = ndl_primtext(t, p, ta, ndl_str(&a), ty, arg);
+          }
+        } else if ((k = ndl_findop(op1)) >= 0 && ndl.nargs[k] == 2) {
+          int tys[2];
+          const char *s[2];
+
+          tys[0] = ndl_expr(&a, get_argexpr(op));
+          tys[1] = ty;
+          s[0] = ndl_str(&a);
+          s[1] = arg;
+          res = ndl_calltext(t, k, 2, tys, s);
+        } else
+          ndl_fail("a call of an operation that is not compiled in", ndl.names[ndl.curop]);
+        free(a.s);
+        return res;
+      }
+
+    case t_composition:
+      return ndl_compose(t, op, tally(op) - 1, arg, ty);
+
+    default:
+      if ((k = ndl_findop(op)) >= 0 && ndl.nargs[k] == 1)
+        return ndl_calltext(t, k, 1, &ty, &arg);
+      ndl_fail("a call of an operation that is not compiled in", ndl.names[ndl.curop]);
+      return ty_bad;
+  }
+}
+
+/* Put the application of the operations 1 to last of composition op,
+   right to left, to a value of type ty given as C text */
+static int ndl_compose(NdlText *t, nialptr op, nialint last, const char *arg, int ty) {
+  NdlText u = {NULL, 0, 0};
+  nialint i;
+
+  ndl_puts(&u, arg);
+  for (i = last; i >= 1 && !ndl.failed; i--) {
+    NdlText v = {NULL, 0, 0};
+
+    ty = ndl_apply(&v, fetch_array(op, i), ndl_str(&u), ty);
+    free(u.s);
+    u = v;
+  }
+  ndl_puts(t, ndl_str(&u));
+  free(u.s);
+  return ty;
+}
+
+/* Put a call of op on the argument expression arg */
+static int ndl_opcall(NdlText *t, nialptr op, nialptr arg) {
+  nialptr args[NDL_MAXARGS];
+  nialint n = 1, i, k;
+  int p;
+
+  if (tag(arg) == t_strand) {
+    n = tally(arg) - 1;
+    if (n > NDL_MAXARGS) {
+      ndl_fail("too many arguments in a call in", ndl.names[ndl.curop]);
+      return ty_bad;
+    }
+    for (i = 0; i < n; i++)
+      args[i] = fetch_array(arg, i + 1);
+  } else
+    args[0] = arg;
+
+  switch (tag(op)) {
+    case t_basic:
+      p = ndl_findprim(op);
+      if (p < 0)
+        ndl_fail("no C equivalent for", bnames[get_index(op)]);
+      else if (ndlprims[p].nargs == 1)
+        return ndl_prim(t, p, arg, invalidptr);
+      else if (n == 2)
+        return ndl_prim(t, p, args[0], args[1]);
+      else
+        ndl_fail("expecting a pair for", bnames[get_index(op)]);
+      return ty_bad;
+
+    case t_curried:             /* an infix call A f B */
+      {
+        nialptr op1 = get_op(op);
+
+        args[0] = get_argexpr(op);
+        args[1] = arg;
+        if (tag(op1) == t_basic) {
+          p = ndl_findprim(op1);
+          if (p >= 0 && ndlprims[p].nargs == 2)
+            return ndl_prim(t, p, args[0], args[1]);
+          ndl_fail("no C equivalent for", bnames[get_index(op1)]);
+        } else if ((k = ndl_findop(op1)) >= 0)
+          return ndl_call(t, k, args, 2);
+        else
+          ndl_fail("a call of an operation that is not compiled in", ndl.names[ndl.curop]);
+        return ty_bad;
+      }
+
+    case t_composition:         /* apply the last operation, then the others */
+      {
+        nialint m = tally(op) - 1;
+        NdlText u = {NULL, 0, 0};
+        int ty;
+
+        ty = ndl_opcall(&u, fetch_array(op, m), arg);
+        ty = ndl_compose(t, op, m - 1, ndl_str(&u), ty);
+        free(u.s);
+        return ty;
+      }
+
+    default:
+      if ((k = ndl_findop(op)) >= 0) {
+        if (ndl.nargs[k] == 1)  /* the whole argument */
+          return ndl_call(t, k, &arg, 1);
+        return ndl_call(t, k, args, n);
+      }
+      ndl_fail("a call of an operation that is not compiled in", ndl.names[ndl.curop]);
+      return ty_bad;
+  }
+}
+
+/* Put a test, which Nial requires to be a truth-value */
+static void ndl_test(NdlText *t, nialptr e) {
+  int ty = ndl_expr(t, e);
+
+  if (ty == ty_int || ty == ty_real)
+    ndl_untyped("a test that is not a truth-value in");
+}
+
+/* Put a C expression for the Nial expression e. The result is its type. */
+static int ndl_expr(NdlText *t, nialptr e) {
+  nialptr v;
+  nialint i, n;
+  int ty;
+
+  if (ndl.failed)
+    return ty_bad;
+  if (e == Nullexpr || kind(e) == faulttype) {
+    ndl_fail("an expression without a number in", ndl.names[ndl.curop]);
+    return ty_bad;
+  }
+  switch (tag(e)) {
+    case t_constant:
+      v = get_c_val(e);
+      if (atomic(v) && kind(v) == inttype) {
+        if (intval(v) == SMALLINT)
+          ndl_puts(t, "NDL_INTMIN");
+        else
+          ndl_printf(t, "((ndl_int) %lldLL)", (long long) intval(v));
+        return ty_int;
+      }
+      if (atomic(v) && kind(v) == booltype) {
+        ndl_puts(t, (boolval(v) ? "((ndl_int) 1)" : "((ndl_int) 0)"));
+        return ty_bool;
+      }
+      if (atomic(v) && kind(v) == realtype) {
+        char buf[40];
+
+        if (!isfinite(realval(v)))
+          return ndl_untyped("a constant that is not finite in");
+        snprintf(buf, sizeof buf, "%.17g", realval(v));
+        if (strpbrk(buf, ".e") == NULL)
+          strcat(buf, ".0");
+        ndl_printf(t, "(%s)", buf);
+        return ty_real;
+      }
+      ndl_fail("a constant that is not a number in", ndl.names[ndl.curop]);
+      return ty_bad;
+
+    case t_variable:
+      if (get_sym(e) == global_symtab) {
+        ndl_fail("the global variable", get_var_pv(e));
+        return ty_bad;
+      }
+      if ((i = ndl_local(e)) < 0)
+        return ty_bad;
+      if (!ndl.assigned[i])
+        return ndl_untyped("a variable that may have no value in");
+      ndl_cname(t, "v_", get_var_pv(e));
+      ty = ndl.versions[ndl.cur].locals[i];
+      return (ty == ty_none ? ndl_unknown() : ty);
+
+    case t_parendobj:
+      return ndl_expr(t, get_obj(e));
+
+    case t_exprseq:
+      if (tally(e) == 2)
+        return ndl_expr(t, fetch_array(e, 1));
+      ndl_fail("a sequence used as a value in", ndl.names[ndl.curop]);
+      return ty_bad;
+
+    case t_basic_binopcall:
+      {
+        int p = ndl_findprim(get_op(e));
+
+        if (p >= 0 && ndlprims[p].nargs == 2)
+          return ndl_prim(t, p, get_argexpr(e), get_argexpr1(e));
+        ndl_fail("no C equivalent for", bnames[get_index(get_op(e))]);
+        return ty_bad;
+      }
+
+    case t_opcall:
+      return ndl_opcall(t, get_op(e), get_argexpr(e));
+
+    case t_ifexpr:              /* as a chain of conditional expressions */
+      n = tally(e);
+      if ((n - 1) % 2 == 0) {
+        ndl_fail("an IF without ELSE used as a value in", ndl.names[ndl.curop]);
+        return ty_bad;
+      }
+      ty = ty_none;
+      ndl_puts(t, "(");
+      for (i = 1; n - i > 1; i += 2) {
+        ndl_puts(t, "(");
+        ndl_test(t, get_test(e, i));
+        ndl_puts(t, ") != 0 ? ");
+        ty = ndl_either(ty, ndl_expr(t, get_thenexpr(e, i)));
+        ndl_puts(t, " : ");
+      }
+      ty = ndl_either(ty, ndl_expr(t, get_elseexpr(e, i)));
+      ndl_puts(t, ")");
+      return ty;
+
+    default:
+      ndl_fail("an expression that is not numeric in", ndl.names[ndl.curop]);
+      return ty_bad;
+  }
+}
+
+/* Strip the parentheses and sequences of one expression around e */
+static nialptr ndl_unwrap(nialptr e) {
+  while (e != Nullexpr && kind(e) != faulttype &&
+         ((tag(e) == t_exprseq && tally(e) == 2) || tag(e) == t_parendobj))
+    e = (tag(e) == t_parendobj ? get_obj(e) : fetch_array(e, 1));
+  return e;
+}
+
+static void ndl_indent(NdlText *t, int depth) {
+  int i;
+
+  for (i = 0; i < depth; i++)
+    ndl_puts(t, "  ");
+}
+
+/* Put C statements for the Nial expression e. If target is not NULL
+   its value is the result and is assigned to the C variable target. */
+static void ndl_stmt(NdlText *t, nialptr e, const char *target, int depth) {
+  NdlVersion *v = &ndl.versions[ndl.cur];
+  char before[NDL_MAXLOCALS], after[NDL_MAXLOCALS];
+  nialint i, j, n;
+  int ty;
+
+  if (ndl.failed)
+    return;
+  if (e == Nullexpr || kind(e) == faulttype ||
+      tag(e) == t_nulltree || tag(e) == t_commentexpr) {
+    if (target != NULL)
+      ndl_fail("an expression without a number in", ndl.names[ndl.curop]);
+    return;
+  }
+  switch (tag(e)) {
+    case t_exprseq:
+    case t_defnseq:
+      n = tally(e);
+      for (i = 1; i < n; i++)
+        ndl_stmt(t, fetch_array(e, i), (i == n - 1 ? target : NULL), depth);
+      break;
+
+    case t_parendobj:
+      ndl_stmt(t, get_obj(e), target, depth);
+      break;
+
+    case t_assignexpr:
+      {
+        nialptr idlist = get_idlist(e);
+        nialptr var;
+
+        if (tally(idlist) != 2) {
+          ndl_fail("an assignment to several variables in", ndl.names[ndl.curop]);
+          break;
+        }
+        var = fetch_array(idlist, 1);
+        if (get_sym(var) == global_symtab) {
+          ndl_fail("the global variable", get_var_pv(var));
+          break;
+        }
+        if ((i = ndl_local(var)) < 0)
+          break;
+        ndl_indent(t, depth);
+        ndl_cname(t, "v_", get_var_pv(var));
+        ndl_puts(t, " = ");
+        ty = ndl_expr(t, get_expr(e));
+        ndl_puts(t, ";\n");
+        ndl_settype(&v->locals[i], ty, "a variable given values of different types in");
+        ndl.assigned[i] = true;
+        if (target != NULL) {
+          ndl_indent(t, depth);
+          ndl_printf(t, "%s = ", target);
+          ndl_cname(t, "v_", get_var_pv(var));
+          ndl_puts(t, ";\n");
+          ndl_settype(&v->result, ty, "results of different types in");
+        }
+      }
+      break;
+
+    case t_ifexpr:
+      /* a variable has a value after the IF if it has after each branch */
+      n = tally(e);
+      if ((n - 1) % 2 == 0 && target != NULL) {
+        ndl_fail("an IF without ELSE used as a value in", ndl.names[ndl.curop]);
+        break;
+      }
+      memcpy(before, ndl.assigned, sizeof before);
+      memset(after, true, sizeof after);
+      for (i = 1; n - i > 1; i += 2) {
+        memcpy(ndl.assigned, before, sizeof before);
+        ndl_indent(t, depth);
+        ndl_puts(t, (i == 1 ? "if ((" : "else if (("));
+        ndl_test(t, get_test(e, i));
+        ndl_puts(t, ") != 0) {\n");
+        ndl_stmt(t, get_thenexpr(e, i), target, depth + 1);
+        ndl_indent(t, depth);
+        ndl_puts(t, "}\n");
+        for (j = 0; j < NDL_MAXLOCALS; j++)
+          after[j] = after[j] && ndl.assigned[j];
+      }
+      memcpy(ndl.assigned, before, sizeof before);
+      if (n - i == 1) {
+        ndl_indent(t, depth);
+        ndl_puts(t, "else {\n");
+        ndl_stmt(t, get_elseexpr(e, i), target, depth + 1);
+        ndl_indent(t, depth);
+        ndl_puts(t, "}\n");
+      }
+      for (j = 0; j < NDL_MAXLOCALS; j++)
+        ndl.assigned[j] = after[j] && ndl.assigned[j];
+      break;
+
+    case t_whileexpr:
+    case t_repeatexpr:
+    case t_forexpr:
+      /* the loops stop once a value differs from Nial's, and an
+         assignment in a loop is not counted after it */
+      if (target != NULL) {
+        ndl_fail("a loop used as a value in", ndl.names[ndl.curop]);
+        break;
+      }
+      memcpy(before, ndl.assigned, sizeof before);
+      ndl.loopdepth++;
+      if (tag(e) == t_whileexpr) {
+        ndl_indent(t, depth);
+        ndl_puts(t, "while (!ndl_bad && (");
+        ndl_test(t, get_wtest(e));
+        ndl_puts(t, ") != 0) {\n");
+        ndl_stmt(t, get_wexprseq(e), NULL, depth + 1);
+        ndl_indent(t, depth);
+        ndl_puts(t, "}\n");
+      } else if (tag(e) == t_repeatexpr) {
+        ndl_indent(t, depth);
+        ndl_puts(t, "do {\n");
+        ndl_stmt(t, get_rexprseq(e), NULL, depth + 1);
+        ndl_indent(t, depth);
+        ndl_puts(t, "} while (!ndl_bad && (");
+        ndl_test(t, get_rtest(e));
+        ndl_puts(t, ") == 0);\n");
+      } else {
+        /* only FOR I WITH tell N DO, counted in c_k so that I keeps
+           its last value */
+        nialptr idlist = get_idlist(e),
+                range = ndl_unwrap(get_expr(e)),
+                var;
+        int lim = ndl.nlimits++;
+
+        if (tally(idlist) != 2 || tag(range) != t_opcall ||
+            tag(get_op(range)) != t_basic ||
+            strcmp(pfirstchar(bnames[get_index(get_op(range))]), "TELL") != 0) {
+          ndl_fail("a FOR loop not over TELL in", ndl.names[ndl.curop]);
+          ndl.loopdepth--;
+          break;
+        }
+        var = fetch_array(idlist, 1);
+        if (get_sym(var) == global_symtab) {
+          ndl_fail("the global variable", get_var_pv(var));
+          ndl.loopdepth--;
+          break;
+        }
+        if ((i = ndl_local(var)) < 0) {
+          ndl.loopdepth--;
+          break;
+        }
+        ndl_indent(t, depth);
+        ndl_printf(t, "n_%d = ", lim);
+        ty = ndl_expr(t, get_argexpr(range));
+        ndl_puts(t, ";\n");
+        if (ty == ty_bool || ty == ty_real)
+          ndl_untyped("TELL of a number that is not an integer in");
+        ndl_indent(t, depth);
+        ndl_printf(t, "if (n_%d < 0)\n", lim);
+        ndl_indent(t, depth + 1);
+        ndl_puts(t, "ndl_bad = 1;\n");
+        ndl_indent(t, depth);
+        ndl_printf(t, "for (c_%d = 0; !ndl_bad && c_%d < n_%d; c_%d++) {\n", lim, lim, lim, lim);
+        ndl_indent(t, depth + 1);
+        ndl_cname(t, "v_", get_var_pv(var));
+        ndl_printf(t, " = c_%d;\n", lim);
+        ndl_settype(&v->locals[i], ty_int, "a variable given values of different types in");
+        ndl.assigned[i] = true;
+        ndl_stmt(t, get_fexprseq(e), NULL, depth + 1);
+        ndl_indent(t, depth);
+        ndl_puts(t, "}\n");
+      }
+      ndl.loopdepth--;
+      memcpy(ndl.assigned, before, sizeof before);
+      break;
+
+    case t_exit:
+      if (ndl.loopdepth == 0) {
+        ndl_fail("an EXIT outside a loop in", ndl.names[ndl.curop]);
+        break;
+      }
+      ndl_stmt(t, get_eexprseq(e), NULL, depth);
+      ndl_indent(t, depth);
+      ndl_puts(t, "break;\n");
+      break;
+
+    default:
+      ndl_indent(t, depth);
+      if (target != NULL)
+        ndl_printf(t, "%s = ", target);
+      else
+        ndl_puts(t, "(void) ");
+      ty = ndl_expr(t, e);
+      ndl_puts(t, ";\n");
+      if (target != NULL)
+        ndl_settype(&v->result, ty, "results of different types in");
+  }
+}
+
+/* Put the header of the C function for version vi */
+static void ndl_header(NdlText *t, nialint vi) {
+  NdlVersion *v = &ndl.versions[vi];
+  nialptr args = get_arglist(ndl.forms[v->op]);
+  nialint i;
+
+  ndl_printf(t, "static %s ", ndl_ctype(v->result));
+  ndl_vname(t, "k_", vi);
+  ndl_puts(t, "(");
+  for (i = 1; i < tally(args); i++) {
+    if (i > 1)
+      ndl_puts(t, ", ");
+    ndl_puts(t, ndl_ctype(v->params[i - 1]));
+    ndl_cname(t, " v_", get_var_pv(fetch_array(args, i)));
+  }
+  ndl_puts(t, (tally(args) == 1 ? "void)" : ")"));
+}
+
+/* Put the C function for version vi. This also finds the types of its
+   locals and result from those of its parameters. */
+static void ndl_function(NdlText *t, nialint vi) {
+  NdlVersion *v = &ndl.versions[vi];
+  nialint k = v->op;
+  nialptr form = ndl.forms[k],
+          args = get_arglist(form),
+          body = get_body(form);
+  NdlText b = {NULL, 0, 0};
+  nialint i;
+
+  ndl.cur = vi;
+  ndl.curop = k;
+  ndl.nlocals = 0;
+  ndl.loopdepth = 0;
+  ndl.nlimits = 0;
+  memset(ndl.assigned, false, sizeof ndl.assigned);
+  for (i = 1; i < tally(args); i++)
+    ndl_local(fetch_array(args, i));
+  ndl.nparams = ndl.nlocals;
+  if (ndl.nparams != ndl.nargs[k])
+    ndl_fail("a repeated parameter in", ndl.names[k]);
+  for (i = 0; i < ndl.nparams; i++) {
+    v->locals[i] = v->params[i];
+    ndl.assigned[i] = true;
+  }
+  if (tag(body) == t_blockbody) {
+    if (get_defs(body) != grounded)
+      ndl_fail("local definitions in", ndl.names[k]);
+    else if (tally(get_nonlocallist(body)) > 1)
+      ndl_fail("nonlocal variables in", ndl.names[k]);
+    body = get_seq(body);
+  }
+  ndl_stmt(&b, body, "result", 1);
+
+  ndl_header(t, vi);
+  ndl_printf(t, "\n{\n  %s result = 0;\n", ndl_ctype(v->result));
+  for (i = ndl.nparams; i < ndl.nlocals; i++) {
+    ndl_printf(t, "  %s", ndl_ctype(v->locals[i]));
+    ndl_cname(t, " v_", sym_name(ndl.locals[i]));
+    ndl_puts(t, " = 0;\n");
+  }
+  for (i = 0; i < ndl.nlimits; i++)
+    ndl_printf(t, "  ndl_int n_%d, c_%d;\n", (int) i, (int) i);
+  ndl_puts(t, "\n  if (ndl_bad)\n    return result;\n");
+  if (b.s != NULL)
+    ndl_puts(t, b.s);
+  ndl_puts(t, "  return result;\n}\n\n");
+  free(b.s);
+}
+
+/* Put the entry point ndlCall uses for version vi. It gives a true
+   result if the value is not the one Nial gives. */
+static void ndl_entry(NdlText *t, nialint vi) {
+  NdlVersion *v = &ndl.versions[vi];
+  nialint i, n = ndl.nargs[v->op];
+
+  ndl_vname(t, "int nialk_", vi);
+  ndl_puts(t, "(const ndl_value *a, ndl_value *z)\n{\n  ndl_bad = 0;\n");
+  for (i = 0; i < n; i++)
+    if (v->params[i] == ty_real)
+      ndl_printf(t, "  if (!isfinite(a[%d].r))\n    return 1;\n", (int) i);
+  ndl_puts(t, (v->result == ty_real ? "  z->r = " : "  z->i = "));
+  ndl_vname(t, "k_", vi);
+  ndl_puts(t, "(");
+  for (i = 0; i < n; i++)
+    ndl_printf(t, "%sa[%d].%s", (i > 0 ? ", " : ""), (int) i,
+               (v->params[i] == ty_real ? "r" : "i"));
+  ndl_puts(t, ");\n  return ndl_bad;\n}\n\n");
+}
+
+/* Find the types in the versions of the operations, starting from the
+   versions for integer and for real arguments of each. Each pass
+   translates every version that is not bad, and the passes stop when
+   one changes nothing. A value whose type is still not found then
+   makes its version bad, which can change its callers. */
+static void ndl_types(void) {
+  int ty[NDL_MAXARGS];
+  nialint i, j, a;
+
+  ndl.nversions = 0;
+  for (i = 0; i < ndl.nops; i++)
+    for (j = 0; j < 2; j++) {
+      for (a = 0; a < ndl.nargs[i]; a++)
+        ty[a] = (j == 0 ? ty_int : ty_real);
+      ndl.entry[i][j] = ndl_version(i, ty);
+    }
+  do {
+    ndl.changed = false;
+    for (i = 0; i < ndl.nversions && !ndl.failed; i++)
+      if (!ndl.versions[i].bad) {
+        NdlText t = {NULL, 0, 0};
+
+        ndl.versions[i].unknown = false;
+        ndl_function(&t, i);
+        free(t.s);
+      }
+    if (!ndl.changed && !ndl.failed)
+      for (i = 0; i < ndl.nversions; i++)
+        if (!ndl.versions[i].bad && ndl.versions[i].unknown) {
+          ndl.cur = i;
+          ndl_untyped("a value whose type cannot be found in");
+        }
+  } while (ndl.changed && !ndl.failed);
+
+  /* an operation needs a version for integers or reals */
+  for (i = 0; i < ndl.nops && !ndl.failed; i++)
+    if (ndl.versions[ndl.entry[i][0]].bad && ndl.versions[ndl.entry[i][1]].bad)
+      ndl_fail(ndl.versions[ndl.entry[i][0]].why, ndl.names[i]);
+}
+
+/* Look up the operations named by x and translate them. The result is
+   the C text, or NULL with the reason in ndl.err. */
+static char *ndl_translate(nialptr x) {
+  NdlText t = {NULL, 0, 0};
+  nialint n, i;
+
+  ndl.failed = false;
+  ndl.nops = 0;
+  n = (istext(x) ? 1 : tally(x));
+  if (kind(x) != atype && !istext(x)) {
+    ndl_fail("expecting the names of operations", invalidptr);
+    return NULL;
+  }
+  if (n > NDL_MAXOPS) {
+    ndl_fail("too many operations", invalidptr);
+    return NULL;
+  }
+  for (i = 0; i < n && !ndl.failed; i++) {
+    nialptr nm = (istext(x) ? x : fetch_array(x, i)),
+            entr;
+    char buf[MAXIDSIZE + 1];
+
+    if (!istext(nm) || tally(nm) == 0) {
+      ndl_fail("expecting the names of operations", invalidptr);
+      break;
+    }
+    strncpy(buf, pfirstchar(nm), MAXIDSIZE);
+    buf[MAXIDSIZE] = '\0';
+    cnvtup(buf);
+    nm = makephrase(buf);
+    entr = symfind(global_symtab, nm);
+    if (entr == notfound || sym_role(entr) != Roptn ||
+        tag(sym_valu(entr)) != t_opform) {
+      ndl_fail("not an operation form:", nm);
+      freeup(nm);
+      break;
+    }
+    /* the names are held by the symbol table */
+    ndl.names[i] = sym_name(entr);
+    ndl.nops = i + 1;
+    ndl.forms[i] = sym_valu(entr);
+    ndl.nargs[i] = tally(get_arglist(ndl.forms[i])) - 1;
+    if (ndl.nargs[i] > NDL_MAXARGS)
+      ndl_fail("too many parameters in", ndl.names[i]);
+  }
+  if (!ndl.failed)
+    ndl_types();
+
+  if (!ndl.failed) {
+    ndl_puts(&t, "/* generated by ndlCompile */\n\n#include <math.h>\n#include <limits.h>\n\n");
+    ndl_printf(&t, "typedef %s ndl_int;\n\n#define NDL_INTMIN %s\n\n",
+               (sizeof(nialint) == sizeof(int) ? "int" : "long long"),
+               (sizeof(nialint) == sizeof(int) ? "INT_MIN" : "LLONG_MIN"));
+    ndl_puts(&t, ndl_prelude);
+    for (i = 0; i < ndl.nversions; i++)
+      if (!ndl.versions[i].bad) {
+        ndl_header(&t, i);
+        ndl_puts(&t, ";\n");
+      }
+    ndl_puts(&t, "\n");
+    for (i = 0; i < ndl.nversions && !ndl.failed; i++)
+      if (!ndl.versions[i].bad)
+        ndl_function(&t, i);
+    for (i = 0; i < n; i++) {
+      if (!ndl.versions[ndl.entry[i][0]].bad)
+        ndl_entry(&t, ndl.entry[i][0]);
+      if (ndl.entry[i][1] != ndl.entry[i][0] && !ndl.versions[ndl.entry[i][1]].bad)
+        ndl_entry(&t, ndl.entry[i][1]);
+    }
+  }
+  if (ndl.failed) {
+    free(t.s);
+    return NULL;
+  }
+  return t.s;
+}
+
+
+/**
+ * Give the C text that ndlCompile builds for a set of operations as a
+ * list of lines
+ */
+void indlCsource(void) {
+  nialptr x = apop();
+  char *text = ndl_translate(x);
+
+  if (text == NULL) {
+    apush(makefault(ndl.err));
+  } else {
+    char *line = text, *nl;
+    nialint n = 0;
+
+    while ((nl = strchr(line, '\n')) != NULL) {
+      *nl = '\0';
+      apush(makestring(line));
+      n++;
+      line = nl + 1;
+    }
+    mklist(n);
+    free(text);
+  }
+  freeup(x);
+}
+
+
+/* Run the compiler cc on cfile giving sofile. The command is split
+   into words at spaces and run without a shell. The result is 0 if it
+   succeeds. */
+static int ndl_runcc(const char *cc, const char *sofile, const char *cfile) {
+  char words[1024], *argv[NDL_MAXWORDS + 5], *w;
+  int argc = 0, status;
+  pid_t pid;
+
+  if (strlen(cc) >= sizeof words)
+    return -1;
+  strcpy(words, cc);
+  for (w = strtok(words, " \t"); w != NULL; w = strtok(NULL, " \t")) {
+    if (argc == NDL_MAXWORDS)
+      return -1;
+    argv[argc++] = w;
+  }
+  if (argc == 0)
+    return -1;
+  argv[argc++] = "-o";
+  argv[argc++] = (char *) sofile;
+  argv[argc++] = (char *) cfile;
+  argv[argc++] = "-lm";
+  argv[argc] = NULL;
+  fflush(NULL);
+  pid = fork();
+  if (pid < 0)
+    return -1;
+  if (pid == 0) {
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+  while (waitpid(pid, &status, 0) < 0)
+    if (errno != EINTR)
+      return -1;
+  return (WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1);
+}
+
+/* Get the kind of result a version gives */
+static nialint ndl_resultkind(nialint vi) {
+  int ty = ndl.versions[vi].result;
+
+  return (ty == ty_bool ? booltype : ty == ty_int ? inttype : realtype);
+}
+
+/**
+ * Compile a set of operations to a shared library and load it. The
+ * result is a handle for ndlCall for each operation, or one handle if
+ * a single name is given.
+ */
+void indlCompile(void) {
+  nialptr x = apop();
+  char *text = ndl_translate(x);
+  char dir[512], cfile[540], sofile[540];
+  const char *tmpdir = getenv("TMPDIR"),
+             *cc = getenv("NIALCC");
+  nialint n = (istext(x) ? 1 : tally(x)), i, j;
+  void *dlp = NULL;
+  FILE *f;
+  int fd, ok;
+
+  if (text == NULL) {
+    apush(makefault(ndl.err));
+    freeup(x);
+    return;
+  }
+  if (tmpdir == NULL || *tmpdir == '\0')
+    tmpdir = "/tmp";
+  if (cc == NULL || *cc == '\0')
+    cc = NDL_COMPILER;
+  /* the files go in a new directory only this user can write */
+  snprintf(dir, sizeof dir, "%s/nialkXXXXXX", tmpdir);
+  if (mkdtemp(dir) == NULL) {
+    free(text);
+    apush(makefault("?ndlCompile: cannot create a temporary directory"));
+    freeup(x);
+    return;
+  }
+  snprintf(cfile, sizeof cfile, "%s/k.c", dir);
+  snprintf(sofile, sizeof sofile, "%s/k.so", dir);
+  fd = open(cfile, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd >= 0) {
+    f = fdopen(fd, "w");
+    if (f == NULL)
+      close(fd);
+    else {
+      ok = (fputs(text, f) >= 0);
+      if (fclose(f) == 0 && ok && ndl_runcc(cc, sofile, cfile) == 0)
+        dlp = dlopen(sofile, RTLD_NOW|RTLD_LOCAL);
+    }
+  }
+  free(text);
+  /* the library stays mapped after its files are removed */
+  unlink(cfile);
+  unlink(sofile);
+  rmdir(dir);
+  if (dlp == NULL) {
+    apush(makefault("?ndlCompile: C compilation failed"));
+    freeup(x);
+    return;
+  }
+
+  for (i = 0; i < n; i++) {
+    KernelCast kcast;
+    void *sym[2];
+
+    for (j = 0; j < 2; j++) {
+      NdlText t = {NULL, 0, 0};
+      nialint vi = ndl.entry[i][j];
+
+      sym[j] = NULL;
+      if (!ndl.versions[vi].bad) {
+        ndl_vname(&t, "nialk_", vi);
+        sym[j] = (t.s == NULL ? NULL : dlsym(dlp, t.s));
+      }
+      free(t.s);
+    }
+    kcast.castType = NDL_KERNEL_CAST;
+    kcast.intVersion = sym[0];
+    kcast.realVersion = sym[1];
+    kcast.nargs = ndl.nargs[i];
+    kcast.intResult = ndl_resultkind(ndl.entry[i][0]);
+    kcast.realResult = ndl_resultkind(ndl.entry[i][1]);
+    if (sym[0] == NULL && sym[1] == NULL) {
+      apush(makefault("?ndlCompile: symbol not found"));
+    } else {
+      /* the handle keeps the form for the arguments the code does not cover */
+      apush(NDL_COPY_STRUCT(KernelCast, &kcast));
+      apush(ndl.forms[i]);
+      mklist(2);
+    }
+  }
+  ndl.nops = 0;
+  if (!istext(x))
+    mklist(n);
+  freeup(x);
+}
+
+
+/* Get item i of a numeric array of kind inttype or realtype */
+static void ndl_getvalue(NdlValue *v, nialptr a, nialint i) {
+  if (kind(a) == inttype)
+    v->i = fetch_int(a, i);
+  else
+    v->r = fetch_real(a, i);
+}
+
+/**
+ * Apply a compiled operation to its arguments. Each argument is a
+ * number or an array of numbers, the arrays all of the same shape, and
+ * the operation is applied to corresponding items. The operation form
+ * is applied instead where the arguments are not all integers or all
+ * reals, or where the compiled code notes that its value is not the
+ * one Nial gives.
+ */
+static void ndl_kernelcall(KernelCast *k, nialptr form, nialptr args) {
+  nialptr items[NDL_MAXARGS], shp = invalidptr, z;
+  NdlValue av[NDL_MAXARGS], res;
+  NialKernel f = NULL;
+  nialint n = k->nargs, rk = realtype, t = 0, i, j;
+  int ak = -1, simple = false;
+
+  if (n < 1 || n > NDL_MAXARGS)
+    goto interpret;
+  if (n == 1)
+    items[0] = args;
+  else if (tally(args) != n)
+    goto interpret;
+  else if (kind(args) != atype)
+    simple = true;              /* a simple list of numbers */
+  else
+    for (i = 0; i < n; i++)
+      items[i] = fetch_array(args, i);
+
+  if (simple)
+    ak = kind(args);
+  else
+    for (i = 0; i < n; i++) {
+      nialptr a = items[i];
+
+      if (i == 0)
+        ak = kind(a);
+      else if (kind(a) != ak)
+        goto interpret;
+      if (!atomic(a)) {
+        if (shp == invalidptr) {
+          shp = a;
+          t = tally(a);
+        } else if (!equalshape(shp, a))
+          goto interpret;
+      }
+    }
+  if (ak == inttype) {
+    f = (NialKernel) k->intVersion;
+    rk = k->intResult;
+  } else if (ak == realtype) {
+    f = (NialKernel) k->realVersion;
+    rk = k->realResult;
+  }
+  if (f == NULL)
+    goto interpret;
+
+  for (i = 0; i < n; i++)
+    if (simple)
+      ndl_getvalue(&av[i], args, i);
+    else if (atomic(items[i]))
+      ndl_getvalue(&av[i], items[i], 0);
+  if (shp == invalidptr) {
+    if ((f)(av, &res) != 0)
+      goto interpret;
+    apush(rk == realtype ? createreal(res.r) :
+          rk == inttype ? createint(res.i) : createbool(res.i));
+    return;
+  }
+
+  z = new_create_array(rk, valence(shp), 0, shpptr(shp, valence(shp)));
+  for (j = 0; j < t; j++) {
+    for (i = 0; i < n; i++)
+      if (!atomic(items[i]))
+        ndl_getvalue(&av[i], items[i], j);
+    if ((f)(av, &res) != 0)
+      break;
+    if (rk == realtype)
+      store_real(z, j, res.r);
+    else if (rk == inttype)
+      store_int(z, j, res.i);
+    else
+      store_bool(z, j, res.i);
+  }
+  if (j == t) {
+    apush(z);
+    return;
+  }
+  freeup(z);
+
+  /* apply the form to each set of corresponding items */
+  z = new_create_array(atype, valence(shp), 0, shpptr(shp, valence(shp)));
+  for (j = 0; j < t; j++) {
+    for (i = 0; i < n; i++)
+      apush(atomic(items[i]) ? items[i] : fetchasarray(items[i], j));
+    if (n > 1)
+      mklist(n);
+    apply(form);
+    store_array(z, j, apop());
+  }
+  if (homotest(z))
+    z = implode(z);
+  apush(z);
+  return;
+
+interpret:
+  apush(args);
+  apply(form);
+}
+
+
 #endif /* NDYNLOAD */
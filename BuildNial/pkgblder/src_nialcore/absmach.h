@@ -51,7 +51,8 @@ used for referring to the array the block contains. They relate by
            block address + hdrsize = array address.
 
 The block header size is an even number of nialints to ensure that the array
-address is aligned. The tally field in the header is redundant, it could
+address is aligned. (The COMPACTHEADER build option, for 64 bit systems,
+implements the short header idea mentioned below; see the tally macros.) The tally field in the header is redundant, it could
 be computed from the shape, but is included to take advantage of the space
 needed to ensure alignment. (An experiment could be tried with a header
 size of two words, moving the reference count to the end of the block.
@@ -78,6 +79,9 @@ The macros that refer to array properties use the array address,
 the ones that refer to memory management use the block address.
 
 The heap management is done with a double linked list of free areas.
+(When SIZECLASSES is set the free areas are instead held in exact size
+class lists for small blocks and a best fit tree for large ones. See
+absmach.c.)
 A free block can be detected from either end. From the front, the
 refcnt field of the header is -1 for a free block or >=0 for an
 allocated array. From the end, the last word is a negative number whose
@@ -120,6 +124,7 @@ in situations where a large number of small free blocks are generated.
 #define FREETAG (-1)         /* indicates that the block is free. */
 #define TERMINATOR (-3)      /* used to terminate the fwdlink chain */
 #define LOCKEDBLOCK (-5)     /* used for the final block in freelist */
+#define SLABTAG (-7)         /* used for blocks held in the atom slab */
 
 /* size field */
 #define blksize(bx)   ((nialhdr*)&mem[bx])->size
@@ -129,6 +134,7 @@ in situations where a large number of small free blocks are generated.
 #define freetag(bx)   ((nialhdr*)&mem[bx])->ref_count
 #define set_freetag(bx) ((nialhdr*)&mem[bx])->ref_count = FREETAG
 #define set_lockedtag(bx) ((nialhdr*)&mem[bx])->ref_count = LOCKEDBLOCK
+#define set_slabtag(bx) ((nialhdr*)&mem[bx])->ref_count = SLABTAG
 #define reset_freetag(bx)   ((nialhdr*)&mem[bx])->ref_count = 0
 
 /* allocated or free tests */
@@ -141,13 +147,14 @@ in situations where a large number of small free blocks are generated.
 #define fwdlink(bx)   ((nialhdr*)&mem[bx])->hdrdata.free_block.fwd_link
 #define bcklink(bx)   ((nialhdr*)&mem[bx])->hdrdata.free_block.bck_link
 
-/* trailer handling macros */
-#define endptr(bx) *(((nialptr*)&mem[bx+blksize(bx)])-1)
+/* trailer handling macros. The trailer is a whole word even when
+   nialptr is shorter */
+#define endptr(bx) *(((nialint*)&mem[bx+blksize(bx)])-1)
 #define set_endinfo(bx) endptr(bx) = (-bx)
 #define reset_endinfo(bx) endptr(bx) = 0
 
-#define isprevfree(bx) (*(((nialptr*)&mem[bx])-1) < 0)
-#define prevblk(bx) (-(*(((nialptr*)&mem[bx])-1)))
+#define isprevfree(bx) (*(((nialint*)&mem[bx])-1) < 0)
+#define prevblk(bx) (-(*(((nialint*)&mem[bx])-1)))
 
 /* macro to get array pointer from block pointer */
 #define arrayptr(bx) (bx+hdrsize)
@@ -170,16 +177,49 @@ struct skv {
   short       val;
 };
 
-#define sorted(x) ((nialhdr*)&mem[blockptr(x)])->hdrdata.allocatedblock.flags.skv.sk[0]
-#define is_sorted(x) (sorted(x)==1)
+#ifdef COMPACTHEADER
+
+/* In the compact header layout the sort flag, kind and valence share
+   the second header word with a 32 bit reference count. The tally is
+   not held in the header. It is 1 for valence 0, is the single extent
+   for valence 1, and is kept in the last word of the block, after the
+   shape, for higher valences. This lets atoms and pairs fit in the
+   minimum block of 5 words instead of 8. */
+
+#define sorted(x) ((nialcompacthdr*)&mem[blockptr(x)])->skv.sk[0]
+#define kind(x) ((nialcompacthdr*)&mem[blockptr(x)])->skv.sk[1]
+#define valence(x) ((nialcompacthdr*)&mem[blockptr(x)])->skv.val
 
+#else
+
+#define sorted(x) ((nialhdr*)&mem[blockptr(x)])->hdrdata.allocatedblock.flags.skv.sk[0]
 #define kind(x) ((nialhdr*)&mem[blockptr(x)])->hdrdata.allocatedblock.flags.skv.sk[1]
 #define valence(x) ((nialhdr*)&mem[blockptr(x)])->hdrdata.allocatedblock.flags.skv.val
 
+#endif
+
+#define is_sorted(x) (sorted(x)==1)
+
 #define set_kind(x,k) kind(x) = (char) k
 #define set_valence(x,v) valence(x) = v
 #define set_sorted(x,s) sorted(x) = (char) s
 
+#ifdef COMPACTHEADER
+
+/* reference count field */
+#define refcnt(x) ((nialcompacthdr*)&mem[blockptr(x)])->ref_count
+#define set_refcnt(x,y)    refcnt(x) = y
+
+/* tally. Set after the valence and before the shape. */
+#define lastword(x) (*(((nialint*)&mem[blockptr(x)+blksize(blockptr(x))])-1))
+#define tally(x) (valence(x) == 0 ? (nialint)1 : lastword(x))
+#define set_tally(x,n) { if (valence(x) > 1) lastword(x) = n; }
+
+/* macro to get the shape */
+#define shpptr(x,v) (((nialint*)&mem[blockptr(x)+blksize(blockptr(x))])-(v)-((v) > 1))
+
+#else
+
 /* reference count field */
 #define refcnt(x) ((nialhdr*)&mem[blockptr(x)])->ref_count
 #define set_refcnt(x,y)    refcnt(x) = y
@@ -192,6 +232,8 @@ struct skv {
 /* macro to get the shape */
 #define shpptr(x,v) (((nialint*)&mem[blockptr(x)+blksize(blockptr(x))])-v)
 
+#endif
+
 
 /* macros to get appropriately typed C pointers
   to the beginning of the data */
@@ -380,6 +422,8 @@ extern void deallocate_atomtbl(void);
 extern void freeit(nialptr x);
 extern nialint pickshape(nialptr x, nialint i);
 extern nialptr new_create_array(int k, int v, nialint t, nialint *extents);
+extern nialptr new_create_list(int k, nialint n, nialint room);
+extern nialint listroom(nialptr x);
 extern nialptr stackempty(void);
 
 extern nialptr createatom(unsigned int k, char *s);
@@ -452,11 +496,27 @@ extern void growstack(void);
 extern int  homotest(nialptr x);
 extern nialint checkavailspace(void);
 extern void checkfortemps(void);
+extern void reset_heapstats(void);
+extern void settle_heap(void);
+extern void flush_atomslab(void);
+#ifdef SIZECLASSES
+extern void clear_freelists(void);
+extern void link_free_block(nialptr bx, nialint n);
+#ifdef DEBUG
+extern void chkfreelists(void);
+extern int  onfreelist(nialptr bx);
+#endif
+#endif
+#ifdef HEAPCOMPACTION
+extern void heap_safepoint(void);
+#endif
 
 extern int doprintf;
 
 
+#ifndef RESERVEDHEAP
 #define my_realloc(p,s,os) realloc(p,s)
+#endif
 
 
 /* defines to hanlde case insensitive string compares */
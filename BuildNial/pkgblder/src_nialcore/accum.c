@@ -0,0 +1,392 @@
+/*==============================================================
+
+  MODULE   ACCUM.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+
+  ACCUMULATE of the associative primitives on homogeneous arrays.
+
+================================================================*/
+
+/* ACCUMULATE f A with f one of + (plus), * (times), max, min, and, or
+   and xor is done by leftaccumulate in trs.c, which applies f to each
+   partial result and the next item through the stack. When A is an
+   array of integers, reals or truth-values this module computes the
+   partial results in a C loop instead.
+
+   Integer sums and maxima and minima of integers and reals are scanned
+   in two passes over the parts used by par_for, so that a large array
+   is done on several threads: the first pass combines the items of
+   each part, the parts are then combined in order to give the value
+   each part starts from, and the second pass computes the partial
+   results of each part from its starting value. These operations are
+   exact and associative, so the result is the same as a left to right
+   scan. A NaN item, for which max and min are not associative, makes
+   the real scan run serially. Real sums and products are scanned
+   serially so that the rounding is that of the left to right order.
+
+   An integer overflow makes accumulate_scan give up and leftaccumulate
+   then produces the faults as before.
+*/
+
+#include "switches.h"
+
+#ifdef NATIVESCAN
+
+/* standard library header files */
+
+/* IOLIB */
+#include <stdio.h>
+
+/* STLIB */
+#include <stdlib.h>
+
+/* SJLIB */
+#include <setjmp.h>
+
+/* Q'Nial header files */
+
+#include "accum.h"
+#include "qniallim.h"
+#include "absmach.h"
+#include "basics.h"
+#include "lib_main.h"
+
+#include "arith.h"           /* for safeintadd etc. */
+#include "blders.h"          /* for tag */
+#include "getters.h"         /* for get_index */
+#include "parse.h"           /* for t_basic */
+#include "parallel.h"        /* for par_for */
+
+
+enum {
+  sc_none, sc_plus, sc_times, sc_max, sc_min, sc_and, sc_or, sc_xor
+};
+
+/* the state of a two pass scan. start[p] is the value part p starts from
+   and fold[p] the items of part p combined. */
+
+typedef struct {
+  int         op;
+  nialint     chunk;
+  void       *x,
+             *z;
+  nialint     ifold[PARMAXTHREADS],
+              istart[PARMAXTHREADS];
+  double      rfold[PARMAXTHREADS],
+              rstart[PARMAXTHREADS];
+} scanstate;
+
+static scanstate sc;
+
+/* the combination used by b_max and b_min for a partial result r and
+   the next item */
+
+#define MAXOF(r, it) ((r) >= (it) ? (r) : (it))
+#define MINOF(r, it) ((r) <= (it) ? (r) : (it))
+
+
+/* first pass for integers. An overflow in the sum of a part makes the
+   scan give up even if no partial sum of the whole array overflows. */
+
+static int
+intfold(nialint lo, nialint hi, void *arg)
+{
+  scanstate  *s = arg;
+  nialint    *x = s->x,
+              p = lo / s->chunk,
+              r = x[lo],
+              i;
+
+  switch (s->op) {
+    case sc_plus:
+        for (i = lo + 1; i < hi; i++)
+          if (safeintadd(r, x[i], &r))
+            return false;
+        break;
+    case sc_max:
+        for (i = lo + 1; i < hi; i++)
+          r = MAXOF(r, x[i]);
+        break;
+    case sc_min:
+        for (i = lo + 1; i < hi; i++)
+          r = MINOF(r, x[i]);
+        break;
+  }
+  s->ifold[p] = r;
+  return true;
+}
+
+/* second pass for integers. Every partial sum is checked, so an overflow
+   is found here if the parts did not overflow. */
+
+static int
+intprefix(nialint lo, nialint hi, void *arg)
+{
+  scanstate  *s = arg;
+  nialint    *x = s->x,
+             *z = s->z,
+              p = lo / s->chunk,
+              r,
+              i;
+
+  if (p == 0) {
+    r = x[0];
+    z[lo++] = r;
+  }
+  else
+    r = s->istart[p];
+  switch (s->op) {
+    case sc_plus:
+        for (i = lo; i < hi; i++) {
+          if (safeintadd(r, x[i], &r))
+            return false;
+          z[i] = r;
+        }
+        break;
+    case sc_max:
+        for (i = lo; i < hi; i++)
+          z[i] = r = MAXOF(r, x[i]);
+        break;
+    case sc_min:
+        for (i = lo; i < hi; i++)
+          z[i] = r = MINOF(r, x[i]);
+        break;
+  }
+  return true;
+}
+
+static int
+intscan(nialptr x, nialptr z, int op)
+{
+  nialint     n = tally(x);
+  int         parts = par_parts(n),
+              p;
+
+  sc.op = op;
+  sc.chunk = PARCHUNK(n, parts);
+  sc.x = pfirstint(x);
+  sc.z = pfirstint(z);
+
+  if (op == sc_times) {      /* done serially */
+    nialint    *px = sc.x,
+               *pz = sc.z,
+                r = px[0],
+                i;
+
+    pz[0] = r;
+    for (i = 1; i < n; i++) {
+      if (safeintmult(r, px[i], &r))
+        return false;
+      pz[i] = r;
+    }
+    return true;
+  }
+
+  if (parts > 1) {
+    if (!par_for(n, intfold, &sc))
+      return false;
+    /* combine the parts in order to get the value each starts from */
+    sc.istart[1] = sc.ifold[0];
+    for (p = 2; p < parts; p++) {
+      nialint     prev = sc.istart[p - 1],
+                  it = sc.ifold[p - 1];
+
+      if (op == sc_plus) {
+        if (safeintadd(prev, it, &sc.istart[p]))
+          return false;
+      }
+      else
+        sc.istart[p] = (op == sc_max ? MAXOF(prev, it) : MINOF(prev, it));
+    }
+  }
+  return (par_for(n, intprefix, &sc));
+}
+
+/* first pass for reals, max and min only. A NaN makes it fail. */
+
+static int
+realfold(nialint lo, nialint hi, void *arg)
+{
+  scanstate  *s = arg;
+  double     *x = s->x,
+              r = x[lo];
+  nialint     p = lo / s->chunk,
+              i;
+
+  if (r != r)
+    return false;
+  for (i = lo + 1; i < hi; i++) {
+    double      it = x[i];
+
+    if (it != it)
+      return false;
+    r = (s->op == sc_max ? MAXOF(r, it) : MINOF(r, it));
+  }
+  s->rfold[p] = r;
+  return true;
+}
+
+static int
+realprefix(nialint lo, nialint hi, void *arg)
+{
+  scanstate  *s = arg;
+  double     *x = s->x,
+             *z = s->z,
+              r;
+  nialint     p = lo / s->chunk,
+              i;
+
+  if (p == 0) {
+    r = x[0];
+    z[lo++] = r;
+  }
+  else
+    r = s->rstart[p];
+  if (s->op == sc_max)
+    for (i = lo; i < hi; i++)
+      z[i] = r = MAXOF(r, x[i]);
+  else
+    for (i = lo; i < hi; i++)
+      z[i] = r = MINOF(r, x[i]);
+  return true;
+}
+
+static void
+realscan(nialptr x, nialptr z, int op)
+{
+  nialint     n = tally(x);
+  int         parts = par_parts(n),
+              p;
+
+  sc.op = op;
+  sc.chunk = PARCHUNK(n, parts);
+  sc.x = pfirstreal(x);
+  sc.z = pfirstreal(z);
+
+  if ((op == sc_max || op == sc_min) && parts > 1 && par_for(n, realfold, &sc)) {
+    sc.rstart[1] = sc.rfold[0];
+    for (p = 2; p < parts; p++)
+      sc.rstart[p] = (op == sc_max ? MAXOF(sc.rstart[p - 1], sc.rfold[p - 1]) :
+                      MINOF(sc.rstart[p - 1], sc.rfold[p - 1]));
+    par_for(n, realprefix, &sc);
+  }
+  else {                     /* done serially from left to right */
+    double     *px = sc.x,
+               *pz = sc.z,
+                r = px[0];
+    nialint     i;
+
+    pz[0] = r;
+    for (i = 1; i < n; i++) {
+      double      it = px[i];
+
+      switch (op) {
+        case sc_plus:
+            r = r + it;
+            break;
+        case sc_times:
+            r = r * it;
+            break;
+        case sc_max:
+            r = MAXOF(r, it);
+            break;
+        case sc_min:
+            r = MINOF(r, it);
+            break;
+      }
+      pz[i] = r;
+    }
+  }
+}
+
+/* the scans of truth-values */
+
+static void
+boolscan(nialptr x, nialptr z, int op)
+{
+  nialint     n = tally(x),
+              i;
+  int         r = fetch_bool(x, 0);
+
+  store_bool(z, 0, r);
+  for (i = 1; i < n; i++) {
+    int         it = fetch_bool(x, i);
+
+    r = (op == sc_and ? r && it : op == sc_or ? r || it : r ^ it);
+    store_bool(z, i, r);
+  }
+}
+
+/* routine to give the scan done for the primitive f */
+
+static int
+scanop(nialptr f)
+{
+  void        (*g) (void);
+
+  if (tag(f) != t_basic)
+    return sc_none;
+  g = applytab[get_index(f)];
+  if (g == isum || g == iplus)
+    return sc_plus;
+  if (g == iproduct || g == itimes)
+    return sc_times;
+  if (g == imax)
+    return sc_max;
+  if (g == imin)
+    return sc_min;
+  if (g == iand)
+    return sc_and;
+  if (g == ior)
+    return sc_or;
+  if (g == ixor)
+    return sc_xor;
+  return sc_none;
+}
+
+/* routine to compute ACCUMULATE f x for an array x of at least two items.
+   The result is invalidptr if it is not done here. */
+
+nialptr
+accumulate_scan(nialptr f, nialptr x)
+{
+  int         op = scanop(f),
+              k = kind(x),
+              v = valence(x);
+  nialptr     z;
+
+  if (op == sc_none || tally(x) < 2)
+    return invalidptr;
+  switch (k) {
+    case inttype:
+        if (op >= sc_and)
+          return invalidptr;
+        z = new_create_array(inttype, v, 0, shpptr(x, v));
+        if (!intscan(x, z, op)) {
+          freeup(z);
+          return invalidptr;
+        }
+        return z;
+    case realtype:
+        if (op >= sc_and)
+          return invalidptr;
+        z = new_create_array(realtype, v, 0, shpptr(x, v));
+        realscan(x, z, op);
+        return z;
+    case booltype:           /* max and min are or and and */
+        if (op == sc_max)
+          op = sc_or;
+        else if (op == sc_min)
+          op = sc_and;
+        if (op < sc_and)
+          return invalidptr;
+        z = new_create_array(booltype, v, 0, shpptr(x, v));
+        boolscan(x, z, op);
+        return z;
+  }
+  return invalidptr;
+}
+
+#endif /* NATIVESCAN */
@@ -0,0 +1,21 @@
+/*==============================================================
+
+  ACCUM.H:  header for ACCUM.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+  This contains the prototype for ACCUMULATE of the associative
+  primitives on homogeneous arrays
+
+================================================================*/
+
+#ifndef _ACCUM_H_
+#define _ACCUM_H_
+
+#ifdef NATIVESCAN
+
+extern nialptr accumulate_scan(nialptr f, nialptr x);
+
+#endif
+
+#endif
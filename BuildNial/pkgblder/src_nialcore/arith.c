@@ -49,13 +49,11 @@
 #include "utils.h"           /* conversion utilities */
 #include "ops.h"             /* needed for simple, pair etc. */
 #include "faults.h"          /* definition of Faults used here */
+#include "parallel.h"        /* for par_for */
 
 
 /* declaration of internal static routines */
 
-static int safeintadd(nialint x, nialint y, nialint *p);
-static int safeintsub(nialint x, nialint y, nialint *p);
-static int safeintmult(nialint x, nialint y, nialint *p);
 static int safeintabs(nialint x, nialint *z);
 static int safefloor(double r, nialint *x);
 static void nial_plus(nialptr x, nialptr y);
@@ -66,30 +64,27 @@ static nialint nial_quotient(nialint x, nialint y);
 static int  sumbools(nialptr x, nialint n);
 static double sumreals(double *ptrx, nialint n);
 static int  addintvectors(nialint * x, nialint * y, nialint * z, nialint n);
-static int  addintscalarvector(nialint x, nialint * y, nialint * z, nialint n);
 static void addrealvectors(double *x, double *y, double *z, nialint n);
-static void addrealscalarvector(double x, double *y, double *z, nialint n);
 static int  prodbools(nialptr x, nialint n);
 static double prodreals(double *ptrx, nialint n);
 static int  multintvectors(nialint * x, nialint * y, nialint * z, nialint n);
-static int  multintscalarvector(nialint x, nialint * y, nialint * z, nialint n);
 static void multrealvectors(double *x, double *y, double *z, nialint n);
-static void multrealscalarvector(double x, double *y, double *z, nialint n);
-static int  floorreals(double *ptrx, nialint * ptrz, nialint n);
 static int  subintvectors(nialint * x, nialint * y, nialint * z, nialint n);
 static void subrealvectors(double *x, double *y, double *z, nialint n);
-static int  subintscalarvector(nialint x, nialint * y, nialint * z, nialint n, int negate);
-static void subrealscalarvector(double x, double *y, double *z, nialint n, int negate);
 static void divrealvectors(double *x, double *y, double *z, nialint n);
 static void divrealscalarvector(double x, double *y, double *z, nialint n, int negate);
 static void quotientintvectors(nialint * x, nialint * y, nialint * z, nialint n);
 static void quotientintscalarvector(nialint x, nialint * y, nialint * z, nialint n, int negate);
 static void modintvectors(nialint * x, nialint * y, nialint * z, nialint n);
 static void modintscalarvector(nialint x, nialint * y, nialint * z, nialint n, int negate);
-/*
- static void absints(nialint * ptrx, nialint * ptrz, nialint n);
- */
-static void absreals(double *ptrx, double *ptrz, nialint n);
+static int  unaryloop(parbody part, nialptr x, nialptr z);
+static int  absints(nialint lo, nialint hi, void *arg);
+static int  absreals(nialint lo, nialint hi, void *arg);
+static int  floorreals(nialint lo, nialint hi, void *arg);
+static int  oppints(nialint lo, nialint hi, void *arg);
+static int  oppreals(nialint lo, nialint hi, void *arg);
+static int  recipints(nialint lo, nialint hi, void *arg);
+static int  recipreals(nialint lo, nialint hi, void *arg);
 static void randomreals(double *ptrz, nialint n);
 static double frand(void);
 
@@ -99,7 +94,7 @@ static double frand(void);
    It uses precision dependent constants that are initialized in nialconsts.h
  */
 
-static int
+int
 safeintadd(nialint x, nialint y, nialint *p)
 {
     nialint s = x + y;
@@ -113,7 +108,7 @@ safeintadd(nialint x, nialint y, nialint *p)
     }
 }
 
-static int
+int
 safeintsub(nialint x, nialint y, nialint *p)
 {
    nialint s = x - y;
@@ -131,7 +126,7 @@ safeintsub(nialint x, nialint y, nialint *p)
 /* compute the product using absolute values and then set the sign of the product 
    absolute values computed directly to allow for all precisions. */
 
-static int
+int
 safeintmult(nialint x, nialint y, nialint *p)
 {
     nialint z;
@@ -423,6 +418,75 @@ sumbools(nialptr x, nialint n)
   return (s);
 }
 
+/* A large array of integers is summed in parts by par_for. Each part
+   also keeps its largest and smallest partial sum, so that when the
+   parts are added in order an overflow of any partial sum of the whole
+   array is found, as it is by the serial loop. An overflow within a part
+   makes sumints use the serial loop. */
+
+struct sumparts {
+  nialint    *x,
+              chunk,
+              sum[PARMAXTHREADS],
+              hi[PARMAXTHREADS],
+              lo[PARMAXTHREADS];
+};
+
+static int
+sumpart(nialint lo, nialint hi, void *arg)
+{
+  struct sumparts *sp = arg;
+  nialint    *x = sp->x,
+              p = lo / sp->chunk,
+              s = x[lo],
+              smax = s,
+              smin = s,
+              i;
+
+  for (i = lo + 1; i < hi; i++) {
+    if (safeintadd(s, x[i], &s))
+      return false;
+    if (s > smax)
+      smax = s;
+    else if (s < smin)
+      smin = s;
+  }
+  sp->sum[p] = s;
+  sp->hi[p] = smax;
+  sp->lo[p] = smin;
+  return true;
+}
+
+/* routine to sum in parts. It returns false if the serial loop is to be
+   used, otherwise it sets *ovfl to say whether a partial sum overflows */
+
+static int
+parsumints(nialint * ptrx, nialint n, nialint * res, int *ovfl)
+{
+  static struct sumparts sp;
+  int         parts = par_parts(n),
+              p;
+  nialint     s = 0,
+              t;
+
+  if (parts <= 1)
+    return false;
+  sp.x = ptrx;
+  sp.chunk = PARCHUNK(n, parts);
+  if (!par_for(n, sumpart, &sp))
+    return false;
+  *ovfl = false;
+  for (p = 0; p < parts; p++) {
+    if (safeintadd(s, sp.hi[p], &t) || safeintadd(s, sp.lo[p], &t) ||
+        safeintadd(s, sp.sum[p], &s)) {
+      *ovfl = true;
+      break;
+    }
+  }
+  *res = s;
+  return true;
+}
+
 /* jumps out early on an integer overflow  */
 
 int
@@ -431,6 +495,12 @@ sumints(nialint * ptrx, nialint n, nialint * res)
   nialint     i;
   nialint     s = 0,
               snew;
+  int         ovfl;
+
+  if (parsumints(ptrx, n, &s, &ovfl)) {
+    *res = s;
+    return ovfl;
+  }
 
   for (i = 0; i < n; i++) {  /* special case for integer addition */
       if (safeintadd(s, *ptrx++, &snew))
@@ -464,7 +534,7 @@ addintvectors(nialint * x, nialint * y, nialint * z, nialint n)
   return true;
 }
 
-static int
+int
 addintscalarvector(nialint x, nialint * y, nialint * z, nialint n)
 {
   nialint     i, s;
@@ -485,7 +555,7 @@ addrealvectors(double *x, double *y, double *z, nialint n)
     *z++ = *x++ + *y++;
 }
 
-static void
+void
 addrealscalarvector(double x, double *y, double *z, nialint n)
 {
   nialint     i;
@@ -826,7 +896,7 @@ multintvectors(nialint * x, nialint * y, nialint * z, nialint n)
   return true;
 }
 
-static int
+int
 multintscalarvector(nialint x, nialint * y, nialint * z, nialint n)
 {
   nialint     i, p;
@@ -849,7 +919,7 @@ multrealvectors(double *x, double *y, double *z, nialint n)
     *z++ = (*x++) * (*y++);
 }
 
-static void
+void
 multrealscalarvector(double x, double *y, double *z, nialint n)
 {
   nialint     i;
@@ -1046,7 +1116,7 @@ subintvectors(nialint * x, nialint * y, nialint * z, nialint n)
   return true;
 }
 
-static int
+int
 subintscalarvector(nialint x, nialint * y, nialint * z, nialint n, int yisatomic)
 {
     nialint     i, s;
@@ -1079,7 +1149,7 @@ subrealvectors(double *x, double *y, double *z, nialint n)
 }
 
 
-static void
+void
 subrealscalarvector(double x, double *y, double *z, nialint n, int negate)
 {
   nialint     i;
@@ -1273,8 +1343,7 @@ iabs()
               x = apop();
   int         k = kind(x),
               v = valence(x);
-  nialint     t = tally(x),
-              i, arg, res, *ptrx, *ptrz;
+  nialint     arg, res;
 
   switch (k) {
     case booltype:
@@ -1297,25 +1366,19 @@ iabs()
         }
           else {
           z = new_create_array(inttype, v, 0, shpptr(x, v));
-          ptrx = pfirstint(x);
-          ptrz = pfirstint(z);
-          for (i = 0; i < t; i++) {
-              arg = *ptrx++;
-          if (safeintabs(arg, &res)) { /* call int_each to handle blowup */
+          if (!unaryloop(absints, x, z)) { /* call int_each to handle blowup */
             freeup(z);
             int_each(iabs, x);
-            break;
           }
-          *ptrz++ = res;
-        }
-    
-        apush(z);
-        freeup(x);
+          else {
+            apush(z);
+            freeup(x);
+          }
           }
         break;
     case realtype:
         z = new_create_array(realtype, v, 0, shpptr(x, v));
-        absreals(pfirstreal(x), pfirstreal(z), t);
+        unaryloop(absreals, x, z);
         apush(z);
         freeup(x);
         break;
@@ -1341,16 +1404,53 @@ iabs()
 }
 
 
-static void
-absreals(double *ptrx, double *ptrz, nialint n)
+/* The loops over the items of numeric arrays for the monadic operations
+   are done by par_for, so that large arrays are done on several threads.
+   Each loop computes the items from lo to hi-1 of z from those of x and
+   returns false if one of them cannot be computed, and the caller then
+   uses int_each to get the faults. */
+
+struct unaryargs {
+  void       *x,
+             *z;
+};
+
+static int
+unaryloop(parbody part, nialptr x, nialptr z)
 {
+  struct unaryargs a;
+
+  a.x = dataptr(x);
+  a.z = dataptr(z);
+  return (par_for(tally(x), part, &a));
+}
+
+static int
+absints(nialint lo, nialint hi, void *arg)
+{
+  nialint    *ptrx = ((struct unaryargs *) arg)->x,
+             *ptrz = ((struct unaryargs *) arg)->z,
+              i;
+
+  for (i = lo; i < hi; i++)
+    if (safeintabs(ptrx[i], &ptrz[i]))
+      return false;
+  return true;
+}
+
+static int
+absreals(nialint lo, nialint hi, void *arg)
+{
+  double     *ptrx = ((struct unaryargs *) arg)->x,
+             *ptrz = ((struct unaryargs *) arg)->z,
+              it;
   nialint     i;
-  double      it;
 
-  for (i = 0; i < n; i++) {
-    it = *ptrx++;
-    *ptrz++ = (it < 0 ? -it : it);
+  for (i = lo; i < hi; i++) {
+    it = ptrx[i];
+    ptrz[i] = (it < 0 ? -it : it);
   }
+  return true;
 }
 
 /* routine to implement floor. It has the same
@@ -1363,7 +1463,6 @@ ifloor()
               x = apop();
   int         k = kind(x),
               v = valence(x);
-  nialint     t = tally(x);
 
   switch (k) {
     case booltype:
@@ -1384,7 +1483,7 @@ ifloor()
         }
         else {
           z = new_create_array(inttype, v, 0, shpptr(x, v));
-          if (floorreals(pfirstreal(x), pfirstint(z), t)) { /* an overflow ocurred */
+          if (!unaryloop(floorreals, x, z)) { /* an overflow ocurred */
               freeup(z);
               int_each(ifloor, x);
           }
@@ -1421,21 +1520,19 @@ ifloor()
  fail to satisfy floor(1.0 * x) = x for integers outside the boundary conditions.
  */
 
-/* floorreals returns true if any of the conversions fail on overflow. */
-
-
-
+/* floorreals returns false if any of the conversions fail on overflow. */
 
 static int
-floorreals(double *ptrx, nialint * ptrz, nialint n)
+floorreals(nialint lo, nialint hi, void *arg)
 {
-    nialint     i, y;
-    for (i = 0; i < n; i++) {
-        if (safefloor(*ptrx++, &y))
-            return true;
-        *ptrz++ = y;
-    }
-    return false;
+    double     *ptrx = ((struct unaryargs *) arg)->x;
+    nialint    *ptrz = ((struct unaryargs *) arg)->z,
+                i;
+
+    for (i = lo; i < hi; i++)
+        if (safefloor(ptrx[i], &ptrz[i]))
+            return false;
+    return true;
 }
 
 
@@ -1570,11 +1667,30 @@ icharrep()
 
 /* other arithmetic routines constructed from implemented ones */
 
+/* opposite and reciprocal of integer and real arrays compute the items
+   directly as 0 - A and 1 / A do. Overflow or a zero item uses int_each
+   to give the faults. */
+
 void
 iopposite()
 {
-  if (!atomic(top))
-    int_each(iopposite,apop());
+  if (!atomic(top)) {
+    nialptr     z,
+                x = apop();
+    int         k = kind(x),
+                v = valence(x);
+
+    if ((k == inttype || k == realtype) && tally(x) > 0) {
+      z = new_create_array(k, v, 0, shpptr(x, v));
+      if (unaryloop(k == inttype ? oppints : oppreals, x, z)) {
+        apush(z);
+        freeup(x);
+        return;
+      }
+      freeup(z);
+    }
+    int_each(iopposite, x);
+  }
   else
   { pair(Zero, apop());
     iminus();
@@ -1585,14 +1701,84 @@ iopposite()
 void
 ireciprocal()
 {
-  if (!atomic(top))
-    int_each(ireciprocal,apop());
+  if (!atomic(top)) {
+    nialptr     z,
+                x = apop();
+    int         k = kind(x),
+                v = valence(x);
+
+    if ((k == inttype || k == realtype) && tally(x) > 0) {
+      z = new_create_array(realtype, v, 0, shpptr(x, v));
+      if (unaryloop(k == inttype ? recipints : recipreals, x, z)) {
+        apush(z);
+        freeup(x);
+        return;
+      }
+      freeup(z);
+    }
+    int_each(ireciprocal, x);
+  }
   else
   { pair(One, apop());
     idivide();
   }
 }
 
+static int
+oppints(nialint lo, nialint hi, void *arg)
+{
+  nialint    *ptrx = ((struct unaryargs *) arg)->x,
+             *ptrz = ((struct unaryargs *) arg)->z,
+              i;
+
+  for (i = lo; i < hi; i++)
+    if (safeintsub(0, ptrx[i], &ptrz[i]))
+      return false;
+  return true;
+}
+
+static int
+oppreals(nialint lo, nialint hi, void *arg)
+{
+  double     *ptrx = ((struct unaryargs *) arg)->x,
+             *ptrz = ((struct unaryargs *) arg)->z;
+  nialint     i;
+
+  for (i = lo; i < hi; i++)
+    ptrz[i] = 0. - ptrx[i];
+  return true;
+}
+
+static int
+recipints(nialint lo, nialint hi, void *arg)
+{
+  nialint    *ptrx = ((struct unaryargs *) arg)->x,
+              i;
+  double     *ptrz = ((struct unaryargs *) arg)->z;
+
+  for (i = lo; i < hi; i++) {
+    if (ptrx[i] == 0)
+      return false;
+    ptrz[i] = 1. / (double) ptrx[i];
+  }
+  return true;
+}
+
+static int
+recipreals(nialint lo, nialint hi, void *arg)
+{
+  double     *ptrx = ((struct unaryargs *) arg)->x,
+             *ptrz = ((struct unaryargs *) arg)->z;
+  nialint     i;
+
+  for (i = lo; i < hi; i++) {
+    if (ptrx[i] == 0.)
+      return false;
+    ptrz[i] = 1. / ptrx[i];
+  }
+  return true;
+}
+
 void
 iceiling()
 {
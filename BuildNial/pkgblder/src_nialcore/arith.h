@@ -14,3 +14,17 @@ extern int  sumints(nialint * ptrx, nialint n, nialint * res);
 
 /* prodints is used in atops.c and trs.c */
 extern int  prodints(nialint * ptrx, nialint n, nialint * res);
+
+/* the overflow tested integer operations are used in bytecode.c */
+extern int  safeintadd(nialint x, nialint y, nialint *p);
+extern int  safeintsub(nialint x, nialint y, nialint *p);
+extern int  safeintmult(nialint x, nialint y, nialint *p);
+
+/* the scalar-vector loops are used in outer.c. The integer ones return
+   false on overflow. */
+extern int  addintscalarvector(nialint x, nialint * y, nialint * z, nialint n);
+extern void addrealscalarvector(double x, double *y, double *z, nialint n);
+extern int  subintscalarvector(nialint x, nialint * y, nialint * z, nialint n, int negate);
+extern void subrealscalarvector(double x, double *y, double *z, nialint n, int negate);
+extern int  multintscalarvector(nialint x, nialint * y, nialint * z, nialint n);
+extern void multrealscalarvector(double x, double *y, double *z, nialint n);
@@ -63,6 +63,8 @@ static nialptr gage(nialptr x);
 
 static void cutorcutall(nialptr x, nialptr y, int cutprim);
 static void nial_solitary(nialptr x);
+static int  append_in_place(nialptr x, nialptr y);
+static int  hitch_in_place(nialptr x, nialptr y);
 static void takedrop(nialptr x, nialptr y, int istake);
 static void nseek(nialptr x, nialptr y);
 static void pack(nialptr x);
@@ -213,6 +215,9 @@ b_append()
   nialptr     y = apop(),
               x = apop();
 
+  /* x is held only by the variable the result is assigned to */
+  if (x == updatevalue && refcnt(x) == 1 && append_in_place(x, y))
+    return;
   append(x, y);
 }
 
@@ -232,7 +237,10 @@ iappend()
   }
   else {
     splitfb(z, &x, &y);
-    append(x, y);
+    /* x is held by the temporary pair and the variable being assigned */
+    if (!(x == updatevalue && refcnt(x) == 2 && refcnt(z) == 0 &&
+          append_in_place(x, y)))
+      append(x, y);
   }
   freeup(z);
 }
@@ -285,6 +293,101 @@ append(nialptr x, nialptr y)
   apush(z);
 }
 
+/* The in place forms of append and hitch are used when the list argument
+   of A := A append X or A := X hitch A is shared only with A, so that
+   changing it cannot be observed. The new item goes into the unused area
+   of the block when there is room. Otherwise the list is moved to a block
+   with spare room, making a run of appends amortized constant time.
+   These return false, doing nothing, if the kinds call for an explode or
+   the list is not one whose items can be shifted as words or bytes. */
+
+static int
+append_in_place(nialptr x, nialptr y)
+{
+  nialptr     z;
+  nialint     n = tally(x);
+  int         kx = kind(x);
+
+  if (valence(x) != 1 || x == y || (double) n + 1 > LARGEINT)
+    return (false);
+  if (kx != atype && (kx != kind(y) || valence(y) != 0 ||
+                      (kx != inttype && kx != realtype && kx != chartype)))
+    return (false);
+  if (listroom(x) > 0) {
+    z = x;
+    set_tally(z, n + 1);
+    *shpptr(z, 1) = n + 1;
+  }
+  else {
+    z = new_create_list(kx, n + 1, (n + 1) / 2 + LISTROOM);
+    copy(z, 0, x, 0, n);
+  }
+  if (kx == atype) {
+    store_array(z, n, y);
+  }
+  else {
+    copy1(z, n, y, 0);
+    freeup(y);
+  }
+  if (kx == chartype)
+    store_char(z, n + 1, '\0');
+  set_sorted(z, false);
+  apush(z);
+  return (true);
+}
+
+static int
+hitch_in_place(nialptr x, nialptr y)
+{
+  nialptr     z;
+  nialint     n = tally(y);
+  int         ky = kind(y);
+  size_t      sz;
+
+  if (valence(y) != 1 || x == y || (double) n + 1 > LARGEINT)
+    return (false);
+  switch (ky) {
+  case atype:
+    sz = sizeof(nialptr);
+    break;
+  case inttype:
+    sz = sizeof(nialint);
+    break;
+  case realtype:
+    sz = sizeof(double);
+    break;
+  case chartype:
+    sz = 1;
+    break;
+  default:
+    return (false);
+  }
+  if (ky != atype && (ky != kind(x) || valence(x) != 0))
+    return (false);
+  if (listroom(y) > 0) {
+    /* shift the items, and the null of a string, up one place */
+    z = y;
+    memmove((char *) pfirstint(z) + sz, (char *) pfirstint(z),
+            n * sz + (ky == chartype));
+    set_tally(z, n + 1);
+    *shpptr(z, 1) = n + 1;
+  }
+  else {
+    z = new_create_list(ky, n + 1, (n + 1) / 2 + LISTROOM);
+    copy(z, 1, y, 0, n);
+  }
+  if (ky == atype) {
+    store_array(z, 0, x);  /* the old first item has moved up */
+  }
+  else {
+    copy1(z, 0, x, 0);
+    freeup(x);
+  }
+  set_sorted(z, false);
+  apush(z);
+  return (true);
+}
+
 /* the following routines implement the binary operation hitch.
  The result is a list of length one longer than the second argument with first item
   being the first argument followed by the items of the second argument.
@@ -296,6 +399,9 @@ b_hitch()
   nialptr     y = apop(),
               x = apop();
 
+  /* y is held only by the variable the result is assigned to */
+  if (y == updatevalue && refcnt(y) == 1 && hitch_in_place(x, y))
+    return;
   hitch(x, y);
 }
 
@@ -315,7 +421,10 @@ ihitch()
   }
   else {
     splitfb(z, &x, &y);
-    hitch(x, y);
+    /* y is held by the temporary pair and the variable being assigned */
+    if (!(y == updatevalue && refcnt(y) == 2 && refcnt(z) == 0 &&
+          hitch_in_place(x, y)))
+      hitch(x, y);
   }
   freeup(z);
 }
@@ -1089,6 +1198,38 @@ itell()
   }
 }
 
+/* primitive operation count. count A is 1 + tell A, made directly
+   for an integer */
+
+void
+icount()
+{
+  if (isint(top) && intval(top) > 0) {
+    nialptr     x = apop(),
+                z;
+    nialint     n = intval(x),
+               *p,
+                i;
+
+    z = new_create_array(inttype, 1, 0, &n);
+    p = pfirstint(z);
+    for (i = 0; i < n; i++)
+      p[i] = i + 1;
+    set_sorted(z, true);
+    freeup(x);
+    apush(z);
+    return;
+  }
+  itell();
+  if (kind(top) == faulttype)
+    return;
+  apush(createint(1));
+  swap();
+  b_plus();
+  if (kind(top) == inttype)
+    set_sorted(top, true);
+}
+
 /* internal routine for tell of an integer */
 
 nialptr
@@ -55,6 +55,8 @@
 #include "roles.h"           /* roles for identifiers */
 #include "states.h"          /* scanner states, needed to build constants */
 #include "symtab.h"          /* for sym_name  */
+#include "bytecode.h"        /* for vm_build */
+#include "eval.h"            /* for n_eval */
 
 
 
@@ -119,6 +121,23 @@ mkaquad(nialptr x, nialptr y, nialptr w, nialptr u)
   return (z);
 }
 
+/* make quint of atype */
+
+nialptr
+mkaquint(nialptr x, nialptr y, nialptr w, nialptr u, nialptr v)
+{
+  nialptr     z;
+  nialint     five = 5;
+
+  z = new_create_array(atype, 1, 0, &five);
+  store_array(z, 0, x);
+  store_array(z, 1, y);
+  store_array(z, 2, w);
+  store_array(z, 3, u);
+  store_array(z, 4, v);
+  return (z);
+}
+
 /* make triple of ints */
 
 nialptr
@@ -134,6 +153,22 @@ mkitriple(nialint i0, nialint i1, nialint i2)
   return (z);
 }
 
+/* make quad of ints */
+
+nialptr
+mkiquad(nialint i0, nialint i1, nialint i2, nialint i3)
+{
+  nialptr     z;
+  nialint     four = 4;
+
+  z = new_create_array(inttype, 1, 0, &four);
+  store_int(z, 0, i0);
+  store_int(z, 1, i1);
+  store_int(z, 2, i2);
+  store_int(z, 3, i3);
+  return (z);
+}
+
 /* make quint of ints */
 
 nialptr
@@ -153,6 +188,56 @@ mkiquint(nialint i0, nialint i1, nialint i2, nialint i3, nialint i4)
 
 /* specific builders */
 
+#ifdef TAILCALLS
+
+/* marktail marks the operation calls in tail position of the item i of
+   holder, giving a t_opcall node a fourth item. The value of such a
+   call is the value of the operation form, so apply can make it after
+   leaving the form's activation record. Only the sequence, if and case
+   expressions pass their last value through unchanged; a block or loop
+   ends the search. */
+
+static void
+marktail(nialptr holder, nialint i)
+{
+  nialptr     x = fetch_array(holder, i);
+  nialint     j,
+              n;
+
+  if (kind(x) != atype || x == Null)
+    return;
+  switch (tag(x)) {
+    case t_opcall:
+        if (tally(x) == 3)
+          replace_array(holder, i,
+                        mkaquad(fetch_array(x, 0), get_op(x), get_argexpr(x), True_val));
+        break;
+    case t_exprseq:
+        if (tally(x) > 1)
+          marktail(x, tally(x) - 1);
+        break;
+    case t_ifexpr:
+        n = tally(x);
+        for (j = 2; j < n; j += 2)  /* the then expressions */
+          marktail(x, j);
+        if ((n - 1) % 2 == 1)  /* the else expression */
+          marktail(x, n - 1);
+        break;
+    case t_caseexpr:
+        {
+          nialptr     eseqs = get_eseqs(x);
+
+          for (j = 0; j < tally(eseqs); j++)
+            marktail(eseqs, j);
+        }
+        break;
+    default:
+        break;
+  }
+}
+
+#endif
+
 nialptr
 b_opform(nialptr sym, nialptr cenv, int nvars, nialptr arglist, nialptr body)
 {
@@ -162,7 +247,18 @@ b_opform(nialptr sym, nialptr cenv, int nvars, nialptr arglist, nialptr body)
   apush(createint((nialint) nvars));
   apush(arglist);
   apush(body);
-  mklist(6);
+  apush(Null);               /* place for the bytecode */
+  mklist(7);
+#ifdef TAILCALLS
+  if (tag(body) == t_blockbody)
+    marktail(body, 4);  /* the body sequence of the block */
+  else
+    marktail(top, 5);
+  body = get_body(top);
+#endif
+#ifdef BYTECODE
+  vm_build(top, (tag(body) == t_blockbody ? get_seq(body) : body), sym);
+#endif
   return (apop());
 }
 
@@ -238,6 +334,22 @@ b_transform(nialptr tr, nialptr argop)
   return (mkatriple(createint(t_transform), tr, argop));
 }
 
+/* b_variable builds the node for a variable, keeping with it the
+   offset of a local in the activation record of its symbol table so
+   that it is found without going through the entry. The offset is -1
+   for a global, and for a local it is set by the parser when the
+   variable is installed before the offset is known. */
+
+nialptr
+b_variable(nialint sym, nialint entr)
+{
+  nialint     offset = -1;
+
+  if ((nialptr) sym != global_symtab && isint(sym_valu((nialptr) entr)))
+    offset = intval(sym_valu((nialptr) entr));
+  return (mkiquad(t_variable, sym, entr, offset));
+}
+
 /* getters */
 
 nialptr
@@ -276,26 +388,186 @@ get_entry(nialptr x)
     return ((nialptr) fetch_int(x, 2));
 }
 
+#ifdef FOLDING
+
+/* Constant folding. A call of a primitive operation on constants gives
+   the same value each time, so it is evaluated when the call is built
+   and replaced by a constant node. The node has the tree of the call
+   as a fourth item so that deparse gives back the source.
+
+   The pervasive primitives, those with properties 'R', 'C' and 'P', are
+   all pure. Of the others, with properties 'B', 'U' and 'T', the ones
+   named below are pure and give a result no larger than their
+   arguments. TELL is also folded when its argument is a small integer.
+   Names that are not primitives in this build do not match. */
+
+static char *foldnames[] = {
+  "EXCEPT", "APPEND", "CHOOSE", "FINDALL", "HITCH", "PICK", "REACH",
+  "SEEK", "FIND", "IN", "SUBLIST", "CUT", "CUTALL",
+  "SECOND", "THIRD", "ATOMIC", "DIVERSE", "VALENCE", "PASS", "PAIR",
+  "SIMPLE", "=", "~=", "FIRST", "LINK", "LIST", "REST", "REVERSE",
+  "SHAPE", "SOLITARY", "TALLY", "SINGLE", "CULL", "TRANSPOSE",
+  "ISBOOLEAN", "ISINTEGER", "ISREAL", "ISCHAR", "ISPHRASE", "ISFAULT",
+  "ISSTRING", "NUMERIC", "ALLBOOLS", "ALLINTS", "ALLREALS", "ALLCHARS",
+  "ALLNUMERIC", "EMPTY", "TOUPPER", "TOLOWER", "PHRASE", "STRING",
+  "BIT_AND", "BIT_OR", "BIT_XOR",
+  "EACH", "EACHBOTH", "EACHLEFT", "EACHRIGHT", "REDUCE", "ACCUMULATE",
+  "SORT", "GRADE", "CONVERSE", "TELL", NULL
+};
+
+/* the purity of each primitive by index: 'y' if pure, 'g' if it is
+   TELL, 'n' if not and 0 until it has been looked up */
+
+static char foldtab[NOBNAMES];
+
+static int
+purebasic(nialptr op)
+{
+  nialint     ind;
+
+  if (tag(op) != t_basic)
+    return 0;
+  ind = get_index(op);
+  if (foldtab[ind] == 0) {
+    int         prop = get_prop(op);
+
+    foldtab[ind] = 'n';
+    if (prop == 'R' || prop == 'C' || prop == 'P')
+      foldtab[ind] = 'y';
+    else if (prop == 'B' || prop == 'U' || prop == 'T') {
+      char      **nm;
+
+      for (nm = foldnames; *nm != NULL; nm++)
+        if (strcmp(*nm, pfirstchar(bnames[ind])) == 0)
+          foldtab[ind] = (strcmp(*nm, "TELL") == 0 ? 'g' : 'y');
+    }
+  }
+  return foldtab[ind];
+}
+
+/* routine to test that a tree denotes a constant value */
+
+static int
+constexpr(nialptr tree)
+{
+  nialint     i;
+
+  switch (tag(tree)) {
+    case t_constant:
+        return (kind(get_c_val(tree)) != faulttype);
+    case t_parendobj:
+        return constexpr(fetch_array(tree, 1));
+    case t_exprseq:
+        return (tally(tree) == 2 && constexpr(fetch_array(tree, 1)));
+    case t_strand:
+        for (i = 1; i < tally(tree); i++)
+          if (!constexpr(fetch_array(tree, i)))
+            return false;
+        return true;
+    default:
+        return false;
+  }
+}
+
+/* routine to test that an operation applied to a constant argument
+   gives a constant */
+
+static int
+pureop(nialptr op, nialptr argexpr)
+{
+  switch (tag(op)) {
+    case t_basic:
+        if (purebasic(op) == 'g') { /* TELL of a small integer */
+          nialptr     v;
+
+          if (tag(argexpr) != t_constant)
+            return false;
+          v = get_c_val(argexpr);
+          return (isint(v) && intval(v) <= FOLDMAXTALLY);
+        }
+        return (purebasic(op) == 'y' && get_prop(op) != 'T');
+    case t_curried:
+        return (pureop(get_op(op), Nullexpr) && constexpr(get_argexpr(op)));
+    case t_transform:
+        return (purebasic(get_tr(op)) == 'y' && get_prop(get_tr(op)) == 'T' &&
+                pureop(get_argop(op), Nullexpr));
+    default:
+        return false;
+  }
+}
+
+/* routine to replace a call by its value if it can be folded */
+
+static nialptr
+fold(nialptr tree)
+{
+  nialptr     v;
+  nialint     i;
+  int         savetrace = trace,
+              savetriggered = triggered,
+              badval = false;
+
+  if (tag(tree) == t_basic_binopcall) {
+    if (purebasic(get_op(tree)) != 'y' || !constexpr(get_argexpr(tree)) ||
+        !constexpr(get_argexpr1(tree)))
+      return tree;
+  }
+  else if (!pureop(get_op(tree), get_argexpr(tree)) ||
+           !constexpr(get_argexpr(tree)))
+    return tree;
+
+  /* evaluate the call quietly. A fault is left to be made at run time
+     so that it triggers then. */
+  trace = false;
+  triggered = false;
+  n_eval(tree);
+  trace = savetrace;
+  triggered = savetriggered;
+  v = apop();
+  if (kind(v) == faulttype)
+    badval = true;
+  else if (kind(v) == atype)
+    for (i = 0; i < tally(v); i++)
+      if (kind(fetch_array(v, i)) == faulttype)
+        badval = true;
+  if (badval) {
+    freeup(v);
+    return tree;
+  }
+  return (mkaquad(createint(t_constant), v, Null, tree));
+}
+
+#endif
+
 /* b_opcall does an optimization to recognize binary basic operations
    in infix calls. This includes recognizing infix uses of sum (+) etc.
-   */
+   A call that gives a constant is folded. */
 
 nialptr
 b_opcall(nialptr op, nialptr argexpr)
 {
+  nialptr     tree;
+
   if (tag(op) == t_curried) {
     nialptr     op1 = get_op(op);
-    int         prop = get_prop(op1);
+    int         prop = (tag(op1) == t_basic ? get_prop(op1) : 0);
 
-    if (tag(op1) == t_basic && (prop == 'B' || prop == 'C' || prop == 'R')) {
-      nialptr     tree =
+    if (prop == 'B' || prop == 'C' || prop == 'R') {
+      tree =
       mkaquad(createint(t_basic_binopcall), op1, get_argexpr(op), argexpr);
 
       freeup(op);
+#ifdef FOLDING
+      tree = fold(tree);
+#endif
       return tree;
     }
   }
-  return (mkatriple(createint(t_opcall), op, argexpr));
+  tree = mkatriple(createint(t_opcall), op, argexpr);
+#ifdef FOLDING
+  tree = fold(tree);
+#endif
+  return (tree);
 }
 
 /* the constant builder must take the tkn and a state
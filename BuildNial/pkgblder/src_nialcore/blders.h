@@ -15,6 +15,7 @@ extern nialptr solitaryint(int i0);
 extern nialptr mkapair(nialptr i0, nialptr i1);
 extern nialptr mkatriple(nialptr i0, nialptr i1, nialptr i2);
 extern nialptr mkaquad(nialptr i0, nialptr i1, nialptr i2, nialptr i3);
+extern nialptr mkaquint(nialptr i0, nialptr i1, nialptr i2, nialptr i3, nialptr i4);
 extern nialptr mkitriple(nialint i0, nialint i1, nialint i2);
 extern nialptr mkiquad(nialint i0, nialint i1, nialint i2, nialint i3);
 extern nialptr mkiquint(nialint i0, nialint i1, nialint i2, nialint i3, nialint i4);
@@ -26,6 +27,7 @@ extern nialptr b_block(nialptr sym, nialptr cenv, int localcnt, nialptr body);
 extern nialptr b_opform(nialptr sym, nialptr cenv, int localcnt, nialptr arglist, nialptr body);
 extern nialptr b_curried(nialptr op, nialptr argexpr);
 extern nialptr b_transform(nialptr tr, nialptr argop);
+extern nialptr b_variable(nialint sym, nialint entr);
 extern nialptr get_sym(nialptr x);
 extern int  tag(nialptr x);
 extern nialptr get_name(nialptr x);
@@ -45,8 +47,6 @@ extern nialptr combinedaction(nialptr defs, nialptr exprs);
 
 #define b_identifier(sym,entr,id) mkaquad(createint(t_identifier),createint((nialint)sym),createint((nialint)entr),id)
 
-#define b_variable(sym,entr) mkitriple(t_variable,sym,entr)
-
 #define b_expression(sym,entr) mkitriple(t_expression,sym,entr)
 
 #define st_idlist() solitaryint(t_idlist)
@@ -81,13 +81,15 @@ extern nialptr combinedaction(nialptr defs, nialptr exprs);
 
 #define b_assignexpr(idlist,expr) mkatriple(createint(t_assignexpr),idlist,expr)
 
-#define b_whileexpr(wtest,wes) mkatriple(createint(t_whileexpr),wtest,wes)
+/* the loops and b_opform end with a place for their bytecode */
+
+#define b_whileexpr(wtest,wes) mkaquad(createint(t_whileexpr),wtest,wes,Null)
 
 #define b_exitexpr(t) mkapair(createint(t_exit),t)
 
-#define b_repeatexpr(res,rtest) mkatriple(createint(t_repeatexpr),res,rtest)
+#define b_repeatexpr(res,rtest) mkaquad(createint(t_repeatexpr),res,rtest,Null)
 
-#define b_forexpr(idlist,expr,fexprseq) mkaquad(createint(t_forexpr),idlist,expr,fexprseq)
+#define b_forexpr(idlist,expr,fexprseq) mkaquint(createint(t_forexpr),idlist,expr,fexprseq,Null)
 
 #define b_definition(idlist,dvalue,fnsw) mkaquad(createint(t_definition),idlist,dvalue,createint((nialint)fnsw))
 
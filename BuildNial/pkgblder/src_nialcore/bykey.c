@@ -0,0 +1,389 @@
+/*==============================================================
+
+  MODULE   BYKEY.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+
+  BYKEY on lists, grouping the items by a hash table of the keys.
+
+================================================================*/
+
+/* K BYKEY f A applies f to each group of the items of A that have equal
+   items in K, with the groups in the order in which their keys first
+   occur in K. ibykey in trs.c does this by grading K and finding the
+   items of each key in the sorted keys. When K and A are lists of the
+   same tally this module groups them in one pass instead: a hash table
+   from a key to its group gives the group of each item, and the items
+   of each group are then listed in their order in A by a counting sort.
+
+   When f is sum (+), tally, max, min or first the result for each group
+   is computed in the same pass over A without making the groups. The
+   sums and extremes are taken from left to right as the primitives do,
+   so the result is the same. An integer overflow in a sum makes the
+   groups be made and f applied to them, which gives the faults.
+
+   Keys are equal as by equal, with 0. and -0. the same key. A list of
+   reals that has a NaN is left to ibykey, since a NaN is not equal to
+   itself.
+*/
+
+#include "switches.h"
+
+/* standard library header files */
+
+/* IOLIB */
+#include <stdio.h>
+
+/* STLIB */
+#include <stdlib.h>
+#include <string.h>
+
+/* SJLIB */
+#include <setjmp.h>
+
+/* Q'Nial header files */
+
+#include "bykey.h"
+#include "qniallim.h"
+#include "absmach.h"
+#include "basics.h"
+#include "lib_main.h"
+#include "if.h"
+
+#include "arith.h"           /* for safeintadd */
+#include "compare.h"         /* for equal, hasharray */
+#include "eval.h"            /* for do_apply */
+#include "blders.h"          /* for tag */
+#include "getters.h"         /* for get_index */
+#include "insel.h"           /* for choose */
+#include "ops.h"             /* for homotest, implode */
+#include "parse.h"           /* for t_basic */
+
+
+enum {
+  bk_none, bk_sum, bk_tally, bk_max, bk_min, bk_first
+};
+
+#define KEYMIX(v) ((nialint) (((size_t) (v)) * (size_t) 2654435761u))
+
+/* routine to give the hash of item i of the key list a */
+
+static nialint
+keyhash(nialptr a, nialint i)
+{
+  switch (kind(a)) {
+    case inttype:
+        return (KEYMIX(fetch_int(a, i)));
+    case booltype:
+        return (fetch_bool(a, i));
+    case chartype:
+        return (KEYMIX(fetch_char(a, i)));
+    case realtype:
+        {
+          double      r = fetch_real(a, i);
+          nialint     bits = 0;
+
+          if (r != 0.)       /* 0. and -0. are equal */
+            memcpy(&bits, &r, sizeof r < sizeof bits ? sizeof r : sizeof bits);
+          return (KEYMIX(bits));
+        }
+    default:                 /* atype */
+        return (hasharray(fetch_array(a, i)));
+  }
+}
+
+/* routine to test whether items i and j of the key list a are equal */
+
+static int
+keyequal(nialptr a, nialint i, nialint j)
+{
+  switch (kind(a)) {
+    case inttype:
+        return (fetch_int(a, i) == fetch_int(a, j));
+    case booltype:
+        return (fetch_bool(a, i) == fetch_bool(a, j));
+    case chartype:
+        return (fetch_char(a, i) == fetch_char(a, j));
+    case realtype:
+        return (fetch_real(a, i) == fetch_real(a, j));
+    default:                 /* atype */
+        return (equal(fetch_array(a, i), fetch_array(a, j)));
+  }
+}
+
+/* routine to put the group of each item of a in gid and the index of the
+   first item of each group in rep. It gives the number of groups. No
+   array is made, so the pointers stay valid. */
+
+static nialint
+keygroups(nialptr a, nialint * gid, nialint * rep)
+{
+  nialint     n = tally(a),
+              size = 2,
+              ngroups = 0,
+              i;
+  nialint    *slots,
+             *ghash;
+
+  while (size < 2 * n)
+    size *= 2;
+  slots = malloc(size * sizeof(nialint));
+  ghash = malloc(n * sizeof(nialint));
+  if (slots == NULL || ghash == NULL) {
+    free(slots);
+    free(ghash);
+    return (-1);
+  }
+  for (i = 0; i < size; i++)
+    slots[i] = -1;
+
+  for (i = 0; i < n; i++) {
+    nialint     h = keyhash(a, i),
+                s = h & (size - 1),
+                g;
+
+    while ((g = slots[s]) >= 0 &&
+           (ghash[g] != h || !keyequal(a, i, rep[g])))
+      s = (s + 1) & (size - 1);
+    if (g < 0) {             /* a new key */
+      g = ngroups++;
+      slots[s] = g;
+      ghash[g] = h;
+      rep[g] = i;
+    }
+    gid[i] = g;
+  }
+  free(slots);
+  free(ghash);
+  return (ngroups);
+}
+
+/* routine to give the reduction done for the primitive f */
+
+static int
+bykeyop(nialptr f)
+{
+  void        (*g) (void);
+
+  if (tag(f) != t_basic)
+    return bk_none;
+  g = applytab[get_index(f)];
+  if (g == isum)
+    return bk_sum;
+  if (g == itally)
+    return bk_tally;
+  if (g == imax)
+    return bk_max;
+  if (g == imin)
+    return bk_min;
+  if (g == ifirst)
+    return bk_first;
+  return bk_none;
+}
+
+/* routine to compute the reductions of the groups directly. The result
+   is invalidptr if it is not done here. */
+
+static nialptr
+reducegroups(int op, nialptr b, nialptr gids, nialptr reps, nialint ngroups)
+{
+  nialint     n = tally(b),
+              i,
+              g;
+  nialint    *gid,
+             *rep;
+  int         kb = kind(b);
+  nialptr     z;
+
+  switch (op) {
+    case bk_tally:
+        {
+          nialint    *cnt;
+
+          z = new_create_array(inttype, 1, 0, &ngroups);
+          gid = pfirstint(gids);  /* safe: no allocation */
+          cnt = pfirstint(z);
+          for (g = 0; g < ngroups; g++)
+            cnt[g] = 0;
+          for (i = 0; i < n; i++)
+            cnt[gid[i]]++;
+          return (z);
+        }
+
+    case bk_first:
+        if (homotype(kb)) {
+          z = new_create_array(kb, 1, 0, &ngroups);
+          for (g = 0; g < ngroups; g++)
+            copy1(z, g, b, fetch_int(reps, g));
+        }
+        else {
+          z = new_create_array(atype, 1, 0, &ngroups);
+          for (g = 0; g < ngroups; g++)
+            store_array(z, g, fetch_array(b, fetch_int(reps, g)));
+          if (homotest(z))
+            z = implode(z);
+        }
+        return (z);
+
+    case bk_sum:
+    case bk_max:
+    case bk_min:
+        if (kb == inttype) {
+          nialint    *x,
+                     *s;
+
+          z = new_create_array(inttype, 1, 0, &ngroups);
+          gid = pfirstint(gids);  /* safe: no allocation */
+          rep = pfirstint(reps);
+          x = pfirstint(b);
+          s = pfirstint(z);
+          for (g = 0; g < ngroups; g++)
+            s[g] = (op == bk_sum ? 0 : x[rep[g]]);
+          for (i = 0; i < n; i++) {
+            nialint     it = x[i],
+                       *r = &s[gid[i]];
+
+            if (op == bk_sum) {
+              if (safeintadd(*r, it, r)) {
+                freeup(z);
+                return invalidptr;
+              }
+            }
+            else if (op == bk_max ? it > *r : it < *r)
+              *r = it;
+          }
+          return (z);
+        }
+        if (kb == realtype) {
+          double     *x,
+                     *s;
+
+          z = new_create_array(realtype, 1, 0, &ngroups);
+          gid = pfirstint(gids);  /* safe: no allocation */
+          rep = pfirstint(reps);
+          x = pfirstreal(b);
+          s = pfirstreal(z);
+          for (g = 0; g < ngroups; g++)
+            s[g] = (op == bk_sum ? 0.0 : x[rep[g]]);
+          for (i = 0; i < n; i++) {
+            double      it = x[i],
+                       *r = &s[gid[i]];
+
+            if (op == bk_sum)
+              *r += it;
+            else if (op == bk_max ? it > *r : it < *r)
+              *r = it;
+          }
+          return (z);
+        }
+        break;
+  }
+  return invalidptr;
+}
+
+/* routine to make each group of b as a list and apply f to it */
+
+static nialptr
+applygroups(nialptr f, nialptr b, nialptr gids, nialint ngroups)
+{
+  nialint     n = tally(b),
+              i,
+              g;
+  nialptr     starts,
+              order,
+              z;
+  nialint    *gid,
+             *st,
+             *ord;
+
+  /* count the items of each group and list the items in group order */
+  starts = new_create_array(inttype, 1, 0, &ngroups);
+  apush(starts);
+  order = new_create_array(inttype, 1, 0, &n);
+  apush(order);
+  gid = pfirstint(gids);     /* safe: no allocation until the groups */
+  st = pfirstint(starts);
+  ord = pfirstint(order);
+  for (g = 0; g < ngroups; g++)
+    st[g] = 0;
+  for (i = 0; i < n; i++)
+    st[gid[i]]++;
+  for (g = 0, i = 0; g < ngroups; g++) {
+    nialint     c = st[g];
+
+    st[g] = i;
+    i += c;
+  }
+  for (i = 0; i < n; i++)
+    ord[st[gid[i]]++] = i;   /* st[g] becomes the start of group g+1 */
+
+  z = new_create_array(atype, 1, 0, &ngroups);
+  apush(z);
+  for (g = 0; g < ngroups; g++) {
+    nialint     lo = (g == 0 ? 0 : fetch_int(starts, g - 1)),
+                cnt = fetch_int(starts, g) - lo;
+    nialptr     idx = new_create_array(inttype, 1, 0, &cnt);
+
+    memcpy(pfirstint(idx), pfirstint(order) + lo, cnt * sizeof(nialint));
+    choose(b, idx);
+    if (tag(f) == t_basic) { /* apply f as a primitive */
+      APPLYPRIMITIVE(f);
+
+#ifdef FP_EXCEPTION_FLAG
+      fp_checksignal();
+#endif
+    }
+    else
+      do_apply(f);  /* apply f as a parse tree */
+    store_array(z, g, apop());
+  }
+  apop();                    /* unprotect z */
+  freeup(apop());            /* free order */
+  freeup(apop());            /* free starts */
+  if (homotest(z))
+    z = implode(z);
+  return (z);
+}
+
+/* routine to compute K BYKEY f A for lists a and b. The result is
+   invalidptr if it is not done here. */
+
+nialptr
+bykey_groups(nialptr f, nialptr a, nialptr b)
+{
+  nialint     n = tally(a),
+              ngroups,
+              i;
+  nialptr     gids,
+              reps,
+              z = invalidptr;
+  int         op;
+
+  if (valence(a) != 1 || valence(b) != 1 || tally(b) != n || n == 0)
+    return invalidptr;
+  if (kind(a) == realtype)
+    for (i = 0; i < n; i++)
+      if (fetch_real(a, i) != fetch_real(a, i))
+        return invalidptr;   /* a NaN */
+
+  apush(a);                  /* protect a and b */
+  apush(b);
+  gids = new_create_array(inttype, 1, 0, &n);
+  apush(gids);
+  reps = new_create_array(inttype, 1, 0, &n);
+  apush(reps);
+  ngroups = keygroups(a, pfirstint(gids), pfirstint(reps));
+  if (ngroups >= 0) {
+    op = bykeyop(f);
+    if (op != bk_none)
+      z = reducegroups(op, b, gids, reps, ngroups);
+    if (z == invalidptr)
+      z = applygroups(f, b, gids, ngroups);
+  }
+  freeup(apop());            /* free reps */
+  freeup(apop());            /* free gids */
+  apop();                    /* unprotect b and a */
+  apop();
+  return (z);
+}
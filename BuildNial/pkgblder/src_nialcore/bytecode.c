@@ -0,0 +1,1318 @@
+/*==============================================================
+
+  MODULE   BYTECODE.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+
+  The bytecode compiler and the virtual machine that runs it.
+
+================================================================*/
+
+/* The tree walker n_eval dispatches on the tag of every node each time
+   the node is evaluated, fetching its fields from the heap and passing
+   every intermediate value through the stack. This module lowers the
+   body of an operation form, or a loop evaluated outside one, to a
+   compact sequence of integer instructions. The code is kept in the
+   last item of the parse tree node. That for an operation form is
+   built by the parser with the node, and that for a loop the first
+   time the loop is run, so it is built once, is saved with the
+   workspace, and goes away with the definition. A redefinition builds
+   a new tree, so no code is ever out of date.
+
+   Variables are resolved when the code is built. A local of the
+   operation being compiled is an offset from the stack pointer of its
+   symbol table, found once when the code starts. A global is its
+   symbol table entry. Other locals go through fetch_varnode. The symbol
+   table and the entries named in the code are also named by variable
+   nodes in the same tree, so they are pinned by heap compaction and
+   can be held as integers. Every other array the code uses is in the
+   literal list that holds the code.
+
+   The instructions for a basic binary operation address their
+   arguments directly when they are variables or constants, so the
+   common cases such as X + 1 or X < N do not go through the stack at
+   all, and the integer and real cases of the arithmetic and comparison
+   operations are done in line. Calls of other operations, and any
+   expression the compiler does not handle, use the same code as the
+   tree walker, the latter through an instruction that calls n_eval.
+
+   The machine is used only when nothing needs to see each step: not
+   when debugging, tracing or triggering on faults, or when the
+   "nobytecode setting is on. It uses threaded dispatch when the C
+   compiler supports labels as values and a switch otherwise.
+*/
+
+#include "switches.h"
+
+#ifdef BYTECODE
+
+/* standard library header files */
+
+/* IOLIB */
+#include <stdio.h>
+
+/* STLIB */
+#include <stdlib.h>
+
+/* SJLIB */
+#include <setjmp.h>
+
+/* Q'Nial header files */
+
+#include "bytecode.h"
+#include "qniallim.h"
+#include "absmach.h"
+#include "basics.h"
+#include "lib_main.h"
+#include "if.h"
+
+#include "eval.h"            /* for n_eval, apply, fetch_varnode etc. */
+#include "arith.h"           /* for safeintadd etc. */
+#include "ops.h"             /* for pair */
+#include "blders.h"          /* for get routines */
+#include "getters.h"         /* for get macros */
+#include "parse.h"           /* for parse tree node tags */
+#include "symtab.h"          /* for symbol table macros */
+#include "fuse.h"            /* for fusable, fused_eval */
+
+
+/* instruction codes. The operands follow the code in the order given. */
+
+enum {
+  bc_halt,                   /* end of code */
+  bc_pushc,                  /* k: push literal k */
+  bc_loads,                  /* offset: push a local of the frame */
+  bc_loadg,                  /* entry: push a global */
+  bc_loadv,                  /* k: push the variable of node k */
+  bc_stores,                 /* offset: store top in a local of the frame */
+  bc_storeg,                 /* entry: store top in a global */
+  bc_storev,                 /* k: store top in the variable of node k */
+  bc_assign,                 /* k: assign top to the name list k */
+  bc_pop,                    /* remove and free the top */
+  bc_binop,                  /* index fast mode a mode b mode u mode d:
+                                basic binary operation on a and b, with u
+                                the variable that may be updated in place
+                                and d the one the result is assigned to */
+  bc_prim,                   /* index mode u: basic unary operation */
+  bc_curried,                /* k mode u t: apply op k to the top pair,
+                                as a tail call if t is set */
+  bc_apply,                  /* k t: apply operation k to the top, as a
+                                tail call if t is set */
+  bc_mklist,                 /* n: make a list of the top n items */
+  bc_jump,                   /* target */
+  bc_loop,                   /* target: a jump that ends a loop pass */
+  bc_testb,                  /* false bad: pop a test value and jump to
+                                false or to bad if it is not a truth
+                                value */
+  bc_jexit,                  /* target: jump if an exit has been done */
+  bc_clearexit,              /* end of a loop */
+  bc_loopinit,               /* start of a while or repeat loop */
+  bc_forinit,                /* d: start of a for loop with depth d */
+  bc_fornext,                /* d mode v end: assign the next item to v */
+  bc_forend,                 /* remove the for loop values */
+  bc_eval,                   /* k: evaluate tree k with n_eval */
+  bc_fused,                  /* k target: evaluate tree k fused and jump
+                                to target if that can be done */
+  bc_forrange                /* d start: start of a for loop with depth d
+                                over the integers from start given the
+                                argument of tell or count */
+};
+
+/* operand modes */
+
+enum {
+  md_none, md_stack, md_slot, md_global, md_var, md_lit
+};
+
+/* basic binary operations done in line for atoms */
+
+enum {
+  fb_none, fb_plus, fb_minus, fb_times, fb_lt, fb_lte, fb_gt, fb_gte
+};
+
+/* the code array holds the frame symbol table and then the
+   instructions */
+
+#define CODESTART 1
+
+/* compiler state. The compiler does no evaluation, so one set of
+   buffers is enough. */
+
+static nialint *cbuf = NULL; /* instructions being built */
+static nialint clen,
+            ccap;
+static nialptr *lbuf = NULL; /* literals being built */
+static nialint llen,
+            lcap;
+static nialptr cfsym;        /* symbol table of the frame locals */
+static nialptr chint;        /* the one to use if it is seen */
+static int  cdepth;          /* for loop depth */
+static int  cfailed;         /* a buffer could not be extended */
+
+static void comp(nialptr exp, nialptr upd);
+
+
+/* routines to add to the buffers */
+
+static      nialint
+emit(nialint x)
+{
+  if (clen == ccap) {
+    nialint     newcap = (ccap == 0 ? VMCODESIZE : 2 * ccap);
+    nialint    *newbuf = (nialint *) realloc(cbuf, newcap * sizeof(nialint));
+
+    if (newbuf == NULL) {
+      cfailed = true;
+      return 0;
+    }
+    cbuf = newbuf;
+    ccap = newcap;
+  }
+  cbuf[clen] = x;
+  return clen++;
+}
+
+static      nialint
+literal(nialptr x)
+{
+  if (llen == lcap) {
+    nialint     newcap = (lcap == 0 ? VMCODESIZE : 2 * lcap);
+    nialptr    *newbuf = (nialptr *) realloc(lbuf, newcap * sizeof(nialptr));
+
+    if (newbuf == NULL) {
+      cfailed = true;
+      return 1;
+    }
+    lbuf = newbuf;
+    lcap = newcap;
+  }
+  lbuf[llen] = x;
+  return llen++;
+}
+
+/* routines to fill in the targets of jumps emitted earlier. Jumps to
+   the same place are chained through their target words until it is
+   known. */
+
+#define patch(at) { if (!cfailed) cbuf[at] = clen; }
+
+static      nialint
+chain(nialint prev)
+{
+  return emit(prev);
+}
+
+static void
+patchchain(nialint at)
+{
+  while (!cfailed && at != 0) {
+    nialint     prev = cbuf[at];
+
+    cbuf[at] = clen;
+    at = prev;
+  }
+}
+
+
+/* routine to choose the operand mode for a variable node */
+
+static void
+varoperand(nialptr var, nialint * mode, nialint * x)
+{
+  nialptr     sym = get_sym(var),
+              entr = get_entry(var);
+
+  if (sym == global_symtab) {
+    *mode = md_global;
+    *x = (nialint) entr;
+    return;
+  }
+  if (cfsym == invalidptr && (chint == invalidptr || sym == chint))
+    cfsym = sym;
+  if (sym == cfsym) {
+    *mode = md_slot;
+    *x = get_slot(var);
+  }
+  else {
+    *mode = md_var;
+    *x = literal(var);
+  }
+}
+
+/* a simple argument is fetched directly by the instruction using it */
+
+static int
+simplearg(nialptr exp)
+{
+  if (exp == Nullexpr || kind(exp) == faulttype)
+    return false;
+  if (tag(exp) == t_variable)
+    return true;
+  return tag(exp) == t_constant && kind(get_c_val(exp)) != faulttype;
+}
+
+static void
+argoperand(nialptr exp, nialint * mode, nialint * x)
+{
+  if (tag(exp) == t_variable)
+    varoperand(exp, mode, x);
+  else {
+    *mode = md_lit;
+    *x = literal(get_c_val(exp));
+  }
+}
+
+static void
+emitvarop(int slotop, nialptr var)
+{
+  nialint     mode,
+              x;
+
+  varoperand(var, &mode, &x);
+  emit(mode == md_slot ? slotop : mode == md_global ? slotop + 1 : slotop + 2);
+  emit(x);
+}
+
+/* routine to emit the update operand of a call */
+
+static void
+emitupdate(nialptr upd)
+{
+  nialint     mode,
+              x;
+
+  if (upd == invalidptr) {
+    emit(md_none);
+    emit(0);
+  }
+  else {
+    varoperand(upd, &mode, &x);
+    emit(mode);
+    emit(x);
+  }
+}
+
+/* routine to select the in line version of a basic binary operation */
+
+static int
+fastbinop(nialptr fn)
+{
+  void        (*f) (void) = binapplytab[get_binindex(fn)];
+
+  if (f == b_plus)
+    return fb_plus;
+  if (f == b_minus)
+    return fb_minus;
+  if (f == b_times)
+    return fb_times;
+  if (f == b_lt)
+    return fb_lt;
+  if (f == b_lte)
+    return fb_lte;
+  if (f == b_gt)
+    return fb_gt;
+  if (f == b_gte)
+    return fb_gte;
+  return fb_none;
+}
+
+/* routines to compile the pieces of an expression */
+
+static void
+compbinop(nialptr exp, nialptr upd, nialptr dest)
+{
+  nialptr     fn = get_op(exp),
+              a = get_argexpr(exp),
+              b = get_argexpr1(exp);
+  nialint     ma = md_stack,
+              xa = 0,
+              mb = md_stack,
+              xb = 0;
+
+  /* a simple left argument is only fetched late if the right one
+     cannot change it */
+  if (simplearg(a) && simplearg(b))
+    argoperand(a, &ma, &xa);
+  else
+    comp(a, invalidptr);
+  if (simplearg(b))
+    argoperand(b, &mb, &xb);
+  else
+    comp(b, invalidptr);
+  emit(bc_binop);
+  emit(get_binindex(fn));
+  emit(fastbinop(fn));
+  emit(ma);
+  emit(xa);
+  emit(mb);
+  emit(xb);
+  emitupdate(fn == appendcode || fn == hitchcode ? upd : invalidptr);
+  emitupdate(dest);
+}
+
+static void
+compopcall(nialptr exp, nialptr upd)
+{
+  nialptr     op = get_op(exp),
+              fn = (tag(op) == t_curried ? get_op(op) : op);
+
+  if (fn != placecode && fn != placeallcode && fn != appendcode &&
+      fn != hitchcode)
+    upd = invalidptr;
+  if (tag(op) == t_basic) {
+    comp(get_argexpr(exp), invalidptr);
+    emit(bc_prim);
+    emit(get_index(op));
+    emitupdate(upd);
+  }
+  else if (tag(op) == t_curried) {
+    comp(get_argexpr(op), invalidptr);
+    comp(get_argexpr(exp), invalidptr);
+    emit(bc_curried);
+    emit(literal(get_op(op)));
+    emitupdate(upd);
+    emit(upd == invalidptr && is_tailcall(exp));
+  }
+  else {
+    comp(get_argexpr(exp), invalidptr);
+    emit(bc_apply);
+    emit(literal(op));
+    emit(is_tailcall(exp));
+  }
+}
+
+static void
+compexprseq(nialptr exp)
+{
+  nialint     i,
+              tv = tally(exp),
+              exits = 0;
+
+  if (tv == 1) {
+    emit(bc_pushc);
+    emit(literal(Nullexpr));
+    return;
+  }
+  for (i = 1; i < tv; i++) {
+    comp(fetch_array(exp, i), invalidptr);
+    if (i < tv - 1) {        /* an exit skips the rest of the sequence */
+      emit(bc_jexit);
+      exits = chain(exits);
+      emit(bc_pop);
+    }
+  }
+  patchchain(exits);
+}
+
+static void
+compifexpr(nialptr exp)
+{
+  nialint     noexprs = tally(exp),
+              i = 1,
+              next,
+              ends = 0,
+              bads = 0;
+
+  while ((noexprs - i) > 1) {
+    comp(get_test(exp, i), invalidptr);
+    emit(bc_testb);
+    next = emit(0);
+    bads = chain(bads);
+    comp(get_thenexpr(exp, i), invalidptr);
+    emit(bc_jump);
+    ends = chain(ends);
+    patch(next);
+    i = i + 2;
+  }
+  if ((noexprs - i) == 1)
+    comp(get_elseexpr(exp, i), invalidptr);
+  else {
+    emit(bc_pushc);
+    emit(literal(Nullexpr));
+  }
+  emit(bc_jump);
+  next = emit(0);
+  /* a test that is not a truth value gives ?L */
+  patchchain(bads);
+  emit(bc_pushc);
+  emit(literal(Logical));
+  patch(next);
+  patchchain(ends);
+}
+
+static void
+compwhile(nialptr exp)
+{
+  nialint     start,
+              done,
+              quit,
+              bad;
+
+  emit(bc_loopinit);
+  start = clen;
+  comp(get_wtest(exp), invalidptr);
+  emit(bc_testb);
+  done = emit(0);
+  bad = emit(0);
+  emit(bc_pop);
+  comp(get_wexprseq(exp), invalidptr);
+  emit(bc_jexit);
+  quit = emit(0);
+  emit(bc_loop);
+  emit(start);
+  patch(bad);
+  emit(bc_pop);
+  emit(bc_pushc);
+  emit(literal(Logical));
+  patch(done);
+  patch(quit);
+  emit(bc_clearexit);
+}
+
+static void
+comprepeat(nialptr exp)
+{
+  nialint     start,
+              again,
+              done,
+              quit,
+              bad;
+
+  emit(bc_loopinit);
+  start = clen;
+  emit(bc_pop);
+  comp(get_rexprseq(exp), invalidptr);
+  emit(bc_jexit);
+  quit = emit(0);
+  comp(get_rtest(exp), invalidptr);
+  emit(bc_testb);
+  again = emit(0);
+  bad = emit(0);
+  emit(bc_jump);
+  done = emit(0);
+  patch(again);
+  emit(bc_loop);
+  emit(start);
+  patch(bad);
+  emit(bc_pop);
+  emit(bc_pushc);
+  emit(literal(Logical));
+  patch(done);
+  patch(quit);
+  emit(bc_clearexit);
+}
+
+static void
+compfor(nialptr exp)
+{
+  nialptr     idlist = get_idlist(exp);
+  nialint     next,
+              done,
+              quit,
+              mode,
+              x;
+
+  if (cdepth == VMMAXLOOPS) {
+    emit(bc_eval);
+    emit(literal(exp));
+    return;
+  }
+#ifdef FORRANGES
+  {
+    nialint     start;
+    nialptr     rangearg = forrange(get_expr(exp), &start);
+
+    if (rangearg != invalidptr) {
+      comp(rangearg, invalidptr);
+      emit(bc_forrange);
+      emit(cdepth);
+      emit(start);
+    }
+    else {
+      comp(get_expr(exp), invalidptr);
+      emit(bc_forinit);
+      emit(cdepth);
+    }
+  }
+#else
+  comp(get_expr(exp), invalidptr);
+  emit(bc_forinit);
+  emit(cdepth);
+#endif
+  next = clen;
+  if (tally(idlist) == 2)
+    varoperand(fetch_array(idlist, 1), &mode, &x);
+  else {
+    mode = md_lit;
+    x = literal(idlist);
+  }
+  emit(bc_fornext);
+  emit(cdepth);
+  emit(mode);
+  emit(x);
+  done = emit(0);
+  cdepth++;
+  comp(get_fexprseq(exp), invalidptr);
+  cdepth--;
+  emit(bc_jexit);
+  quit = emit(0);
+  emit(bc_loop);
+  emit(next);
+  patch(done);
+  patch(quit);
+  emit(bc_forend);
+}
+
+/* the compiler follows the cases of n_eval */
+
+static void
+comp(nialptr exp, nialptr upd)
+{
+  if (cfailed)
+    return;
+  if (exp == Nullexpr || kind(exp) == faulttype) {
+    emit(bc_pushc);
+    emit(literal(exp));
+    return;
+  }
+  switch (tag(exp)) {
+    case t_constant:
+        emit(bc_pushc);
+        emit(literal(get_c_val(exp)));
+        break;
+
+    case t_parsetree:
+        emit(bc_pushc);
+        emit(literal(exp));
+        break;
+
+    case t_nulltree:
+    case t_ext_declaration:
+    case t_commentexpr:
+        emit(bc_pushc);
+        emit(literal(Nullexpr));
+        break;
+
+    case t_variable:
+        emitvarop(bc_loads, exp);
+        break;
+
+    case t_basic_binopcall:
+    case t_opcall:
+        {
+          nialint     at = 0;
+
+#ifdef FUSION
+          /* a chain of arithmetic is tried fused first and the code
+             that follows is only run if that cannot be done */
+          if (fusable(exp)) {
+            emit(bc_fused);
+            emit(literal(exp));
+            at = emit(0);
+          }
+#endif
+          if (tag(exp) == t_opcall)
+            compopcall(exp, upd);
+          else
+            compbinop(exp, upd, invalidptr);
+          if (at != 0)
+            patch(at);
+        }
+        break;
+
+    case t_list:
+        if (tally(exp) == 1) {
+          emit(bc_pushc);
+          emit(literal(Null));
+          break;
+        }
+        /* else fall through to strand */
+
+    case t_strand:
+        {
+          nialint     i;
+
+          for (i = 1; i < tally(exp); i++)
+            comp(fetch_array(exp, i), invalidptr);
+          emit(bc_mklist);
+          emit(tally(exp) - 1);
+        }
+        break;
+
+    case t_defnseq:
+    case t_exprseq:
+        if (tally(exp) == 2)
+          comp(fetch_array(exp, 1), invalidptr);
+        else
+          compexprseq(exp);
+        break;
+
+    case t_assignexpr:
+        {
+          nialptr     idlist = get_idlist(exp);
+
+          if (tally(idlist) == 2) {
+            nialptr     var = fetch_array(idlist, 1),
+                        rhs = get_expr(exp);
+
+            /* a basic binary operation assigns its own result */
+            if (tag(rhs) == t_basic_binopcall
+#ifdef FUSION
+                && !fusable(rhs)
+#endif
+              )
+              compbinop(rhs, var, var);
+            else {
+              comp(rhs, var);
+              emitvarop(bc_stores, var);
+            }
+          }
+          else {
+            comp(get_expr(exp), invalidptr);
+            emit(bc_assign);
+            emit(literal(idlist));
+          }
+        }
+        break;
+
+    case t_ifexpr:
+        compifexpr(exp);
+        break;
+
+    case t_whileexpr:
+        compwhile(exp);
+        break;
+
+    case t_repeatexpr:
+        comprepeat(exp);
+        break;
+
+    case t_forexpr:
+        compfor(exp);
+        break;
+
+    case t_parendobj:
+    case t_dottedobj:
+        comp(get_obj(exp), invalidptr);
+        break;
+
+    default:
+        emit(bc_eval);
+        emit(literal(exp));
+  }
+}
+
+/* routine to compile exp. fsym is the symbol table of the operation
+   form being compiled, or invalidptr for a loop. The result is a list
+   holding the instructions followed by the literals. */
+
+static      nialptr
+compile(nialptr exp, nialptr fsym)
+{
+  nialptr     code,
+              z;
+  nialint     i;
+
+  clen = 0;
+  llen = 0;
+  cdepth = 0;
+  cfailed = false;
+  cfsym = invalidptr;
+  chint = fsym;
+  emit(0);                   /* frame symbol table */
+  literal(Null);             /* place for the code */
+  comp(exp, invalidptr);
+  emit(bc_halt);
+  if (cfailed)
+    return invalidptr;
+  cbuf[0] = (nialint) cfsym;
+  code = new_create_array(inttype, 1, 0, &clen);
+  for (i = 0; i < clen; i++)
+    store_int(code, i, cbuf[i]);
+  lbuf[0] = code;
+  z = new_create_array(atype, 1, 0, &llen);
+  for (i = 0; i < llen; i++)
+    store_array(z, i, lbuf[i]);
+  return z;
+}
+
+
+/* routines used by the machine to fetch and store operands */
+
+static      nialptr
+fetchop(nialint mode, nialint x, nialint base, nialptr lits)
+{
+  switch (mode) {
+    case md_slot:
+        return stkarea[base + x];
+    case md_global:
+        return sym_valu((nialptr) x);
+    case md_var:
+        {
+          nialptr     var = fetch_array(lits, x);
+
+          return fetch_varnode(var);
+        }
+    default:
+        return fetch_array(lits, x);
+  }
+}
+
+static int
+storeop(nialint mode, nialint x, nialint base, nialptr lits, nialptr v)
+{
+  switch (mode) {
+    case md_slot:
+        {
+          nialptr     oldv = stkarea[base + x];
+
+          stkarea[base + x] = v;
+          incrrefcnt(v);
+          decrrefcnt(oldv);
+          freeup(oldv);
+        }
+        return true;
+    case md_global:
+        st_s_valu((nialptr) x, v);
+        return true;
+    case md_var:
+        {
+          nialptr     var = fetch_array(lits, x);
+
+          return store_varnode(var, v);
+        }
+    default:
+        return assign(fetch_array(lits, x), v, false, true);
+  }
+}
+
+/* routine to assign the top of the stack, replacing it with a fault if
+   the assignment fails */
+
+static void
+assigntop(nialint mode, nialint x, nialint base, nialptr lits)
+{
+  if (!storeop(mode, x, base, lits, top)) {
+    freeup(apop());
+    apush(makefault("?assignment"));
+  }
+}
+
+/* routine to find the value of a variable that holds an unshared
+   number atom. A number result to be assigned to the variable can
+   replace the number in it rather than be created. */
+
+static      nialptr
+ownedatom(nialint mode, nialint x, nialint base)
+{
+  nialptr     v;
+
+  if (mode == md_slot)
+    v = stkarea[base + x];
+  else if (mode == md_global)
+    v = sym_valu((nialptr) x);
+  else
+    return invalidptr;
+  if (valence(v) == 0 && refcnt(v) == 1 &&
+      (kind(v) == inttype || kind(v) == realtype))
+    return v;
+  return invalidptr;
+}
+
+#define newint(r) (into != invalidptr && kind(into) == inttype ?\
+                   (store_int(into, 0, r), into) : createint(r))
+#define newreal(r) (into != invalidptr && kind(into) == realtype ?\
+                   (store_real(into, 0, r), into) : createreal(r))
+
+/* routine to do a basic binary operation on two atoms in line, using
+   into for the result if it can. Returns invalidptr if it is not a case
+   done here. */
+
+static      nialptr
+fastresult(int fast, nialptr a, nialptr b, nialptr into)
+{
+  int         ka = kind(a);
+  nialint     r;
+
+  if (ka != kind(b) || valence(a) != 0 || valence(b) != 0)
+    return invalidptr;
+  if (ka == inttype) {
+    nialint     x = intval(a),
+                y = intval(b);
+
+    switch (fast) {
+      case fb_plus:
+          return (safeintadd(x, y, &r) ? invalidptr : newint(r));
+      case fb_minus:
+          return (safeintsub(x, y, &r) ? invalidptr : newint(r));
+      case fb_times:
+          return (safeintmult(x, y, &r) ? invalidptr : newint(r));
+      case fb_lt:
+          return createbool(x < y);
+      case fb_lte:
+          return createbool(x <= y);
+      case fb_gt:
+          return createbool(x > y);
+      case fb_gte:
+          return createbool(x >= y);
+    }
+  }
+  else if (ka == realtype) {
+    double      x = realval(a),
+                y = realval(b);
+
+    switch (fast) {
+      case fb_plus:
+          return newreal(x + y);
+      case fb_minus:
+          return newreal(x - y);
+      case fb_times:
+          return newreal(x * y);
+      case fb_lt:
+          return createbool(x < y);
+      case fb_lte:
+          return createbool(x <= y);
+      case fb_gt:
+          return createbool(x > y);
+      case fb_gte:
+          return createbool(x >= y);
+    }
+  }
+  return invalidptr;
+}
+
+/* the machine. lits is the list holding the code and base is the stack
+   position of the frame locals. */
+
+#ifdef __GNUC__
+#define THREADED
+#endif
+
+#ifdef THREADED
+#define VMCASE(op) L_##op:
+#define VMNEXT(n) { ip += (n); pc = pfirstint(code) + ip; goto *labels[*pc]; }
+#define VMGOTO(t) { ip = (t); pc = pfirstint(code) + ip; goto *labels[*pc]; }
+#else
+#define VMCASE(op) case op:
+#define VMNEXT(n) { ip += (n); continue; }
+#define VMGOTO(t) { ip = (t); continue; }
+#endif
+
+static void
+run(nialptr lits, nialint base)
+{
+  nialptr     code = fetch_array(lits, 0);
+  nialint     ip = CODESTART,
+             *pc,
+              forcnt[VMMAXLOOPS],
+              forlim[VMMAXLOOPS], /* count of a range or -1 */
+              forstart[VMMAXLOOPS];
+
+#ifdef THREADED
+  static void *labels[] = {
+    &&L_bc_halt, &&L_bc_pushc, &&L_bc_loads, &&L_bc_loadg, &&L_bc_loadv,
+    &&L_bc_stores, &&L_bc_storeg, &&L_bc_storev, &&L_bc_assign, &&L_bc_pop,
+    &&L_bc_binop, &&L_bc_prim, &&L_bc_curried, &&L_bc_apply, &&L_bc_mklist,
+    &&L_bc_jump, &&L_bc_loop, &&L_bc_testb, &&L_bc_jexit, &&L_bc_clearexit,
+    &&L_bc_loopinit, &&L_bc_forinit, &&L_bc_fornext, &&L_bc_forend,
+    &&L_bc_eval, &&L_bc_fused, &&L_bc_forrange
+  };
+
+  VMGOTO(CODESTART);
+#else
+  for (;;) {
+    pc = pfirstint(code) + ip;
+    switch (*pc) {
+#endif
+
+      /* the operands of an instruction are read before anything is
+         allocated, since the heap may move when it is expanded */
+
+      VMCASE(bc_halt)
+        return;
+
+      VMCASE(bc_pushc)
+      {
+        nialptr     v = fetch_array(lits, pc[1]);
+
+        if (triggered && kind(v) == faulttype &&
+            v != Nullexpr && v != Eoffault && v != Zenith && v != Nadir)
+          v = makefault(pfirstchar(v)); /* force a triggering */
+        apush(v);
+        VMNEXT(2);
+      }
+
+      VMCASE(bc_loads)
+        apush(stkarea[base + pc[1]]);
+        VMNEXT(2);
+
+      VMCASE(bc_loadg)
+        apush(sym_valu((nialptr) pc[1]));
+        VMNEXT(2);
+
+      VMCASE(bc_loadv)
+        apush(fetchop(md_var, pc[1], base, lits));
+        VMNEXT(2);
+
+      VMCASE(bc_stores)
+        storeop(md_slot, pc[1], base, lits, top);
+        VMNEXT(2);
+
+      VMCASE(bc_storeg)
+        storeop(md_global, pc[1], base, lits, top);
+        VMNEXT(2);
+
+      VMCASE(bc_storev)
+        assigntop(md_var, pc[1], base, lits);
+        VMNEXT(2);
+
+      VMCASE(bc_assign)
+        assigntop(md_lit, pc[1], base, lits);
+        VMNEXT(2);
+
+      VMCASE(bc_pop)
+        freeup(apop());
+        VMNEXT(1);
+
+      VMCASE(bc_binop)
+      {
+        nialint     index = pc[1],
+                    fast = pc[2],
+                    ma = pc[3],
+                    xa = pc[4],
+                    mb = pc[5],
+                    xb = pc[6],
+                    mu = pc[7],
+                    u = pc[8],
+                    md = pc[9],
+                    xd = pc[10];
+        nialptr     a,
+                    b,
+                    z = invalidptr,
+                    arg = Null;
+        int         argflag = false;
+
+        if (mb == md_stack) {
+          b = top;
+          a = (ma == md_stack ? topm1 : fetchop(ma, xa, base, lits));
+        }
+        else {
+          b = fetchop(mb, xb, base, lits);
+          a = (ma == md_stack ? top : fetchop(ma, xa, base, lits));
+        }
+        if (fast != fb_none) {
+          nialptr     into = ownedatom(md, xd, base);
+
+          /* a number only held by the stack can also take the result */
+          if (into == invalidptr && ma == md_stack && refcnt(a) == 1)
+            into = a;
+          z = fastresult((int) fast, a, b, into);
+        }
+        if (z != invalidptr) {
+          apush(z);          /* protects z if it is an argument */
+          if (mb == md_stack) {
+            swap();
+            freeup(apop());
+          }
+          if (ma == md_stack) {
+            swap();
+            freeup(apop());
+          }
+          if (md != md_none && z != fetchop(md, xd, base, lits))
+            assigntop(md, xd, base, lits);
+          VMNEXT(11);
+        }
+        if (ma != md_stack)
+          apush(a);
+        if (mb != md_stack)
+          apush(b);
+        if (kind(top) == phrasetype || kind(top) == faulttype) {
+          if (top == topm1) {
+            argflag = true;
+            arg = top;
+            incrrefcnt(top);
+          }
+        }
+        if (mu != md_none)
+          updatevalue = fetchop(mu, u, base, lits);
+        (*binapplytab[index]) ();
+        updatevalue = invalidptr;
+#ifdef FP_EXCEPTION_FLAG
+        fp_checksignal();
+#endif
+        if (argflag) {
+          decrrefcnt(arg);
+          freeup(arg);
+        }
+        if (md != md_none)
+          assigntop(md, xd, base, lits);
+        VMNEXT(11);
+      }
+
+      VMCASE(bc_prim)
+      {
+        nialint     index = pc[1],
+                    mu = pc[2];
+
+        if (mu != md_none)
+          updatevalue = fetchop(mu, pc[3], base, lits);
+        (*applytab[index]) ();
+        updatevalue = invalidptr;
+#ifdef FP_EXCEPTION_FLAG
+        fp_checksignal();
+#endif
+        VMNEXT(4);
+      }
+
+      VMCASE(bc_curried)
+      {
+        nialptr     op = fetch_array(lits, pc[1]),
+                    leftval,
+                    rightval;
+        nialint     mu = pc[2],
+                    u = pc[3],
+                    t = pc[4];
+        int         leftflag,
+                    rightflag;
+
+        rightval = apop();
+        leftval = apop();
+        /* protect phrase and fault arguments as in n_eval */
+        leftflag = kind(leftval) >= phrasetype;
+        if (leftflag)
+          apush(leftval);
+        rightflag = kind(rightval) >= phrasetype;
+        if (rightflag)
+          apush(rightval);
+        pair(leftval, rightval);
+        if (mu != md_none)
+          updatevalue = fetchop(mu, u, base, lits);
+#ifdef TAILCALLS
+        if (!t || !tailcall(op))
+#endif
+          apply(op);
+        updatevalue = invalidptr;
+        if (rightflag) {
+          swap();
+          freeup(apop());
+        }
+        if (leftflag) {
+          swap();
+          freeup(apop());
+        }
+        VMNEXT(5);
+      }
+
+      VMCASE(bc_apply)
+      {
+        nialptr     op = fetch_array(lits, pc[1]);
+
+#ifdef TAILCALLS
+        if (!pc[2] || !tailcall(op))
+#endif
+          apply(op);
+        VMNEXT(3);
+      }
+
+      VMCASE(bc_mklist)
+        mklist(pc[1]);
+        VMNEXT(2);
+
+      VMCASE(bc_jump)
+        VMGOTO(pc[1]);
+
+      VMCASE(bc_loop)
+      {
+        nialint     target = pc[1];
+
+#ifdef USER_BREAK_FLAG
+        checksignal(NC_CS_NORMAL);
+#endif
+        VMGOTO(target);
+      }
+
+      VMCASE(bc_testb)
+      {
+        nialptr     val = apop();
+        nialint     target;
+
+        if (kind(val) == booltype && valence(val) == 0)
+          target = (boolval(val) ? ip + 3 : pc[1]);
+        else
+          target = pc[2];
+        freeup(val);
+        VMGOTO(target);
+      }
+
+      VMCASE(bc_jexit)
+        if (nialexitflag)
+          VMGOTO(pc[1]);
+        VMNEXT(2);
+
+      VMCASE(bc_clearexit)
+        nialexitflag = false;
+        VMNEXT(1);
+
+      VMCASE(bc_loopinit)
+        nialexitflag = false;
+        apush(Nullexpr);
+        VMNEXT(1);
+
+      /* a for loop keeps the array of values under the loop value on
+         the stack, so that it is released if the loop is abandoned */
+
+      VMCASE(bc_forinit)
+        forcnt[pc[1]] = 0;
+        forlim[pc[1]] = -1;
+        nialexitflag = false;
+        apush(Nullexpr);
+        VMNEXT(2);
+
+      VMCASE(bc_forrange)
+        /* an integer is stepped through, anything else is made into the
+           list of tell or count as usual */
+        forcnt[pc[1]] = 0;
+        forlim[pc[1]] = -1;
+        if (isint(top) && intval(top) >= 0) {
+          forlim[pc[1]] = intval(top);
+          forstart[pc[1]] = pc[2];
+        }
+        else if (pc[2] == 0)
+          itell();
+        else
+          icount();
+        nialexitflag = false;
+        apush(Nullexpr);
+        VMNEXT(3);
+
+      VMCASE(bc_fornext)
+      {
+        nialint     d = pc[1],
+                    mode = pc[2],
+                    x = pc[3],
+                    done = pc[4];
+        nialptr     val;
+
+        if (forlim[d] >= 0) {  /* a range */
+          nialint     i = forstart[d] + forcnt[d];
+
+          if (forcnt[d] >= forlim[d])
+            VMGOTO(done);
+          forcnt[d]++;
+          freeup(apop());
+          val = ownedatom(mode, x, base);
+          if (val != invalidptr && kind(val) == inttype) {
+            store_int(val, 0, i);
+            VMNEXT(5);
+          }
+          val = createint(i);
+          apush(val);
+          storeop(mode, x, base, lits, val);
+          apop();
+          freeup(val);
+          VMNEXT(5);
+        }
+        if (forcnt[d] >= tally(topm1))
+          VMGOTO(done);
+        freeup(apop());      /* previous loop value */
+        val = ownedatom(mode, x, base);
+        if (val != invalidptr && kind(val) == kind(top)) {
+          /* replace the number held by the loop variable */
+          if (kind(val) == inttype)
+            store_int(val, 0, fetch_int(top, forcnt[d]));
+          else
+            store_real(val, 0, fetch_real(top, forcnt[d]));
+          forcnt[d]++;
+          VMNEXT(5);
+        }
+        val = fetchasarray(top, forcnt[d]);
+        forcnt[d]++;
+        apush(val);
+        storeop(mode, x, base, lits, val);
+        apop();
+        freeup(val);
+        VMNEXT(5);
+      }
+
+      VMCASE(bc_forend)
+        nialexitflag = false;
+        swap();
+        freeup(apop());
+        VMNEXT(1);
+
+      VMCASE(bc_eval)
+        n_eval(fetch_array(lits, pc[1]));
+        VMNEXT(2);
+
+      VMCASE(bc_fused)
+#ifdef FUSION
+        if (fused_eval(fetch_array(lits, pc[1])))
+          VMGOTO(pc[2]);
+#endif
+        VMNEXT(3);
+
+#ifndef THREADED
+    }
+  }
+#endif
+}
+
+/* routine to build the bytecode for exp, the body of an operation
+   form or a loop held in the parse tree node holder. fsym is the
+   symbol table of the operation form locals or invalidptr. */
+
+void
+vm_build(nialptr holder, nialptr exp, nialptr fsym)
+{
+  nialptr     lits = compile(exp, fsym);
+
+  if (lits != invalidptr)
+    replace_array(holder, vm_slot(holder), lits);
+}
+
+/* routine to run the bytecode for a holder as above. The code for an
+   operation form is built with it. That for a loop evaluated by n_eval
+   is built on its first use. Returns false if the tree walker must be
+   used instead. */
+
+int
+vm_eval(nialptr holder, nialptr exp)
+{
+  nialptr     lits,
+              sym;
+  nialint     size,
+              base = 0;
+
+  switch (tag(holder)) {
+    case t_opform:
+        size = 7;
+        break;
+    case t_forexpr:
+        size = 5;
+        break;
+    default:
+        size = 4;
+  }
+  if (tally(holder) != size) /* tree from an older workspace */
+    return false;
+  lits = fetch_array(holder, vm_slot(holder));
+  if (lits == Null) {
+    vm_build(holder, exp, invalidptr);
+    lits = fetch_array(holder, vm_slot(holder));
+    if (lits == Null)
+      return false;
+  }
+  sym = (nialptr) fetch_int(fetch_array(lits, 0), 0);
+  if (sym != invalidptr) {
+    base = get_spval(sym);
+    if (base == -1)          /* locals are out of context */
+      return false;
+  }
+  if (CSTACKFULL)
+    longjmp(error_env, NC_WARNING);
+  run(lits, base);
+  return true;
+}
+
+#endif
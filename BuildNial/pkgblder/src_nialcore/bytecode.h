@@ -0,0 +1,31 @@
+/*==============================================================
+
+  BYTECODE.H:  header for BYTECODE.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+  This contains the prototypes and macros for the bytecode
+  compiler and the virtual machine that runs it
+
+================================================================*/
+
+#ifndef _BYTECODE_H_
+#define _BYTECODE_H_
+
+#ifdef BYTECODE
+
+/* The bytecode for an operation form or a loop is kept in the last
+   item of its parse tree node. It is Null until it has been built. */
+
+#define vm_slot(x) (tally(x) - 1)
+
+/* the virtual machine is used when nothing needs to see each step */
+
+#define vm_ready (bytecode && !debugging_on && !trace && !triggered)
+
+extern void vm_build(nialptr holder, nialptr exp, nialptr fsym);
+extern int  vm_eval(nialptr holder, nialptr exp);
+
+#endif
+
+#endif
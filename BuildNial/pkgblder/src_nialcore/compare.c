@@ -31,6 +31,9 @@
 /* LIMITLIB */
 #include <limits.h>
 
+/* STLIB */
+#include <string.h>
+
 /* STDLIB */
 #include <stdlib.h>
 
@@ -51,15 +54,17 @@
 #include "faults.h"          /* for logical fault */
 #include "logicops.h"        /* for orbools and andbools */
 #include "ops.h"             /* for simple and splifb */
+#include "parallel.h"        /* for par_for */
 
 
 /* declaration of internal static routines */
 
+static int  extremeints(nialint lo, nialint hi, void *arg);
+static int  extremereals(nialint lo, nialint hi, void *arg);
 static nialint  maxints(nialint * ptrx, nialint n);
 static int  maxchars(char *ptrx, nialint n);
 static double maxreals(double *ptrx, nialint n);
 static void maxintvectors(nialint * x, nialint * y, nialint * z, nialint n);
-static void maxintscalarvector(nialint x, nialint * y, nialint * z, nialint n);
 static void maxrealvectors(double *x, double *y, double *z, nialint n);
 static void maxrealscalarvector(double x, double *y, double *z, nialint n);
 static void maxcharvectors(char *x, char *y, char *z, nialint n);
@@ -68,7 +73,6 @@ static int  minchars(char *ptrx, nialint n);
 static nialint  minints(nialint * ptrx, nialint n);
 static double minreals(double *ptrx, nialint n);
 static void minintvectors(nialint * x, nialint * y, nialint * z, nialint n);
-static void minintscalarvector(nialint x, nialint * y, nialint * z, nialint n);
 static void minrealvectors(double *x, double *y, double *z, nialint n);
 static void minrealscalarvector(double x, double *y, double *z, nialint n);
 static void mincharvectors(char *x, char *y, char *z, nialint n);
@@ -321,6 +325,111 @@ imax()
   freeup(x);
 }
 
+/* The largest or smallest item of a large array is found in parts by
+   par_for. Each part keeps the first of its largest items by the same
+   test as the serial loops below and the parts are then compared in
+   order, which gives the same item. A NaN makes the real case use the
+   serial loop, since the result then depends on the order. */
+
+struct extremes {
+  void       *x;
+  int         ismax;
+  nialint     chunk,
+              ipart[PARMAXTHREADS];
+  double      rpart[PARMAXTHREADS];
+};
+
+static int
+extremeints(nialint lo, nialint hi, void *arg)
+{
+  struct extremes *e = arg;
+  nialint    *x = e->x,
+              s = x[lo],
+              i;
+
+  if (e->ismax) {
+    for (i = lo + 1; i < hi; i++)
+      if (x[i] > s)
+        s = x[i];
+  }
+  else
+    for (i = lo + 1; i < hi; i++)
+      if (x[i] < s)
+        s = x[i];
+  e->ipart[lo / e->chunk] = s;
+  return true;
+}
+
+static int
+extremereals(nialint lo, nialint hi, void *arg)
+{
+  struct extremes *e = arg;
+  double     *x = e->x,
+              s = x[lo];
+  nialint     i;
+
+  if (s != s)
+    return false;
+  for (i = lo + 1; i < hi; i++) {
+    double      it = x[i];
+
+    if (it != it)
+      return false;
+    if (e->ismax ? it > s : it < s)
+      s = it;
+  }
+  e->rpart[lo / e->chunk] = s;
+  return true;
+}
+
+/* routines to find the extreme of a large array in parts. They return
+   false if the serial loop is to be used. */
+
+static int
+parextremeint(nialint * ptrx, nialint n, int ismax, nialint * res)
+{
+  static struct extremes e;
+  int         parts = par_parts(n),
+              p;
+  nialint     s;
+
+  if (parts <= 1)
+    return false;
+  e.x = ptrx;
+  e.ismax = ismax;
+  e.chunk = PARCHUNK(n, parts);
+  par_for(n, extremeints, &e);
+  s = e.ipart[0];
+  for (p = 1; p < parts; p++)
+    if (ismax ? e.ipart[p] > s : e.ipart[p] < s)
+      s = e.ipart[p];
+  *res = s;
+  return true;
+}
+
+static int
+parextremereal(double *ptrx, nialint n, int ismax, double *res)
+{
+  static struct extremes e;
+  int         parts = par_parts(n),
+              p;
+  double      s;
+
+  if (parts <= 1)
+    return false;
+  e.x = ptrx;
+  e.ismax = ismax;
+  e.chunk = PARCHUNK(n, parts);
+  if (!par_for(n, extremereals, &e))
+    return false;
+  s = e.rpart[0];
+  for (p = 1; p < parts; p++)
+    if (ismax ? e.rpart[p] > s : e.rpart[p] < s)
+      s = e.rpart[p];
+  *res = s;
+  return true;
+}
+
 /* support routines for max. separated out so they can be calls
    to specialized routines for vector processors */
 
@@ -329,8 +438,11 @@ maxints(nialint * ptrx, nialint n)
 {
   nialint     i,
               it;
-  nialint     s = *ptrx++;
+  nialint     s;
 
+  if (parextremeint(ptrx, n, true, &s))
+    return (s);
+  s = *ptrx++;
   for (i = 1; i < n; i++) {
     it = *ptrx++;
     if (it > s)
@@ -364,8 +476,11 @@ maxreals(double *ptrx, nialint n)
 {
   nialint     i;
   double      it,
-              s = *ptrx++;
+              s;
 
+  if (parextremereal(ptrx, n, true, &s))
+    return (s);
+  s = *ptrx++;
   for (i = 1; i < n; i++) {
     it = *ptrx++;
     if (it > s)
@@ -388,7 +503,7 @@ maxintvectors(nialint * x, nialint * y, nialint * z, nialint n)
   }
 }
 
-static void
+void
 maxintscalarvector(nialint x, nialint * y, nialint * z, nialint n)
 {
   nialint     i,
@@ -714,8 +829,11 @@ minints(nialint * ptrx, nialint n)
 {
   nialint     i,
               it;
-  nialint     s = *ptrx++;
+  nialint     s;
 
+  if (parextremeint(ptrx, n, false, &s))
+    return (s);
+  s = *ptrx++;
   for (i = 1; i < n; i++) {
     it = *ptrx++;
     if (it < s)
@@ -729,8 +847,11 @@ minreals(double *ptrx, nialint n)
 {
   nialint     i;
   double      it,
-              s = *ptrx++;
+              s;
 
+  if (parextremereal(ptrx, n, false, &s))
+    return (s);
+  s = *ptrx++;
   for (i = 1; i < n; i++) {
     it = *ptrx++;
     if (it < s)
@@ -753,7 +874,7 @@ minintvectors(nialint * x, nialint * y, nialint * z, nialint n)
   }
 }
 
-static void
+void
 minintscalarvector(nialint x, nialint * y, nialint * z, nialint n)
 {
   nialint     i,
@@ -1711,6 +1832,67 @@ equal(nialptr x, nialptr y)
 }
 
 
+/* routine to compute a hash of an array that agrees with equal: arrays
+   that are equal have the same hash. It combines the kind, the shape
+   and the items, hashing a phrase or fault by its characters since its
+   address changes when the workspace is compacted. Used by MEMO. */
+
+#define HASHMIX(h,v) (((h) ^ (nialint) (v)) * (nialint) 1099511628211LL)
+
+nialint
+hasharray(nialptr x)
+{
+  int         k = kind(x),
+              v = valence(x);
+  nialint     t = tally(x),
+              h = (nialint) 2166136261LL,
+              i;
+  nialint    *shx = shpptr(x, v);
+
+  h = HASHMIX(h, k);
+  for (i = 0; i < v; i++)
+    h = HASHMIX(h, shx[i]);
+  switch (k) {
+    case atype:
+        for (i = 0; i < t; i++)
+          h = HASHMIX(h, hasharray(fetch_array(x, i)));
+        break;
+    case inttype:
+        for (i = 0; i < t; i++)
+          h = HASHMIX(h, fetch_int(x, i));
+        break;
+    case booltype:
+        for (i = 0; i < t; i++)
+          h = HASHMIX(h, fetch_bool(x, i));
+        break;
+    case chartype:
+        for (i = 0; i < t; i++)
+          h = HASHMIX(h, fetch_char(x, i));
+        break;
+    case realtype:
+        for (i = 0; i < t; i++) {
+          double      r = fetch_real(x, i);
+          nialint     bits = 0;
+
+          if (r != 0.)       /* 0. and -0. are equal */
+            memcpy(&bits, &r, sizeof r < sizeof bits ? sizeof r : sizeof bits);
+          h = HASHMIX(h, bits);
+        }
+        break;
+    case phrasetype:
+    case faulttype:
+        {
+          char       *s = pfirstchar(x);
+
+          while (*s)
+            h = HASHMIX(h, *s++);
+        }
+        break;
+  }
+  return (h);
+}
+
+
 /* routines to implement the primitive comparator : up 
    which returns the lexicographic comparison of a and b. The ordering
    is based on comparing the items. If the arrays are atomic
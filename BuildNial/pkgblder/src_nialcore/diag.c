@@ -178,6 +178,9 @@ chkfl()
 {
   nialptr     free;
 
+#ifdef SIZECLASSES
+  chkfreelists();
+#endif
   free = fwdlink(freelisthdr);
   /* test that free list items are marked correctly */
   while (free != TERMINATOR) {
@@ -209,12 +212,14 @@ memchk()
 
   addr = membase;
   free = fwdlink(freelisthdr);
+#ifndef SIZECLASSES
   if (free == TERMINATOR) {
     strcpy(buf, "memchk: the freelist is empty");
 /* This is okay if memchk is called at top of expand_heap, so do
    not halt.
 */
   }
+#endif
   /* test that free list items are marked correctly */
   while (free != TERMINATOR) {
       if ((freetag(free) != FREETAG || endptr(free) != -free) && freetag(free) != LOCKEDBLOCK) {
@@ -236,9 +241,13 @@ if (addr > 9900)
 nprintf(OF_DEBUG_LOG,"addr %d size %d\n",addr,blksize(addr));
 */
     if (isfree(addr)) {  /* check that it is on the free list */
+#ifdef SIZECLASSES
+      free = (onfreelist(addr) ? addr : TERMINATOR);
+#else
       free = fwdlink(freelisthdr);
       while (addr != free && free != TERMINATOR)
         free = fwdlink(free);
+#endif
       if (free != addr) {
         sprintf(buf, "memchk: free block encountered not on chain %ld\n", addr);
         puts(buf);
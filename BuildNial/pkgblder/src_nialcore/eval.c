@@ -82,6 +82,8 @@
 #include "compare.h"         /* for equal */
 #include "faults.h"          /* for fault macros */
 #include "insel.h"           /* for select, insert */
+#include "bytecode.h"        /* for vm_eval */
+#include "fuse.h"            /* for fused_eval */
 
 
 
@@ -90,6 +92,7 @@
 static void apply_transform(nialptr tr);
 static void prologue(nialptr env, nialint nvars, nialptr * senv);
 static void epilogue(nialptr senv, nialint nvars);
+static int  store_local(nialptr sym, nialptr entr, nialint offset, nialptr v);
 static void setup_env(nialptr syms, nialptr sps, nialptr * svenv);
 static void restore_env(nialptr syms, nialptr svenv);
 static void nct_throw_result(nialptr nfault, int rc_code);
@@ -359,7 +362,7 @@ recur:
           /* get the operation code */
           entr = get_entry(fn);
           sym = get_sym(fn);
-          op = fetch_var(sym, entr);
+          op = fetch_varnode(fn);
 
           if (d_next || is_systemop(fn)) {
             d_onestep = false;
@@ -429,15 +432,26 @@ recur:
     case t_opform:           /* apply operation form */
         {
           nialptr     save_env,
-                      args = get_arglist(fn),
-                      body = get_body(fn);
+                      args,
+                      body;
           nialptr     body_expr,
                       val;
-          nialint     nvars = get_cnt(fn);
-          int         bsw = tag(body) == t_blockbody;
+          nialint     nvars;
+          int         bsw;
+#ifdef TAILCALLS
+          nialptr     tailform = invalidptr;  /* the form of a tail call */
 
+        newform:
+#endif
+          args = get_arglist(fn);
+          body = get_body(fn);
+          nvars = get_cnt(fn);
+          bsw = tag(body) == t_blockbody;
           val = apop();      /* argument of the operation call */
           prologue(get_env(fn), nvars, &save_env);  /* set up the local env. */
+#ifdef TAILCALLS
+        newcall:
+#endif
           if (bsw) {         /* the body is a block */
             nialptr     defs = get_defs(body);
 
@@ -464,11 +478,58 @@ recur:
               showexpr(args, TRACE);
             }
             /* evaluate the body expression */
-            eval(body_expr);
+#ifdef BYTECODE
+            if (!vm_ready || !vm_eval(fn, body_expr))
+#endif
+              eval(body_expr);
           }
+#ifdef TAILCALLS
+          if (tailop != invalidptr) {
+            /* the body ended in a call of tailop with its argument on the
+               stack. A call of the same form reuses the activation record
+               with its locals cleared, another form is applied in a loop
+               after this one's record is removed. */
+            nialptr     op = tailop;
+
+            tailop = invalidptr;
+#ifdef USER_BREAK_FLAG
+            checksignal(NC_CS_NORMAL);
+#endif
+            if (op == fn) {
+              nialint     i,
+                          sp = get_spval(fetch_array(current_env, 0));
+
+              for (i = 0; i < nvars; i++) {
+                nialptr     oldv = stkarea[sp + i];
+
+                stkarea[sp + i] = no_value;
+                incrrefcnt(no_value);
+                decrrefcnt(oldv);
+                freeup(oldv);
+              }
+              val = apop();
+              goto newcall;
+            }
+            epilogue(save_env, nvars);
+            incrrefcnt(op);  /* protect the form as apply does for a name */
+            if (tailform != invalidptr) {
+              decrrefcnt(tailform);
+              freeup(tailform);
+            }
+            tailform = op;
+            fn = op;
+            goto newform;
+          }
+#endif
           if (trace)
             nprintf(OF_NORMAL_LOG, "...end of operation call \n");
           epilogue(save_env, nvars);  /* restore the environment */
+#ifdef TAILCALLS
+          if (tailform != invalidptr) {
+            decrrefcnt(tailform);
+            freeup(tailform);
+          }
+#endif
         }
         break;
 
@@ -638,7 +699,7 @@ apply_transform(nialptr tr)
           nialptr     entr,
                       sym;
 
-          trf = fetch_var(get_sym(tr), get_entry(tr));
+          trf = fetch_varnode(tr);
           val = apop(); /* pick up argument */
           /* protect tr in case it gets redefined, e.g. FOOL is tr f op a {
            * execute 'FOOL is tr f op b{f (b + 1)}'; } */
@@ -845,10 +906,6 @@ fetch_var(nialptr sym, nialptr entr)
 int
 store_var(nialptr sym, nialptr entr, nialptr v)
 {
-  nialptr     oldv;
-  nialint     cursp,
-              offset;
-
   if (sym == global_symtab) {
     st_s_valu(entr, v);
     if (debugging_on && watchlist != Null) {
@@ -857,8 +914,16 @@ store_var(nialptr sym, nialptr entr, nialptr v)
 
     return (true);
   }
+  return (store_local(sym, entr, intval(sym_valu(entr)), v));
+}
+
+static int
+store_local(nialptr sym, nialptr entr, nialint offset, nialptr v)
+{
+  nialptr     oldv;
+  nialint     cursp;
+
   cursp = get_spval(sym);
-  offset = intval(sym_valu(entr));
   if (cursp != -1) {         /* there is a current activation */
     oldv = stkarea[cursp + offset];
     stkarea[cursp + offset] = v;
@@ -873,6 +938,102 @@ store_var(nialptr sym, nialptr entr, nialptr v)
   return (false);
 }
 
+/* the versions of fetch_var and store_var used with a t_variable node.
+   The node holds the offset of a local, bound by the parser, so the
+   value cell is found from the stack pointer of the symbol table
+   without going through the entry. */
+
+nialptr
+fetch_varnode(nialptr var)
+{
+  nialptr     sym = (nialptr) fetch_int(var, 1);
+  nialint     cursp;
+
+  if (sym == global_symtab)
+    return (sym_valu((nialptr) fetch_int(var, 2)));
+  cursp = get_spval(sym);
+  if (cursp == -1)
+    return (makefault("?variable out of context"));
+  return (stkarea[cursp + get_slot(var)]);
+}
+
+int
+store_varnode(nialptr var, nialptr v)
+{
+  nialptr     sym = (nialptr) fetch_int(var, 1),
+              entr = (nialptr) fetch_int(var, 2);
+
+  if (sym == global_symtab)
+    return (store_var(sym, entr, v));
+  return (store_local(sym, entr, get_slot(var), v));
+}
+
+
+#ifdef FORRANGES
+
+/* routine to recognize the WITH expression of a FOR loop that is a
+   call of tell or count. The argument expression is returned and
+   the first value of the range is put in *start. Otherwise the result
+   is invalidptr. The loop then steps through the integers without
+   making the list if the argument is an integer. */
+
+nialptr
+forrange(nialptr exp, nialint * start)
+{
+  nialptr     op;
+
+  while (exp != Nullexpr && kind(exp) != faulttype &&
+         ((tag(exp) == t_exprseq && tally(exp) == 2) || tag(exp) == t_parendobj))
+    exp = (tag(exp) == t_exprseq ? fetch_array(exp, 1) : get_obj(exp));
+  if (exp == Nullexpr || kind(exp) == faulttype || tag(exp) != t_opcall)
+    return (invalidptr);
+  op = get_op(exp);
+  if (tag(op) != t_basic)
+    return (invalidptr);
+  if (applytab[get_index(op)] == itell)
+    *start = 0;
+  else if (applytab[get_index(op)] == icount)
+    *start = 1;
+  else
+    return (invalidptr);
+  return (get_argexpr(exp));
+}
+
+#endif
+
+
+#ifdef TAILCALLS
+
+/* routine used for a call in tail position of an operation form body.
+   If op names a global operation form and nothing needs to see the
+   call, the form is noted in tailop, the argument is left on the stack
+   and the result is true. The apply of the enclosing form makes the
+   call after leaving its activation record, so the C stack and the
+   Nial stack do not grow. A call made while stepping, or of an
+   operation with a break or trace set, keeps its frame. */
+
+int
+tailcall(nialptr op)
+{
+  nialptr     opv;
+
+  if (trace || d_onestep || d_stepin || d_toend || d_next)
+    return (false);
+#ifdef PROFILE
+  if (profile)
+    return (false);
+#endif
+  if (tag(op) != t_variable || get_sym(op) != global_symtab ||
+      sym_trflg(get_entry(op)) || sym_brflg(get_entry(op)))
+    return (false);
+  opv = fetch_varnode(op);
+  if (tag(opv) != t_opform)
+    return (false);
+  tailop = opv;
+  return (true);
+}
+
+#endif
 
 /* routine to implement the binding of the vars to the values. If the varlist
    is of length one then the var is bound to val; otherwise the
@@ -899,7 +1060,7 @@ assign(nialptr varlist, nialptr val, int trsw, int valneeded)
   nvars = tally(varlist) - 1;
   if (nvars == 1) {
     var = fetch_array(varlist, 1);
-    res = store_var(get_sym(var), get_entry(var), val);
+    res = store_varnode(var, val);
   }
   else {
     if (trsw) {
@@ -914,7 +1075,7 @@ assign(nialptr varlist, nialptr val, int trsw, int valneeded)
       for (i = 0; i < nvars; i++) {
         x = fetchasarray(oparg, i + 1); /* + 1 allows for the tag */
         var = fetch_array(varlist, i + 1);  /* + 1 allows for the tag */
-        store_var(get_sym(var), get_entry(var), x);
+        store_varnode(var, x);
       }
       res = true;
     }
@@ -927,7 +1088,7 @@ assign(nialptr varlist, nialptr val, int trsw, int valneeded)
       for (i = 0; i < nvars; i++) {
         x = fetchasarray(val, i);
         var = fetch_array(varlist, i + 1);  /* + 1 allows for the tag */
-        store_var(get_sym(var), get_entry(var), x);
+        store_varnode(var, x);
       }
       res = true;
     }
@@ -965,7 +1126,7 @@ prologue(nialptr env, nialint nvars, nialptr * senv)
                               * environment */
   current_env = env;
   apush(no_value);           /* reserve space for the result */
-  newsym = fetch_int(env, 0);/* get the new symbol table number */
+  newsym = fetch_array(env, 0);/* get the new symbol table */
   apush(get_sp(newsym));     /* push the old stack pointer value */
   store_sp(newsym, createint(topstack + 1));  /* store new stack pointer */
   for (i = 0; i < nvars; i++)
@@ -1116,7 +1277,7 @@ isetdeftrace(void)
     nialptr     op = sym_valu(entr);  /* check if the argument is an atlas */
 
     while (tag(op) == t_variable)
-      op = fetch_var(get_sym(op), get_entry(op));
+      op = fetch_varnode(op);
     if (tag(op) == t_atlas) {
       buildfault("cannot trace a named atlas");
       /* we cannot trace a renamed atlas because op coercion does not go
@@ -1195,14 +1356,12 @@ b_closure()
     case t_variable:
         {
           nialptr     sym,
-                      entr,
                       op;
 
           sym = get_sym(top);
           if (sym == global_symtab)
             return false;    /* no need to close a global named-op */
-          entr = get_entry(top);
-          op = fetch_var(sym, entr);
+          op = fetch_varnode(top);
           if (tag(op) == t_basic ||
               (tag(op) == t_variable && get_sym(op) == global_symtab)) {
             freeup(apop());
@@ -1263,7 +1422,7 @@ b_closure()
   /* stack pointers */
   t = tally(sps);
   for (i = 0; i < t; i++) {
-    sym = fetch_int(current_env, i);
+    sym = fetch_array(current_env, i);
     sp = get_sp(sym);
     store_array(sps, i, sp);
   }
@@ -1290,7 +1449,7 @@ setup_env(nialptr syms, nialptr sps, nialptr * svenv)
     *svenv = current_env;
     current_env = syms;
     for (i = 0; i < t; i++) {
-      sym = fetch_int(syms, i);
+      sym = fetch_array(syms, i);
       apush(get_sp(sym));    /* push the saved stack pointer */
       swap();                /* to put the arg on top */
       sp = fetch_array(sps, i); /* get the sp from the closure */
@@ -1311,7 +1470,7 @@ restore_env(nialptr syms, nialptr svenv)
   if (syms != Null) {
     t = tally(syms);
     for (i = t - 1; i >= 0; i--) {
-      sym = fetch_int(syms, i);
+      sym = fetch_array(syms, i);
       swap();                /* to move result down 1 in the stack */
       store_sp(sym, apop());
     }
@@ -1338,7 +1497,7 @@ coerceop()
     if (sym_trflg(get_entry(op))) /* do not coerce past an operation to be traced. 
                                       Not sure this changes the semantics */
       break;
-    op = fetch_var(get_sym(op), get_entry(op));
+    op = fetch_varnode(op);
   }
   apush(op);
 }
@@ -2385,7 +2544,7 @@ iwatch()
       dfn_sym = get_trsym(sym_valu(dfn_id));  /* the symtab for the defn */
 
       varphrase = get_name(get_idvar(body));  /* the name for id being sought */
-      var_entr = Blookup(get_root(dfn_sym), varphrase); /* entry for id */
+      var_entr = symfind(dfn_sym, varphrase); /* entry for id */
 
       if (var_entr == notfound) { /* id is not in the scope */
         apush(makefault("?scoped variable not found in watch"));
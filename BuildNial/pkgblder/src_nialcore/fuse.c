@@ -0,0 +1,481 @@
+/*==============================================================
+
+  MODULE   FUSE.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+
+  Fused evaluation of elementwise arithmetic expressions.
+
+================================================================*/
+
+/* An expression such as a * b - c + d on arrays is evaluated by the
+   tree walker one operation at a time: each of plus, minus and times
+   creates a full temporary array and makes a pass over the items of
+   its arguments. This module evaluates such an expression in one pass
+   over the items with a single result array.
+
+   An expression can be fused if it is made of calls of the basic
+   operations plus, minus, times and divide, and of opposite and abs,
+   with at least two operations, and its leaves are variables and
+   constants, so that getting their values has no effect. It is
+   flattened into postfix code. When it is evaluated the leaves must
+   be integer or real atoms or arrays, the arrays all of the same
+   shape, and at least one leaf an array. The items are then computed
+   a block at a time, each operation working on a block of the items
+   of its arguments in buffers, the last one storing into the result.
+   An operation on two integer arguments is done on integers, and one
+   with a real argument, or a divide, converts an integer argument to
+   real there, as the operations done one at a time do. Integer overflow,
+   a zero divisor or an argument of any other kind makes fused_eval
+   return false, and the expression is then evaluated the usual way
+   with the same result. The leaves are only fetched, so trying
+   costs little.
+*/
+
+#include "switches.h"
+
+#ifdef FUSION
+
+/* standard library header files */
+
+/* IOLIB */
+#include <stdio.h>
+
+/* STLIB */
+#include <stdlib.h>
+
+/* SJLIB */
+#include <setjmp.h>
+
+/* Q'Nial header files */
+
+#include "fuse.h"
+#include "qniallim.h"
+#include "absmach.h"
+#include "basics.h"
+#include "lib_main.h"
+#include "if.h"
+
+#include "eval.h"            /* for fetch_varnode */
+#include "arith.h"           /* for b_plus, safeintadd etc. */
+#include "blders.h"          /* for get routines */
+#include "getters.h"         /* for get macros */
+#include "parse.h"           /* for parse tree node tags */
+#include "utils.h"           /* for equalshape */
+
+
+/* the postfix instructions */
+
+enum {
+  fu_leaf, fu_plus, fu_minus, fu_times, fu_divide, fu_opposite, fu_abs
+};
+
+static int  fcode[FUSEMAXCODE];   /* instruction codes */
+static int  fleaf[FUSEMAXCODE];   /* leaf number of a fu_leaf */
+static nialptr leaves[FUSEMAXCODE]; /* the leaf values */
+static int  ncode,
+            nleaves,
+            nops,
+            depth,
+            maxdepth;
+
+/* an operand is a block of items, or a scalar when the pointer is NULL */
+
+static double rbuf[FUSEMAXDEPTH][FUSEBLOCK];
+static nialint ibuf[FUSEMAXDEPTH][FUSEBLOCK];
+
+typedef struct {
+  double     *r;
+  nialint    *i;
+  double      rs;
+  nialint     is;
+  int         isreal;
+} fuseopd;
+
+
+/* routine to give the fused instruction for an operation, or fu_leaf if
+   it has none */
+
+static int
+fuseop(nialptr exp)
+{
+  nialptr     op = get_op(exp);
+
+  if (tag(exp) == t_basic_binopcall) {
+    void        (*f) (void) = binapplytab[get_binindex(op)];
+
+    if (f == b_plus)
+      return fu_plus;
+    if (f == b_minus)
+      return fu_minus;
+    if (f == b_times)
+      return fu_times;
+    if (f == b_divide)
+      return fu_divide;
+  }
+  else if (tag(exp) == t_opcall && tag(op) == t_basic) {
+    void        (*f) (void) = applytab[get_index(op)];
+
+    if (f == iopposite)
+      return fu_opposite;
+    if (f == iabs)
+      return fu_abs;
+  }
+  return fu_leaf;
+}
+
+/* routine to flatten a tree into the postfix code. It fails if the tree
+   is not made of fused operations on variables and constants or is too
+   big. */
+
+static int
+flatten(nialptr exp)
+{
+  int         op;
+
+  if (ncode >= FUSEMAXCODE)
+    return false;
+  switch (tag(exp)) {
+    case t_variable:
+    case t_constant:
+        fcode[ncode] = fu_leaf;
+        fleaf[ncode++] = nleaves;
+        leaves[nleaves++] = exp;
+        if (++depth > maxdepth)
+          maxdepth = depth;
+        return (depth <= FUSEMAXDEPTH);
+    case t_basic_binopcall:
+    case t_opcall:
+        op = fuseop(exp);
+        if (op == fu_leaf)
+          return false;
+        if (op == fu_opposite || op == fu_abs) {
+          if (!flatten(get_argexpr(exp)))
+            return false;
+        }
+        else {
+          if (!flatten(get_argexpr(exp)) || !flatten(get_argexpr1(exp)))
+            return false;
+          depth--;
+        }
+        if (ncode >= FUSEMAXCODE)
+          return false;
+        fcode[ncode++] = op;
+        nops++;
+        return true;
+    default:
+        return false;
+  }
+}
+
+static int
+buildcode(nialptr exp)
+{
+  ncode = nleaves = nops = depth = maxdepth = 0;
+  return (fuseop(exp) != fu_leaf && flatten(exp) && nops >= 2);
+}
+
+/* routine used by the bytecode compiler to decide whether to try fusion
+   on an expression */
+
+int
+fusable(nialptr exp)
+{
+  return (buildcode(exp));
+}
+
+
+/* the loops for the real operations on a block of n items */
+
+#define REALLOOP(expr) \
+  if (a.r != NULL && b.r != NULL) \
+    for (j = 0; j < n; j++) { \
+      double      x = a.r[j], \
+                  y = b.r[j]; \
+      out[j] = (expr); \
+    } \
+  else if (a.r != NULL) { \
+    double      y = b.rs; \
+    for (j = 0; j < n; j++) { \
+      double      x = a.r[j]; \
+      out[j] = (expr); \
+    } \
+  } \
+  else { \
+    double      x = a.rs; \
+    for (j = 0; j < n; j++) { \
+      double      y = b.r[j]; \
+      out[j] = (expr); \
+    } \
+  }
+
+/* the integer operations are checked for overflow as in arith.c */
+
+#define INTLOOP(test) \
+  for (j = 0; j < n; j++) { \
+    nialint     x = (a.i ? a.i[j] : a.is), \
+                y = (b.i ? b.i[j] : b.is); \
+    if (test(x, y, &out[j])) \
+      return false; \
+  }
+
+/* routine to convert the integer operand d in stack slot s to real. It
+   is used only where an integer meets a real or a divide, as arith.c
+   converts it there. */
+
+static void
+toreal(fuseopd * d, int s, nialint n)
+{
+  nialint     j;
+
+  if (d->i == NULL) {
+    d->r = NULL;
+    d->rs = (double) d->is;
+  }
+  else {
+    d->r = rbuf[s];
+    for (j = 0; j < n; j++)
+      d->r[j] = (double) d->i[j];
+    d->i = NULL;
+  }
+  d->isreal = true;
+}
+
+/* routine to compute items start to start+n-1 of the result into res.
+   Each operation is done on integers when its arguments are integers
+   and on reals otherwise, so the values are those of the operations
+   done one at a time. */
+
+static int
+fuseblock(nialint start, nialint n, void *res)
+{
+  fuseopd     stk[FUSEMAXDEPTH];
+  int         sp = 0,
+              pc;
+  nialint     j;
+
+  for (pc = 0; pc < ncode; pc++) {
+    int         c = fcode[pc];
+
+    if (c == fu_leaf) {
+      nialptr     v = leaves[fleaf[pc]];
+      fuseopd    *d = &stk[sp++];
+
+      d->isreal = (kind(v) == realtype);
+      d->r = NULL;
+      d->i = NULL;
+      if (atomic(v)) {
+        if (d->isreal)
+          d->rs = realval(v);
+        else
+          d->is = intval(v);
+      }
+      else if (d->isreal)
+        d->r = pfirstreal(v) + start;
+      else
+        d->i = pfirstint(v) + start;
+    }
+    else if ((c == fu_opposite || c == fu_abs) && stk[sp - 1].isreal) {
+      fuseopd     a = stk[sp - 1];
+      double     *out;
+
+      if (a.r == NULL) {
+        stk[sp - 1].rs = (c == fu_opposite ? 0. - a.rs :
+                          a.rs < 0 ? -a.rs : a.rs);
+        continue;
+      }
+      out = (pc == ncode - 1 ? (double *) res : rbuf[sp - 1]);
+      if (c == fu_opposite)
+        for (j = 0; j < n; j++)
+          out[j] = 0. - a.r[j];
+      else
+        for (j = 0; j < n; j++)
+          out[j] = (a.r[j] < 0 ? -a.r[j] : a.r[j]);
+      stk[sp - 1].r = out;
+    }
+    else if (c == fu_opposite || c == fu_abs) {
+      fuseopd     a = stk[sp - 1];
+      nialint    *out;
+
+      if (a.i == NULL) {
+        nialint     x = a.is;
+
+        if (c == fu_abs && x >= 0)
+          continue;
+        if (safeintsub(0, x, &stk[sp - 1].is))
+          return false;
+        continue;
+      }
+      out = (pc == ncode - 1 ? (nialint *) res : ibuf[sp - 1]);
+      for (j = 0; j < n; j++) {
+        nialint     x = a.i[j];
+
+        if (c == fu_abs && x >= 0)
+          out[j] = x;
+        else if (safeintsub(0, x, &out[j]))
+          return false;
+      }
+      stk[sp - 1].i = out;
+    }
+    else if (c == fu_divide || stk[sp - 1].isreal || stk[sp - 2].isreal) {
+      fuseopd     b = stk[--sp],
+                  a = stk[sp - 1];
+      double     *out;
+
+      if (!a.isreal)
+        toreal(&a, sp - 1, n);
+      if (!b.isreal)
+        toreal(&b, sp, n);
+      stk[sp - 1] = a;
+      if (c == fu_divide) {  /* a zero divisor gives a fault item */
+        if (b.r == NULL && b.rs == 0.)
+          return false;
+        if (b.r != NULL)
+          for (j = 0; j < n; j++)
+            if (b.r[j] == 0.)
+              return false;
+      }
+      if (a.r == NULL && b.r == NULL) {
+        double      x = a.rs,
+                    y = b.rs;
+
+        stk[sp - 1].rs = (c == fu_plus ? x + y : c == fu_minus ? x - y :
+                          c == fu_times ? x * y : x / y);
+        continue;
+      }
+      out = (pc == ncode - 1 ? (double *) res : rbuf[sp - 1]);
+      switch (c) {
+        case fu_plus:
+            REALLOOP(x + y);
+            break;
+        case fu_minus:
+            REALLOOP(x - y);
+            break;
+        case fu_times:
+            REALLOOP(x * y);
+            break;
+        case fu_divide:
+            REALLOOP(x / y);
+            break;
+      }
+      stk[sp - 1].r = out;
+    }
+    else {
+      fuseopd     b = stk[--sp],
+                  a = stk[sp - 1];
+      nialint    *out;
+
+      if (a.i == NULL && b.i == NULL) {
+        nialint    *p = &stk[sp - 1].is;
+
+        if (c == fu_plus ? safeintadd(a.is, b.is, p) :
+            c == fu_minus ? safeintsub(a.is, b.is, p) :
+            safeintmult(a.is, b.is, p))
+          return false;
+        continue;
+      }
+      out = (pc == ncode - 1 ? (nialint *) res : ibuf[sp - 1]);
+      switch (c) {
+        case fu_plus:
+            INTLOOP(safeintadd);
+            break;
+        case fu_minus:
+            INTLOOP(safeintsub);
+            break;
+        case fu_times:
+            INTLOOP(safeintmult);
+            break;
+      }
+      stk[sp - 1].i = out;
+    }
+  }
+  return true;
+}
+
+/* routine to find whether the result is real, following the kinds of
+   the leaves through the code as fuseblock does */
+
+static int
+realresult(void)
+{
+  int         st[FUSEMAXDEPTH],
+              sp = 0,
+              pc;
+
+  for (pc = 0; pc < ncode; pc++) {
+    int         c = fcode[pc];
+
+    if (c == fu_leaf)
+      st[sp++] = (kind(leaves[fleaf[pc]]) == realtype);
+    else if (c != fu_opposite && c != fu_abs) {
+      sp--;
+      st[sp - 1] = (c == fu_divide || st[sp - 1] || st[sp]);
+    }
+  }
+  return st[0];
+}
+
+/* routine to evaluate exp fused if it can be. On success the value is
+   pushed and the result is true. */
+
+int
+fused_eval(nialptr exp)
+{
+  nialptr     shp = invalidptr,
+              z;
+  nialint     i,
+              t = 0,
+              start;
+  int         realcase = false,
+              ok = true;
+
+  if (debugging_on || !buildcode(exp))
+    return false;
+
+  /* get the leaf values and check that they conform */
+  for (i = 0; i < nleaves; i++) {
+    nialptr     lf = leaves[i],
+                v = (tag(lf) == t_variable ? fetch_varnode(lf) : get_c_val(lf));
+    int         k = kind(v);
+
+    if (k != inttype && k != realtype)
+      return false;
+    if (!atomic(v)) {
+      if (shp == invalidptr) {
+        shp = v;
+        t = tally(v);
+      }
+      else if (!equalshape(shp, v))
+        return false;
+    }
+    leaves[i] = v;
+  }
+  if (shp == invalidptr || t == 0)
+    return false;
+  realcase = realresult();
+
+  /* the leaves are held by variables and constants, so the allocation
+     cannot free them */
+  z = new_create_array(realcase ? realtype : inttype, valence(shp), 0,
+                       shpptr(shp, valence(shp)));
+  for (start = 0; ok && start < t; start += FUSEBLOCK) {
+    nialint     n = (t - start < FUSEBLOCK ? t - start : FUSEBLOCK);
+
+    if (realcase)
+      ok = fuseblock(start, n, pfirstreal(z) + start);
+    else
+      ok = fuseblock(start, n, pfirstint(z) + start);
+  }
+  if (!ok) {
+    freeup(z);
+    return false;
+  }
+  apush(z);
+#ifdef FP_EXCEPTION_FLAG
+  fp_checksignal();
+#endif
+  return true;
+}
+
+#endif /* FUSION */
@@ -48,6 +48,14 @@
 
 #define get_offset(x) intval(sym_valu(get_entry(x)))
 
+/* the offset of a local kept in a t_variable node by b_variable */
+
+#define get_slot(x) fetch_int(x,3)
+
+/* a t_opcall node in tail position of an operation form has a fourth item */
+
+#define is_tailcall(x) (tally(x) == 4)
+
 #define get_role(x) sym_role(get_entry(x))
 
 #define get_var_pv(x) sym_name(get_entry(x))
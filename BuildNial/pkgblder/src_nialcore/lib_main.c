@@ -206,14 +206,22 @@ sysinit()
 /* put in initial ints. Used to avoid constructing frequent small values */
   for (i = 0; i < NOINTS; i++) {
     n = new_create_array(inttype, 0, 1, &dummy);
-    store_int(n, 0, i);
+    store_int(n, 0, LOWINT + i);
     intvals[i] = n;
     incrrefcnt(n);
   }
 
-  Zero = intvals[0];
-  One = intvals[1];
-  Two = intvals[2];
+  Zero = intvals[-LOWINT];
+  One = intvals[1 - LOWINT];
+  Two = intvals[2 - LOWINT];
+
+/* put in all the chars so that createchar never allocates */
+  for (i = LOWCHAR; i <= HIGHCHAR; i++) {
+    n = new_create_array(chartype, 0, 1, &dummy);
+    store_char(n, 0, (char) i);
+    charvals[i - LOWCHAR] = n;
+    incrrefcnt(n);
+  }
 
   Blank = createchar(BLANK);
   incrrefcnt(Blank);
@@ -288,6 +296,8 @@ sysinit()
   incrrefcnt(breaklist);
   watchlist = Null;
   incrrefcnt(watchlist);
+  memotable = Null;
+  incrrefcnt(memotable);
 
 
 
@@ -389,6 +399,10 @@ init_fncodes()
   do_init("_CONVERSE", &conversecode);
   do_init("_UP", &upcode);
   do_init("_EQUAL", &equalcode);
+  do_init("APPEND", &appendcode);
+  do_init("HITCH", &hitchcode);
+  do_init("PLACE", &placecode);
+  do_init("PLACEALL", &placeallcode);
   do_init("_EACHRIGHT", &eachrightcode);
 #else
   do_init("NO_EXPR", &no_excode);
@@ -412,6 +426,10 @@ init_fncodes()
   do_init("CONVERSE", &conversecode);
   do_init("UP", &upcode);
   do_init("=", &equalcode);
+  do_init("APPEND", &appendcode);
+  do_init("HITCH", &hitchcode);
+  do_init("PLACE", &placecode);
+  do_init("PLACEALL", &placeallcode);
   do_init("EACHRIGHT", &eachrightcode);
 #endif
 }
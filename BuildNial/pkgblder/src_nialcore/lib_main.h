@@ -44,6 +44,10 @@ struct global_vars1 {
   jmp_buf     g_init_buf;    /* buffer for long jumps during startup */
   char        g_gcharbuf[GENBUFFERSIZE];  /* generic buffer to save space */
   int         g_keeplog;     /* on if log is being kept */
+  int         g_deferfree;   /* on if large releases are done in batches */
+  int         g_bytecode;    /* on if bodies and loops are run as bytecode */
+  int         g_parthreads;  /* threads used for loops over large arrays */
+  nialint     g_parminitems; /* least tally of an array done on threads */
   int         g_doinglatent;/* signals that we are doing a latent execution */
   nialint     g_ssizew;      /* effective screen width */
   nialptr     g__x_;   /* used as temporary in alternate apush and apop macros */
@@ -71,6 +75,14 @@ struct global_vars1 {
   int         g_triggered;   /* flag used to indicate whether faults should
                               * trigger. Default is yes! */
   int         g_nialexitflag;/* used to control exit from exprseqs */
+  nialptr     g_updateexp;   /* right side of the single variable assignment
+                                about to be evaluated */
+  nialptr     g_updatevar;   /* the variable that assignment stores into */
+  nialptr     g_updatevalue; /* value of that variable while the primitive
+                                on the right side is applied. The primitive
+                                may change it in place if it is unshared */
+  nialptr     g_tailop;      /* operation form of a call in tail position
+                                to be applied by the caller's apply */
   int         g_trace;       /* on if tracing is being done */
   int         g_debugging_on;/* debugging active switch */
   jmp_buf     g_error_env;   /* for error conditions and callbacks */
@@ -102,6 +114,7 @@ struct global_vars {
   nialint     g_wssize;      /* wssize when ws is saved */
   nialptr     g_firstfree;   /* link to first free in saved workspace */
   nialptr     g_intvals[NOINTS];  /* holds low Nial integers */
+  nialptr     g_charvals[HIGHCHAR - LOWCHAR + 1]; /* holds all Nial chars */
   nialptr     g_bnames[NOBNAMES]; /* the names for built-in objects */
   nialptr     g_filenames;   /* the names for open files */
 
@@ -109,6 +122,9 @@ struct global_vars {
   nialptr     g_watchlist,
               g_breaklist;
 
+  /* the cache of results kept by MEMO, or Null */
+  nialptr     g_memotable;
+
 
   /* Nial constants */
   nialptr     g_Zero,
@@ -163,6 +179,10 @@ struct global_vars {
               g_gtecode,
               g_upcode,
               g_equalcode,
+              g_appendcode,
+              g_hitchcode,
+              g_placecode,
+              g_placeallcode,
               g_eachrightcode;
 };
 
@@ -187,6 +207,10 @@ extern void signon(void);
 #define init_buf G1.g_init_buf
 #define gcharbuf G1.g_gcharbuf
 #define keeplog G1.g_keeplog
+#define deferfree G1.g_deferfree
+#define bytecode G1.g_bytecode
+#define parthreads G1.g_parthreads
+#define parminitems G1.g_parminitems
 #define ssizew G1.g_ssizew
 #define _x_ G1.g__x_
 #define logfnm G1.g_logfnm
@@ -211,6 +235,10 @@ extern void signon(void);
 /* from eval */
 #define triggered G1.g_triggered
 #define nialexitflag G1.g_nialexitflag
+#define updateexp G1.g_updateexp
+#define updatevar G1.g_updatevar
+#define updatevalue G1.g_updatevalue
+#define tailop G1.g_tailop
 #define trace G1.g_trace
 #define debugging_on G1.g_debugging_on
 /* from main_stu */
@@ -225,6 +253,7 @@ extern void signon(void);
 
 #define watchlist G.g_watchlist
 #define breaklist G.g_breaklist
+#define memotable G.g_memotable
 
 #define savedmemsize G.g_savedmemsize
 #define atomtblbase G.g_atomtblbase
@@ -233,6 +262,7 @@ extern void signon(void);
 #define wssize G.g_wssize
 #define firstfree G.g_firstfree
 #define intvals G.g_intvals
+#define charvals G.g_charvals
 #define bnames G.g_bnames
 #define filenames G.g_filenames
 #define  Null G.g_Null
@@ -288,6 +318,10 @@ extern void signon(void);
 #define timescode G.g_timescode
 #define upcode G.g_upcode
 #define equalcode G.g_equalcode
+#define appendcode G.g_appendcode
+#define hitchcode G.g_hitchcode
+#define placecode G.g_placecode
+#define placeallcode G.g_placeallcode
 #define eachrightcode G.g_eachrightcode
 
 
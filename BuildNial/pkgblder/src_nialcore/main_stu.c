@@ -57,6 +57,7 @@ int linenoiseMultiLineMode = 0;
 #include "parse.h"           /* for parse */
 #include "profile.h"         /* for clear_profiler */
 #include "systemops.h"       /* for ihost */
+#include "parallel.h"        /* for par_init */
 #include "blders.h"
 #include "token.h"
 
@@ -133,6 +134,9 @@ main(int argc, char *memin[], char **envp)
   expansion = true;
   sketch = true;
   decor = false;
+  bytecode = true;
+  par_init();
+  tailop = invalidptr;
   strcpy(logfnm,"auto.nlg");
   strcpy(stdformat,"%g");
   strcpy(nprompt,"     ");
@@ -481,6 +485,18 @@ retry: /* start over point for the main loop */
       
       topstack = (-1);   /* resets the stack */
 
+#ifdef HEAPCOMPACTION
+      /* the heap can be compacted here since the only array held in a C
+         variable is lastval, which is kept on the stack meanwhile */
+      if (lastval != -1) {
+        apush(lastval);
+        heap_safepoint();
+        lastval = apop();
+      }
+      else
+        heap_safepoint();
+#endif
+
     /* prompt to get inputline
        We use rl_gets so that the input history is available in the top level loop */
       
@@ -788,6 +804,9 @@ cleanup_ws()
     
     cleardeffiles();           /* clean up open ndf files */
     clearstack();              /* clear the stack and list of temp arrays */
+    updateexp = invalidptr;    /* forget any interrupted in place update */
+    updatevalue = invalidptr;
+    tailop = invalidptr;       /* forget any pending tail call */
     clearheap();               /* remove all arrays with refcnt 0 */
     closeuserfiles();          /* close files to avoid interference */
     clear_call_stack();        /* clears names of called routines */
@@ -7,6 +7,14 @@
 
 #ifdef INTS32
 
+#ifdef COMPACTHEADER
+#error COMPACTHEADER requires an INTS64 build
+#endif
+
+#ifdef PTRS32
+#error PTRS32 requires an INTS64 build
+#endif
+
 #define NIALONEBIT (1)
 #define ALLBITSON (-1)
 #define LARGEINT 2147483647
@@ -48,6 +56,7 @@
 /* How types are packed into words */
 #define boolsPW (32)
 #define charsPW (4)
+#define ptrsPW (1)
 
 #define NIALINT_FORMAT "%d"
 typedef int nialint_format_type; 
@@ -93,6 +102,23 @@ typedef long long nialint_format_type;
 /* Size of nial word in bytes */
 #define bytespu (8)
 
+#ifdef COMPACTHEADER
+
+/* Two word header: size, and refcnt packed with sort, kind and valence */
+#define hdrsize (2)
+
+/* Aligned trailer block size in words */
+#define trlsize (1)
+
+/* Min block size in words. A free block needs size, tag, two links and
+   the trailer. */
+#define minsize (5)
+
+/* Min data size in words */
+#define mindatasize (1)
+
+#else
+
 /* Aligned header block size in words */
 #define hdrsize (4)
 
@@ -105,6 +131,8 @@ typedef long long nialint_format_type;
 /* Min data size in words */
 #define mindatasize (3)
 
+#endif
+
 /* Bits per nial memory word - 1 for shifts */
 #define BoolPackBase (63)
 
@@ -125,6 +153,15 @@ typedef long long nialint_format_type;
 #define boolsPW (64)
 #define charsPW (8)
 
+#ifdef PTRS32
+/* Array items are 32 bit word offsets, two to a word. The heap is
+   limited to the words such an offset can address. */
+#define ptrsPW (2)
+#define MAXHEAPWORDS (2147483647LL - 1023)
+#else
+#define ptrsPW (1)
+#endif
+
 #else
 #error missing declaration of integer size
 #endif
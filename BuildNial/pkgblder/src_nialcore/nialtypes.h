@@ -45,7 +45,12 @@ typedef short     nialvalence;              /* storage for a valence value */
 typedef int64_t   nialword;              /* memory organised as array of nial words */
 typedef int64_t   nialint;               /* data holding a signed integer */
 typedef uint64_t  unialint;              /* data holding an unsigned nial int */
+#ifdef PTRS32
+typedef int32_t   nialptr;               /* index of an entry in the workspace,
+                                            held in 32 bits. See PTRS32 */
+#else
 typedef int64_t   nialptr;               /* index of an entry in the workspace */
+#endif
 typedef int       nialvalence;           /* storage for a valence value */
 
 #define nialabs(x) llabs(x)
@@ -56,7 +61,12 @@ typedef int       nialvalence;           /* storage for a valence value */
 typedef int64_t nialword;         /* memory organised as array of nial words */
 typedef int64_t nialint;          /* data holding a signed integer */
 typedef uint64_t unialint; /* data holding an unsigned nial int */
+#ifdef PTRS32
+typedef int32_t nialptr;           /* index of an entry in the workspace,
+                                      held in 32 bits. See PTRS32 */
+#else
 typedef uint64_t nialptr;          /* index of an entry in the workspace */
+#endif
 typedef int nialvalence;            /* storage for a valence value */
 
 #define nialabs(x) llabs(x)
@@ -103,6 +113,25 @@ typedef struct {
 
 
 
+#ifdef COMPACTHEADER
+
+/**
+ * View of the first two words of an allocated block in the compact
+ * header layout. The size and the free block fields are as in nialhdr.
+ * In a free block the whole second word is the free tag.
+ */
+typedef struct {
+  nialint size;                /* size of this block */
+  int32_t ref_count;           /* for heap memory management */
+  struct {
+    char        sk[2];         /* sort flag and kind */
+    short       val;           /* valence */
+  } skv;
+} nialcompacthdr;
+
+#endif
+
+
 /**
  * Simple structure at the end of workspace blocks 
  */ 
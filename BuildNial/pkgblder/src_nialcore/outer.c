@@ -0,0 +1,298 @@
+/*==============================================================
+
+  MODULE   OUTER.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+
+  OUTER of the binary pervasive primitives on homogeneous arrays.
+
+================================================================*/
+
+/* OUTER f A B with f a basic operation is done by iouter in trs.c,
+   which fetches each pair of items, applies f to it through the stack
+   and stores the atom it gives. When f is + (plus), -, * (times), max,
+   min, <, <=, >, >=, =, ~=, match or mate and A and B are both arrays
+   of integers or both arrays of reals, this module computes the table
+   in C loops instead, with no array made for an item.
+
+   Row i of the result is f applied to item i of A and each item of B,
+   which is the scalar-vector loop that f uses when one argument is an
+   atom, so the arithmetic is done by the loops of arith.c and
+   compare.c. The items are computed as f computes them on atoms. The
+   rows are divided among the threads used by par_for; a part that
+   begins or ends inside a row does a piece of the row. A table of
+   truth-values is divided on word boundaries so that no two threads
+   store into the same word.
+
+   An integer overflow makes outer_table give up, and iouter then
+   produces the faults as before.
+*/
+
+#include "switches.h"
+
+/* standard library header files */
+
+/* IOLIB */
+#include <stdio.h>
+
+/* STLIB */
+#include <stdlib.h>
+
+/* SJLIB */
+#include <setjmp.h>
+
+/* Q'Nial header files */
+
+#include "outer.h"
+#include "qniallim.h"
+#include "absmach.h"
+#include "basics.h"
+#include "lib_main.h"
+
+#include "arith.h"           /* for the arithmetic scalar-vector loops */
+#include "compare.h"         /* for maxintscalarvector etc. */
+#include "blders.h"          /* for tag */
+#include "getters.h"         /* for get_index */
+#include "parse.h"           /* for t_basic */
+#include "parallel.h"        /* for par_forunits */
+
+
+enum {
+  op_none, op_plus, op_minus, op_times, op_max, op_min,
+  op_lt, op_lte, op_gt, op_gte, op_eq, op_ne
+};
+
+/* the table being computed */
+
+typedef struct {
+  int         op,
+              kind;
+  nialint     unit,          /* items in a unit of par_forunits */
+              tb,            /* items in a row */
+              tz;
+  void       *a,
+             *b;
+  nialptr     z;
+} outerstate;
+
+/* the combination used by b_max and b_min on atoms */
+
+#define MAXOF(x, y) ((x) >= (y) ? (x) : (y))
+#define MINOF(x, y) ((x) <= (y) ? (x) : (y))
+
+/* routines to store the comparison of x with the n items of y as the
+   truth-values of z from item k on */
+
+#define COMPARELOOP(test) \
+  for (i = 0; i < n; i++) \
+    store_bool(z, k + i, test)
+
+static void
+compareints(int op, nialint x, nialint * y, nialptr z, nialint k, nialint n)
+{
+  nialint     i;
+
+  switch (op) {
+    case op_lt:
+        COMPARELOOP(x < y[i]);
+        break;
+    case op_lte:
+        COMPARELOOP(x <= y[i]);
+        break;
+    case op_gt:
+        COMPARELOOP(x > y[i]);
+        break;
+    case op_gte:
+        COMPARELOOP(x >= y[i]);
+        break;
+    case op_eq:
+        COMPARELOOP(x == y[i]);
+        break;
+    case op_ne:
+        COMPARELOOP(x != y[i]);
+        break;
+  }
+}
+
+static void
+comparereals(int op, double x, double *y, nialptr z, nialint k, nialint n)
+{
+  nialint     i;
+
+  switch (op) {
+    case op_lt:
+        COMPARELOOP(x < y[i]);
+        break;
+    case op_lte:
+        COMPARELOOP(x <= y[i]);
+        break;
+    case op_gt:
+        COMPARELOOP(x > y[i]);
+        break;
+    case op_gte:
+        COMPARELOOP(x >= y[i]);
+        break;
+    case op_eq:
+        COMPARELOOP(x == y[i]);
+        break;
+    case op_ne:
+        COMPARELOOP(x != y[i]);
+        break;
+  }
+}
+
+/* routine to compute the n items of the result from item k on, which
+   are items j to j+n-1 of row i. It returns false on overflow. */
+
+static int
+outerrow(outerstate * s, nialint i, nialint j, nialint k, nialint n)
+{
+  if (s->kind == inttype) {
+    nialint     x = ((nialint *) s->a)[i],
+               *y = (nialint *) s->b + j;
+
+    if (s->op >= op_lt)
+      compareints(s->op, x, y, s->z, k, n);
+    else {
+      nialint    *z = pfirstint(s->z) + k;  /* safe: no allocation */
+
+      switch (s->op) {
+        case op_plus:
+            return (addintscalarvector(x, y, z, n));
+        case op_minus:
+            return (subintscalarvector(x, y, z, n, false));
+        case op_times:
+            return (multintscalarvector(x, y, z, n));
+        case op_max:
+            maxintscalarvector(x, y, z, n);
+            break;
+        case op_min:
+            minintscalarvector(x, y, z, n);
+            break;
+      }
+    }
+  }
+  else {
+    double      x = ((double *) s->a)[i],
+               *y = (double *) s->b + j;
+
+    if (s->op >= op_lt)
+      comparereals(s->op, x, y, s->z, k, n);
+    else {
+      double     *z = pfirstreal(s->z) + k; /* safe: no allocation */
+      nialint     m;
+
+      switch (s->op) {
+        case op_plus:
+            addrealscalarvector(x, y, z, n);
+            break;
+        case op_minus:
+            subrealscalarvector(x, y, z, n, false);
+            break;
+        case op_times:
+            multrealscalarvector(x, y, z, n);
+            break;
+        case op_max:         /* the real loops of compare.c differ on NaN */
+            for (m = 0; m < n; m++)
+              z[m] = MAXOF(x, y[m]);
+            break;
+        case op_min:
+            for (m = 0; m < n; m++)
+              z[m] = MINOF(x, y[m]);
+            break;
+      }
+    }
+  }
+  return true;
+}
+
+/* the loop body for par_forunits. It does the units lo to hi-1 a row
+   or a piece of a row at a time. */
+
+static int
+outerpart(nialint lo, nialint hi, void *arg)
+{
+  outerstate *s = arg;
+  nialint     k = lo * s->unit,
+              last = (hi * s->unit < s->tz ? hi * s->unit : s->tz);
+
+  while (k < last) {
+    nialint     i = k / s->tb,
+                j = k % s->tb,
+                n = (s->tb - j < last - k ? s->tb - j : last - k);
+
+    if (!outerrow(s, i, j, k, n))
+      return false;
+    k += n;
+  }
+  return true;
+}
+
+/* routine to give the operation done for the primitive f */
+
+static int
+outerop(nialptr f)
+{
+  void        (*g) (void);
+
+  if (tag(f) != t_basic)
+    return op_none;
+  g = applytab[get_index(f)];
+  if (g == isum || g == iplus)
+    return op_plus;
+  if (g == iminus)
+    return op_minus;
+  if (g == iproduct || g == itimes)
+    return op_times;
+  if (g == imax)
+    return op_max;
+  if (g == imin)
+    return op_min;
+  if (g == ilt)
+    return op_lt;
+  if (g == ilte)
+    return op_lte;
+  if (g == igt)
+    return op_gt;
+  if (g == igte)
+    return op_gte;
+  if (g == iequal || g == imatch || g == imate)
+    return op_eq;
+  if (g == iunequal)
+    return op_ne;
+  return op_none;
+}
+
+/* routine to compute OUTER f A B for non-empty arrays a and b, giving a
+   result of valence vz and shape shz. The result is invalidptr if it is
+   not done here. */
+
+nialptr
+outer_table(nialptr f, nialptr a, nialptr b, int vz, nialint * shz)
+{
+  outerstate  s;
+  int         k = kind(a);
+
+  s.op = outerop(f);
+  if (s.op == op_none || kind(b) != k || (k != inttype && k != realtype))
+    return invalidptr;
+  s.kind = k;
+  s.tb = tally(b);
+  s.tz = tally(a) * s.tb;
+  s.z = new_create_array(s.op >= op_lt ? booltype : k, vz, 0, shz);
+  s.unit = (s.op >= op_lt ? boolsPW : 1);
+  if (k == inttype) {
+    s.a = pfirstint(a);
+    s.b = pfirstint(b);
+  }
+  else {
+    s.a = pfirstreal(a);
+    s.b = pfirstreal(b);
+  }
+  if (!par_forunits(s.tz, s.unit, outerpart, &s)) {
+    freeup(s.z);
+    return invalidptr;
+  }
+  return s.z;
+}
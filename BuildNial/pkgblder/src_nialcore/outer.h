@@ -0,0 +1,17 @@
+/*==============================================================
+
+  OUTER.H:  header for OUTER.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+  This contains the prototype for OUTER of the binary pervasive
+  primitives on homogeneous arrays
+
+================================================================*/
+
+#ifndef _OUTER_H_
+#define _OUTER_H_
+
+extern nialptr outer_table(nialptr f, nialptr a, nialptr b, int vz, nialint * shz);
+
+#endif
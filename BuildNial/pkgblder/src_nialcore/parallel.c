@@ -0,0 +1,295 @@
+/*==============================================================
+
+  MODULE   PARALLEL.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+
+  Loops over the items of large homogeneous arrays run on several
+  threads.
+
+================================================================*/
+
+/* The elementwise loops of the scientific primitives and of abs and
+   floor on real and integer arrays apply a C function to each item with
+   no use of the heap or the stack. When the array has at least
+   parminitems items, par_for divides the range of indices into one
+   contiguous part per thread and runs the loop body on each part. The
+   body is given the bounds of its part and the caller's argument, and
+   computes each item exactly as the serial loop does, so the result
+   does not depend on the number of threads. A body returns false if an
+   item cannot be computed, for example on integer overflow, and the
+   caller then redoes the work the usual way.
+
+   The threads are started when first needed and wait on a condition
+   variable between loops. The calling thread does a part itself and
+   returns when all parts are done. A body must not allocate, report a
+   fault or call the interpreter, since these are not thread safe.
+
+   The number of threads is taken from the environment variable
+   NIALTHREADS if it is set, and otherwise is the number of processors.
+   The primitive setthreads changes it and the size threshold.
+*/
+
+#include "switches.h"
+
+/* standard library header files */
+
+/* IOLIB */
+#include <stdio.h>
+
+/* STLIB */
+#include <stdlib.h>
+
+/* SJLIB */
+#include <setjmp.h>
+
+#ifdef PARALLEL
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+/* Q'Nial header files */
+
+#include "parallel.h"
+#include "qniallim.h"
+#include "absmach.h"
+#include "basics.h"
+#include "lib_main.h"
+
+#include "ops.h"             /* for pair */
+
+
+#ifdef PARALLEL
+
+static pthread_t workers[PARMAXTHREADS];
+static int  nworkers = 0;    /* threads started, not counting the caller */
+
+static pthread_mutex_t parlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t parstart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pardone = PTHREAD_COND_INITIALIZER;
+
+/* the loop being run. A new loop increments jobgen. */
+
+static parbody jobbody;
+static void *jobarg;
+static nialint jobn,
+            jobchunk;
+static int  jobparts,        /* number of parts */
+            jobnext,         /* next part to be claimed */
+            jobleft,         /* parts not yet finished */
+            jobok;
+static unsigned long jobgen = 0;
+
+/* routine to claim and run parts of the current loop until none is left.
+   It is called and returns with parlock held. */
+
+static void
+runparts(void)
+{
+  while (jobnext < jobparts) {
+    int         p = jobnext++;
+    nialint     lo = p * jobchunk,
+                hi = (lo + jobchunk < jobn ? lo + jobchunk : jobn);
+    int         ok;
+
+    pthread_mutex_unlock(&parlock);
+    ok = (*jobbody) (lo, hi, jobarg);
+    pthread_mutex_lock(&parlock);
+    if (!ok)
+      jobok = false;
+    if (--jobleft == 0)
+      pthread_cond_signal(&pardone);
+  }
+}
+
+static void *
+worker(void *unused)
+{
+  unsigned long seen = 0;
+  sigset_t    all;
+
+  /* interrupts are handled by the main thread */
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+  pthread_mutex_lock(&parlock);
+  while (true) {
+    while (jobgen == seen)
+      pthread_cond_wait(&parstart, &parlock);
+    seen = jobgen;
+    runparts();
+  }
+  return unused;
+}
+
+/* a child made by fork has only the thread that forked, so it starts
+   afresh with no workers and an unlocked mutex */
+
+static void
+par_forkchild(void)
+{
+  pthread_mutex_init(&parlock, NULL);
+  pthread_cond_init(&parstart, NULL);
+  pthread_cond_init(&pardone, NULL);
+  nworkers = 0;
+}
+
+/* routine to set the default number of threads and size threshold */
+
+void
+par_init(void)
+{
+  char       *s = getenv("NIALTHREADS");
+  long        n = (s != NULL ? atol(s) : sysconf(_SC_NPROCESSORS_ONLN));
+
+  parthreads = (n < 1 ? 1 : n > PARMAXTHREADS ? PARMAXTHREADS : (int) n);
+  parminitems = PARMINITEMS;
+  pthread_atfork(NULL, NULL, par_forkchild);
+}
+
+/* routine to give the number of parts par_for uses for a loop of n
+   items, starting any threads that are needed. Part p is the items from
+   p * PARCHUNK(n, parts) up to the next part or n. */
+
+int
+par_parts(nialint n)
+{
+  int         parts = parthreads;
+
+  if (n < parminitems || parts <= 1)
+    return 1;
+  while (nworkers < parts - 1) {
+    if (pthread_create(&workers[nworkers], NULL, worker, NULL) != 0)
+      break;
+    nworkers++;
+  }
+  if (parts > nworkers + 1)
+    parts = nworkers + 1;
+  /* so that no part is empty */
+  return ((int) PARCHUNK(n, PARCHUNK(n, parts)));
+}
+
+/* routine to apply body to the range 0 to n-1 in the given number of
+   parts. The result is false if the body failed on any part. */
+
+static int
+par_run(nialint n, int parts, parbody body, void *arg)
+{
+  int         ok;
+
+  if (parts <= 1)
+    return ((*body) (0, n, arg));
+
+  pthread_mutex_lock(&parlock);
+  jobbody = body;
+  jobarg = arg;
+  jobn = n;
+  jobchunk = PARCHUNK(n, parts);
+  jobparts = parts;
+  jobnext = 0;
+  jobleft = parts;
+  jobok = true;
+  jobgen++;
+  pthread_cond_broadcast(&parstart);
+  runparts();
+  while (jobleft > 0)
+    pthread_cond_wait(&pardone, &parlock);
+  ok = jobok;
+  pthread_mutex_unlock(&parlock);
+  return ok;
+}
+
+/* routine to apply body to the range 0 to n-1 in parts. */
+
+int
+par_for(nialint n, parbody body, void *arg)
+{
+  return (par_run(n, par_parts(n), body, arg));
+}
+
+/* routine to apply body to n items taken in units of the given size, so
+   that a part never divides a unit. The body is given a range of units,
+   the last of which may be short. The number of parts is chosen from n
+   as for par_for. */
+
+int
+par_forunits(nialint n, nialint unit, parbody body, void *arg)
+{
+  nialint     units = (n + unit - 1) / unit;
+  int         parts = par_parts(n);
+
+  if (parts > units)
+    parts = (int) units;
+  if (parts > 1)
+    parts = (int) PARCHUNK(units, PARCHUNK(units, parts));
+  return (par_run(units, parts, body, arg));
+}
+
+#else
+
+void
+par_init(void)
+{
+  parthreads = 1;
+  parminitems = PARMINITEMS;
+}
+
+int
+par_parts(nialint n)
+{
+  return 1;
+}
+
+int
+par_for(nialint n, parbody body, void *arg)
+{
+  return ((*body) (0, n, arg));
+}
+
+int
+par_forunits(nialint n, nialint unit, parbody body, void *arg)
+{
+  return ((*body) (0, (n + unit - 1) / unit, arg));
+}
+
+#endif /* PARALLEL */
+
+
+/* routine to implement the primitive setthreads. Its argument is the
+   number of threads, or a pair of the number of threads and the least
+   tally of an array whose items are computed in parallel. The result is
+   the pair of the old settings. */
+
+void
+isetthreads(void)
+{
+  nialptr     x = apop();
+  nialint     n,
+              m = parminitems;
+
+  if (kind(x) == inttype && tally(x) == 1)
+    n = fetch_int(x, 0);
+  else if (kind(x) == inttype && tally(x) == 2) {
+    n = fetch_int(x, 0);
+    m = fetch_int(x, 1);
+  }
+  else {
+    apush(makefault("?setthreads expects an integer or a pair of integers"));
+    freeup(x);
+    return;
+  }
+  if (n < 1 || n > PARMAXTHREADS || m < 1) {
+    apush(makefault("?setthreads argument out of range"));
+    freeup(x);
+    return;
+  }
+#ifndef PARALLEL
+  n = 1;
+#endif
+  pair(createint(parthreads), createint(parminitems));
+  parthreads = n;
+  parminitems = m;
+  freeup(x);
+}
@@ -0,0 +1,25 @@
+/*==============================================================
+
+  PARALLEL.H:  header for PARALLEL.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+  This contains the prototypes for running loops over the items
+  of large homogeneous arrays on several threads
+
+================================================================*/
+
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+typedef int (*parbody) (nialint lo, nialint hi, void *arg);
+
+/* the number of items in each part of a loop of n items done in parts */
+#define PARCHUNK(n, parts) (((n) + (parts) - 1) / (parts))
+
+extern void par_init(void);
+extern int  par_parts(nialint n);
+extern int  par_for(nialint n, parbody body, void *arg);
+extern int  par_forunits(nialint n, nialint unit, parbody body, void *arg);
+
+#endif
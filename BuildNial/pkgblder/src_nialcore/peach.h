@@ -0,0 +1,17 @@
+/*==============================================================
+
+  PEACH.H:  header for PEACH.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+  This contains the prototype of the transformer that applies an
+  operation to the items of an array in several processes
+
+================================================================*/
+
+#ifndef _PEACH_H_
+#define _PEACH_H_
+
+extern void ipeach(void);
+
+#endif
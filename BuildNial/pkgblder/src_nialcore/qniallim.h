@@ -20,10 +20,51 @@
 #define dfatomtblsize 10000
  /* atom table size */
 
+#define dfsymtblsize 1024
+ /* initial size of the hash table of the global symbol table, a power of 2 */
+
+#define FUSEBLOCK 256
+ /* items computed at a time by a fused arithmetic expression */
+
+#define FUSEMAXCODE 64
+ /* largest fused expression, counting operations and leaves */
+
+#define FUSEMAXDEPTH 8
+ /* deepest nesting of operands in a fused expression */
+
+#define FOLDMAXTALLY 1000
+ /* largest argument of TELL that is folded when parsed */
+
+#define MEMOSIZE 4096
+ /* number of results kept by MEMO, a power of 2 */
+
+#define PARMINITEMS 100000
+ /* least tally of an array whose items are computed on several threads */
+
+#define PARMAXTHREADS 256
+ /* most threads used to compute the items of an array */
+
+#define PEACHBUFSIZE 65536
+ /* bytes buffered when PEACH sends results from a worker process */
+
+#define RADIXMINITEMS 1000
+ /* least tally of a homogeneous array that SORT and GRADE radix sort */
+
 #define dfmemsize  32000000    /* default workspace size in units */
 
 #define minmemsize (dfatomtblsize * 4 + 20000)
 
+/* bytes of virtual address space reserved for the heap when RESERVEDHEAP
+   is set. Only the part in use is committed. */
+#ifdef INTS64
+#define HEAPRESERVESIZE ((size_t)1 << 38)
+#else
+#define HEAPRESERVESIZE ((size_t)1 << 30)
+#endif
+
+#define HUGEPAGEHEAPSIZE ((size_t)1 << 28)
+ /* heap size in bytes at which transparent huge pages are requested */
+
 
 #define MAXPGMLINE 70
  /* maximum length of token or of descaned output line */
@@ -40,8 +81,40 @@
  /* upper limit on the number of basic names , 
     increase if applytab overflows in basics.c */
 
-#define NOINTS 64
- /* number of small ints retained uniquely */
+#define NOINTS 1024
+#define LOWINT (-128)
+ /* number of small ints retained uniquely and the smallest of them. The
+    ints from LOWINT to LOWINT + NOINTS - 1 are created once by sysinit. */
+
+#define FREEWORKSIZE 1000
+ /* initial number of entries in the work list used by freeit */
+
+#define FREEBATCHSIZE 10000
+ /* number of items released at a time when set "deferfree is in effect */
+
+#define ATOMSLABSIZE 4096
+ /* number of released atom sized blocks kept for reuse when ATOMSLAB
+    is set */
+
+#define LISTROOM 4
+ /* spare items, beyond half the new tally, left in a list that append or
+    hitch has to move while updating a variable in place */
+
+#define VMCODESIZE 256
+ /* initial size of the buffers used to build bytecode */
+
+#define VMMAXLOOPS 16
+ /* depth of for loops compiled into one piece of bytecode. Deeper
+    loops are left to the tree walker */
+
+#define SMALLBLOCKLIMIT 64
+ /* largest block size in words kept in an exact size class free list when
+  * SIZECLASSES is set. Larger free blocks are kept in a best fit tree. It
+  * must not exceed minsize + 63 so that the classes fit in one bit map. */
+
+#define COMPACTFREEPERCENT 50
+ /* when HEAPCOMPACTION is set the heap is compacted automatically if it
+  * has been expanded and more than this percentage of it is free */
 
 
 #define INBUFSIZE 500        /* size requested from Cstack area for input,
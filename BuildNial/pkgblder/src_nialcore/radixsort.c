@@ -0,0 +1,625 @@
+/*==============================================================
+
+  MODULE   RADIXSORT.C
+
+  COPYRIGHT NIAL Systems Limited  1983-2016
+
+
+  Radix sorting of homogeneous arrays and parallel merge sorting
+  for SORT and GRADE.
+
+================================================================*/
+
+/* SORT and GRADE with the comparators up, <= and >= are done by sort in
+   trs.c. For a large homogeneous array it calls radixsort, which orders
+   the items by an LSD radix sort of 64 bit keys. The key of an item
+   orders as up and <= do: an integer has its sign bit flipped, a real
+   has its bits flipped when negative and its sign bit set otherwise
+   with -0. made 0., and a character is its place in the collating
+   sequence invseq. For >= each key is complemented. Each pass
+   distributes the keys stably on one byte, and a byte that is the same
+   in every key is skipped, so small integers and characters take one
+   or two passes. The keys are counted and moved in parts on several
+   threads, each part moving its items in order, so the sort is stable
+   and items that are equal keep their order as in the merge sort.
+
+   Integers and reals are sorted as their keys and recovered from them.
+   For a grade, and for characters, truth-values and reals with a -0.,
+   the index of each item is moved with its key and the result is taken
+   from the indices. A real array with a NaN is left to sort, since a
+   NaN is not ordered.
+
+   The primitive gradekeys grades the rows of a table given as a list
+   of columns by radix sorting the indices on each column in turn.
+
+   For a large array of atoms or homogeneous arrays and the comparator
+   up, mergesort_up sorts the parts of the array on several threads by
+   a stable merge sort on indices and merges the parts in rounds. up
+   makes no array for such items, so it can be called on the threads.
+*/
+
+#include "switches.h"
+
+/* standard library header files */
+
+/* IOLIB */
+#include <stdio.h>
+
+/* STLIB */
+#include <stdlib.h>
+#include <string.h>
+
+/* MATHLIB */
+#include <math.h>
+
+/* SJLIB */
+#include <setjmp.h>
+
+/* Q'Nial header files */
+
+#include "radixsort.h"
+#include "qniallim.h"
+#include "absmach.h"
+#include "basics.h"
+#include "lib_main.h"
+
+#include "compare.h"         /* for up */
+#include "ops.h"             /* for homotest, implode, splitfb */
+#include "parallel.h"        /* for par_for */
+
+
+typedef unsigned long long radixkey;
+
+#define RADIXSIGN ((radixkey) 1 << 63)
+#define RADIXBINS 256
+
+/* the state of a radix sort */
+
+typedef struct {
+  nialptr     x;
+  int         kind,
+              descending,
+              nanlast,       /* a NaN is greater than every number */
+              shift,
+              nan;
+  nialint     chunk,
+             *from;          /* indices of the items to key or NULL */
+  radixkey   *k,             /* keys */
+             *kt;
+  nialint    *p,             /* indices moved with the keys or NULL */
+             *pt,
+             *count;         /* RADIXBINS counts for each part */
+  radixkey    orkeys[PARMAXTHREADS],
+              andkeys[PARMAXTHREADS];
+} radixstate;
+
+/* routine to give the key of a real or to report a NaN */
+
+static      radixkey
+realkey(double r, int nanlast, int *nan)
+{
+  radixkey    bits;
+
+  if (r != r) {
+    *nan = true;
+    return (nanlast ? ~(radixkey) 0 : 0);
+  }
+  if (r == 0.)
+    r = 0.;                  /* -0. and 0. are equal */
+  memcpy(&bits, &r, sizeof bits);
+  return ((bits & RADIXSIGN) ? ~bits : bits | RADIXSIGN);
+}
+
+/* loop body to make the keys and indices of a part and the bytes in
+   which they differ. The key of place i is that of item from[i] if
+   there are indices to key. */
+
+static int
+radixkeys(nialint lo, nialint hi, void *arg)
+{
+  radixstate *s = arg;
+  nialint     i,
+              part = lo / s->chunk;
+  radixkey    orkey = 0,
+              andkey = ~(radixkey) 0,
+              flip = (s->descending ? ~(radixkey) 0 : 0);
+  int         nan = false;
+
+  for (i = lo; i < hi; i++) {
+    nialint     j = (s->from != NULL ? s->from[i] : i);
+    radixkey    key = 0;
+
+    switch (s->kind) {
+      case inttype:
+          key = ((radixkey) (long long) fetch_int(s->x, j)) ^ RADIXSIGN;
+          break;
+      case realtype:
+          key = realkey(fetch_real(s->x, j), s->nanlast, &nan);
+          break;
+      case chartype:
+          key = invseq[fetch_char(s->x, j) - LOWCHAR];
+          break;
+      case booltype:
+          key = fetch_bool(s->x, j);
+          break;
+    }
+    key ^= flip;
+    s->k[i] = key;
+    if (s->p != NULL)
+      s->p[i] = j;
+    orkey |= key;
+    andkey &= key;
+  }
+  s->orkeys[part] = orkey;
+  s->andkeys[part] = andkey;
+  if (nan)
+    s->nan = true;
+  return true;
+}
+
+/* loop bodies to count the keys of a part by the current byte and to
+   move them to their places */
+
+static int
+radixcount(nialint lo, nialint hi, void *arg)
+{
+  radixstate *s = arg;
+  nialint    *count = s->count + (lo / s->chunk) * RADIXBINS,
+              i;
+
+  for (i = 0; i < RADIXBINS; i++)
+    count[i] = 0;
+  for (i = lo; i < hi; i++)
+    count[(s->k[i] >> s->shift) & (RADIXBINS - 1)]++;
+  return true;
+}
+
+static int
+radixmove(nialint lo, nialint hi, void *arg)
+{
+  radixstate *s = arg;
+  nialint    *place = s->count + (lo / s->chunk) * RADIXBINS,
+              i;
+
+  for (i = lo; i < hi; i++) {
+    radixkey    key = s->k[i];
+    nialint     j = place[(key >> s->shift) & (RADIXBINS - 1)]++;
+
+    s->kt[j] = key;
+    if (s->p != NULL)
+      s->pt[j] = s->p[i];
+  }
+  return true;
+}
+
+/* routine to give the bits in which the keys made by radixkeys differ */
+
+static      radixkey
+radixdiffer(radixstate * s, int parts)
+{
+  radixkey    orkey = 0,
+              andkey = ~(radixkey) 0;
+  int         part;
+
+  for (part = 0; part < parts; part++) {
+    orkey |= s->orkeys[part];
+    andkey &= s->andkeys[part];
+  }
+  return (orkey ^ andkey);
+}
+
+/* routine to sort the keys, and the indices if there are any, leaving
+   them in s->k and s->p */
+
+static void
+radixpasses(radixstate * s, nialint n, int parts, radixkey differ)
+{
+  int         byte,
+              part,
+              bin;
+
+  for (byte = 0; byte < 8; byte++) {
+    nialint     sum = 0;
+
+    s->shift = 8 * byte;
+    if (((differ >> s->shift) & (RADIXBINS - 1)) == 0)
+      continue;              /* all keys have this byte */
+    par_for(n, radixcount, s);
+
+    /* turn the counts into the place of the first key of each bin in
+       each part */
+    for (bin = 0; bin < RADIXBINS; bin++)
+      for (part = 0; part < parts; part++) {
+        nialint     c = s->count[part * RADIXBINS + bin];
+
+        s->count[part * RADIXBINS + bin] = sum;
+        sum += c;
+      }
+    par_for(n, radixmove, s);
+
+    {
+      radixkey   *kt = s->k;
+      nialint    *pt = s->p;
+
+      s->k = s->kt;
+      s->kt = kt;
+      s->p = s->pt;
+      s->pt = pt;
+    }
+  }
+}
+
+/* routine to test whether a real array has a -0. */
+
+static int
+hasminuszero(double *x, nialint n)
+{
+  nialint     i;
+
+  for (i = 0; i < n; i++)
+    if (x[i] == 0. && signbit(x[i]))
+      return true;
+  return false;
+}
+
+/* routine to compute SORT or GRADE with <= or >= of a homogeneous array
+   x of at least RADIXMINITEMS items. The result of a sort is the sorted
+   array and that of a grade is the list of indices that sorts the list
+   of the items. The result is invalidptr if it is not done here. */
+
+nialptr
+radixsort(nialptr x, int descending, int gradesw)
+{
+  radixstate  s;
+  nialint     n = tally(x),
+              i;
+  int         parts = par_parts(n),
+              v = valence(x),
+              kx = kind(x),
+              withindex;
+  void       *work;
+  nialptr     z;
+
+  if (kx != inttype && kx != realtype && kx != chartype && kx != booltype)
+    return invalidptr;
+  withindex = gradesw || kx == chartype || kx == booltype ||
+    (kx == realtype && hasminuszero(pfirstreal(x), n));
+
+  /* the keys and indices and a second copy to move them to */
+  work = malloc(n * (withindex ? 2 * sizeof(radixkey) + 2 * sizeof(nialint)
+                    : 2 * sizeof(radixkey)) +
+               parts * RADIXBINS * sizeof(nialint));
+  if (work == NULL)
+    return invalidptr;
+  s.x = x;
+  s.kind = kx;
+  s.descending = descending;
+  s.nanlast = false;
+  s.nan = false;
+  s.from = NULL;
+  s.chunk = PARCHUNK(n, parts);
+  s.k = work;
+  s.kt = s.k + n;
+  s.count = (nialint *) (s.kt + n);
+  s.p = s.pt = NULL;
+  if (withindex) {
+    s.p = s.count + parts * RADIXBINS;
+    s.pt = s.p + n;
+  }
+
+  par_for(n, radixkeys, &s);
+  if (s.nan) {
+    free(work);
+    return invalidptr;
+  }
+  radixpasses(&s, n, parts, radixdiffer(&s, parts));
+
+  /* make the result */
+  if (gradesw) {
+    z = new_create_array(inttype, 1, 0, &n);
+    memcpy(pfirstint(z), s.p, n * sizeof(nialint));
+  }
+  else {
+    z = new_create_array(kx, v, 0, shpptr(x, v));
+    if (withindex) {
+      for (i = 0; i < n; i++)
+        copy1(z, i, x, s.p[i]);
+    }
+    else if (kx == inttype) {
+      nialint    *pz = pfirstint(z);  /* safe: no allocation */
+
+      for (i = 0; i < n; i++) {
+        radixkey    key = s.k[i] ^ (descending ? ~(radixkey) 0 : 0);
+
+        pz[i] = (nialint) (long long) (key ^ RADIXSIGN);
+      }
+    }
+    else {                   /* realtype */
+      double     *pz = pfirstreal(z); /* safe: no allocation */
+
+      for (i = 0; i < n; i++) {
+        radixkey    key = s.k[i] ^ (descending ? ~(radixkey) 0 : 0),
+                    bits = ((key & RADIXSIGN) ? key & ~RADIXSIGN : ~key);
+
+        memcpy(&pz[i], &bits, sizeof bits);
+      }
+    }
+  }
+  free(work);
+  return (z);
+}
+
+/* routine to give column c of the columns x of gradekeys. A list of
+   numbers, characters or truth-values is a single column. */
+
+static      nialptr
+gradecolumn(nialptr x, nialint c)
+{
+  return (kind(x) == atype ? fetch_array(x, c) : x);
+}
+
+/* routine to implement the primitive gradekeys. Columns gradekeys
+   Directions gives the grade of the rows of a table held as a list of
+   columns, which are lists of numbers, characters or truth-values of
+   the same length. The rows are ordered by the first column, rows that
+   are equal in it by the second, and so on, with each column in
+   ascending order (as by <=) if its direction is l and descending order
+   (as by >=) if it is o. A single truth-value gives the direction of
+   every column. Rows that are equal in every column keep their order.
+   A NaN is ordered after every number.
+
+   The columns are sorted from the last to the first by radix sorts of
+   the indices, each column keyed in the order left by the sort of the
+   columns after it. Since each sort is stable, the result is the grade
+   of the rows. */
+
+void
+igradekeys(void)
+{
+  radixstate  s;
+  nialptr     a = apop(),
+              x,
+              d,
+              z;
+  nialint     ncols,
+              n = 0,
+              c;
+  int         parts;
+  void       *work;
+
+  if (kind(a) != atype || tally(a) != 2) {
+    apush(makefault("?gradekeys expects columns and directions"));
+    freeup(a);
+    return;
+  }
+  splitfb(a, &x, &d);
+
+  /* check the columns and the directions */
+  ncols = (kind(x) == atype ? tally(x) : 1);
+  for (c = 0; c < ncols; c++) {
+    nialptr     col = gradecolumn(x, c);
+    int         k = kind(col);
+
+    if (valence(col) != 1 || (c > 0 && tally(col) != n) ||
+        (tally(col) > 0 && k != inttype && k != realtype && k != chartype &&
+         k != booltype)) {
+      ncols = 0;
+      break;
+    }
+    n = tally(col);
+  }
+  if (valence(x) != 1 || ncols == 0) {
+    apush(makefault("?gradekeys columns must be lists of numbers, characters or truth-values of equal length"));
+    freeup(a);
+    return;
+  }
+  if (kind(d) != booltype || (tally(d) != 1 && tally(d) != ncols) ||
+      valence(d) > 1) {
+    apush(makefault("?gradekeys directions must be truth-values"));
+    freeup(a);
+    return;
+  }
+
+  z = new_create_array(inttype, 1, 0, &n);
+  if (n == 0) {
+    apush(z);
+    freeup(a);
+    return;
+  }
+
+  parts = par_parts(n);
+  work = malloc(n * (2 * sizeof(radixkey) + 2 * sizeof(nialint)) +
+                parts * RADIXBINS * sizeof(nialint));
+  if (work == NULL) {
+    freeup(z);
+    apush(makefault("?gradekeys cannot get work space"));
+    freeup(a);
+    return;
+  }
+  s.nanlast = true;
+  s.chunk = PARCHUNK(n, parts);
+  s.k = work;
+  s.kt = s.k + n;
+  s.count = (nialint *) (s.kt + n);
+  s.p = s.count + parts * RADIXBINS;
+  s.pt = s.p + n;
+  s.from = NULL;             /* the last column is keyed in row order */
+
+  for (c = ncols - 1; c >= 0; c--) {
+    s.x = gradecolumn(x, c);
+    s.kind = kind(s.x);
+    s.descending = !fetch_bool(d, tally(d) == 1 ? 0 : c);
+    s.nan = false;
+    par_for(n, radixkeys, &s);
+    radixpasses(&s, n, parts, radixdiffer(&s, parts));
+    s.from = s.p;            /* radixkeys may replace each index in place */
+  }
+
+  memcpy(pfirstint(z), s.p, n * sizeof(nialint));  /* safe: no allocation */
+  free(work);
+  apush(z);
+  freeup(a);
+}
+
+
+/* the state of a parallel merge sort */
+
+typedef struct {
+  nialptr    *x;             /* the items */
+  nialint     n,
+              width;         /* length of the sorted runs */
+  nialint    *p,             /* indices */
+             *pt;
+} mergestate;
+
+/* routine to merge the sorted runs of indices p[lo..mid-1] and
+   p[mid..hi-1] into pt[lo..hi-1], taking from the first run when its
+   item is up from the other so that the merge is stable */
+
+static void
+mergeruns(nialptr * x, nialint * p, nialint * pt, nialint lo, nialint mid, nialint hi)
+{
+  nialint     i = lo,
+              j = mid,
+              k = lo;
+
+  while (i < mid && j < hi) {
+    if (up(x[p[i]], x[p[j]]))
+      pt[k++] = p[i++];
+    else
+      pt[k++] = p[j++];
+  }
+  while (i < mid)
+    pt[k++] = p[i++];
+  while (j < hi)
+    pt[k++] = p[j++];
+}
+
+/* loop body to sort the indices of a part by merging runs of
+   increasing length. The part is left sorted in p. */
+
+static int
+mergepart(nialint lo, nialint hi, void *arg)
+{
+  mergestate *s = arg;
+  nialint     first = lo * s->width,
+              last = (hi * s->width < s->n ? hi * s->width : s->n),
+              w,
+              i;
+  nialint    *p = s->p,
+             *pt = s->pt;
+
+  for (i = first; i < last; i++)
+    p[i] = i;
+  for (w = 1; w < last - first; w *= 2) {
+    nialint    *t;
+
+    for (i = first; i < last; i += 2 * w) {
+      nialint     mid = (i + w < last ? i + w : last),
+                  end = (i + 2 * w < last ? i + 2 * w : last);
+
+      mergeruns(s->x, p, pt, i, mid, end);
+    }
+    t = p;
+    p = pt;
+    pt = t;
+  }
+  if (p != s->p)
+    memcpy(s->p + first, p + first, (last - first) * sizeof(nialint));
+  return true;
+}
+
+/* loop body to merge pairs of sorted runs of width indices from p to
+   pt. A unit is a pair of runs. */
+
+static int
+mergepairs(nialint lo, nialint hi, void *arg)
+{
+  mergestate *s = arg;
+  nialint     u;
+
+  for (u = lo; u < hi; u++) {
+    nialint     i = u * 2 * s->width,
+                mid = (i + s->width < s->n ? i + s->width : s->n),
+                end = (i + 2 * s->width < s->n ? i + 2 * s->width : s->n);
+
+    mergeruns(s->x, s->p, s->pt, i, mid, end);
+  }
+  return true;
+}
+
+/* routine to test whether up can be applied to an item on a thread */
+
+static int
+mergeable(nialptr it)
+{
+  int         k = kind(it);
+  nialint     i;
+
+  if (k == atype)
+    return (false);
+  if (k == realtype)         /* a NaN is not ordered */
+    for (i = 0; i < tally(it); i++)
+      if (fetch_real(it, i) != fetch_real(it, i))
+        return (false);
+  return (true);
+}
+
+/* routine to compute SORT up or GRADE up of an array x of kind atype by
+   a merge sort on several threads. The results are as for radixsort.
+   The result is invalidptr if it is not done here. */
+
+nialptr
+mergesort_up(nialptr x, int gradesw)
+{
+  mergestate  s;
+  nialint     n = tally(x),
+              i,
+              chunk,
+              parts = par_parts(n);
+  int         v = valence(x);
+  nialptr     z;
+  nialint    *work;
+
+  if (parts <= 1)
+    return invalidptr;
+  for (i = 0; i < n; i++)
+    if (!mergeable(fetch_array(x, i)))
+      return invalidptr;
+  work = malloc(2 * n * sizeof(nialint));
+  if (work == NULL)
+    return invalidptr;
+  s.x = pfirstitem(x);       /* safe: no allocation until the result */
+  s.n = n;
+  s.p = work;
+  s.pt = work + n;
+
+  /* sort the parts */
+  chunk = PARCHUNK(n, parts);
+  s.width = chunk;
+  par_forunits(n, chunk, mergepart, &s);
+
+  /* merge the parts in rounds */
+  for (s.width = chunk; s.width < n; s.width *= 2) {
+    nialint    *t;
+
+    par_forunits(n, 2 * s.width, mergepairs, &s);
+    t = s.p;
+    s.p = s.pt;
+    s.pt = t;
+  }
+
+  if (gradesw) {
+    z = new_create_array(inttype, 1, 0, &n);
+    memcpy(pfirstint(z), s.p, n * sizeof(nialint));
+  }
+  else {
+    z = new_create_array(atype, v, 0, shpptr(x, v));
+    for (i = 0; i < n; i++)
+      store_array(z, i, fetch_array(x, s.p[i]));
+    if (homotest(z))
+      z = implode(z);
+  }
+  free(work);
+  return (z);
+}
@@ -457,7 +457,7 @@ mktoken(char *tknstring, int state)
           print_value = makephrase(temp);
 
           /* look for reserved word in system symtab */
-          entr = Blookup(get_root(global_symtab), print_value);
+          entr = symfind(global_symtab, print_value);
 
           if (entr != notfound && sym_role(entr) == Rres) /* found reserved word */
             addtkn(createint(delimprop));
@@ -989,6 +989,12 @@ deparse(nialptr br)
   /* select deparse code based on the tag of the parse tree node */
   switch (tag(br)) {
     case t_constant:
+#ifdef FOLDING
+        if (tally(br) == 4) { /* a folded call is shown as it was written */
+          deparse(fetch_array(br, 3));
+          break;
+        }
+#endif
         { /* pick up constant type from its value and set st */
           int         st = 0;
           nialptr     v = get_c_val(br);
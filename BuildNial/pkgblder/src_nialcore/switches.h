@@ -55,6 +55,63 @@ the code of Q'Nial is processed.
 #define FREEUPMACRO
 #define STACKMACROS
 
+/* use exact size class free lists for small blocks and a best fit tree
+   for large ones in place of the single first fit free list */
+
+#define SIZECLASSES
+
+/* allow the heap to be compacted at the top level. Needs SIZECLASSES. */
+#ifdef SIZECLASSES
+#define HEAPCOMPACTION
+#endif
+
+/* keep released atom sized blocks in a slab for reuse. Needs SIZECLASSES. */
+#ifdef SIZECLASSES
+#define ATOMSLAB
+#endif
+
+/* run operation bodies and loops as bytecode when not debugging */
+
+#define BYTECODE
+
+/* apply calls in tail position of an operation form without nesting */
+
+#define TAILCALLS
+
+/* evaluate chains of arithmetic on arrays in one loop without temporaries */
+
+#define FUSION
+
+/* evaluate calls of pure primitives on constants when they are parsed */
+
+#define FOLDING
+
+/* run FOR loops over tell N or count N without making the list */
+
+#define FORRANGES
+
+/* do ACCUMULATE of the associative primitives on numbers in C loops */
+
+#define NATIVESCAN
+
+/* compute the items of large real and integer arrays on several threads */
+
+#ifdef UNIXSYS
+#define PARALLEL
+#endif
+
+/* let PEACH apply an operation to the items of an array in child processes */
+
+#ifdef UNIXSYS
+#define PROCESSEACH
+#endif
+
+/* reserve address space for the heap so that expanding it never moves it */
+
+#ifdef UNIXSYS
+#define RESERVEDHEAP
+#endif
+
 /* they should always be undefined if a DEBUG build is being made */
 
 #ifdef DEBUG
@@ -62,6 +119,7 @@ the code of Q'Nial is processed.
 #undef STOREARRAYMACRO
 #undef FREEUPMACRO
 #undef STACKMACROS
+#undef ATOMSLAB
 #endif
 
 /* the following includes set up types and constants appropriate for 32 or 64 bits systems */
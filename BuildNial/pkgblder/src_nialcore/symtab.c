@@ -57,6 +57,8 @@ static void eraseSymtabEntry(nialptr entr);
 static nialptr create_entry(void);
 static int  checkentry(nialptr entr);
 static void Olookup(nialptr entr, int sysnames);
+static nialint namehash(nialptr name);
+static void hashenter(nialptr sym, nialptr entr, nialptr name);
 
 static nialint defcnt;
 
@@ -127,7 +129,7 @@ static nialint defcnt;
  is system or user defined.
 
 
- A symbol table has four fields
+ A symbol table has six fields
      - the root of the binary tree (set to grounded on creation)
      - a pointer to the current activation record in the stack
        for local environments (set to -1 on creation)
@@ -137,6 +139,21 @@ static nialint defcnt;
      - a name indicating the owner of the table. It is either "GLOBAL"
        or the name of the definition holding the symbol table. An opform
        or block that is not named has name ANONYMOUS.
+     - a hash table of its entries, or Null if the entries are kept
+       in the binary tree
+     - the number of entries in the hash table
+
+ The global symbol table holds every system name and every user
+ definition, so it is kept in a hash table rather than a binary tree
+ whose shape depends on the order of loading. The table is an array of
+ entries, grounded where empty, searched by linear probing. Its size is
+ a power of 2 and it is doubled when it becomes half full. Since names
+ are phrases with a unique representation a probe compares the name
+ with the entry name as array references. The hash is taken from the
+ characters of the name rather than the reference so that the table is
+ still valid after the heap is compacted or a workspace is loaded.
+ Entries are never removed, erase only resets their value. The local
+ symbol tables are small and keep the binary tree.
 */
 
 /* routine to create a symbol table */
@@ -144,8 +161,26 @@ static nialint defcnt;
 nialptr
 addsymtab(int prop, char * stname)
 {
-  return (mkaquad(grounded, createint(-1), createint((nialint) prop), 
-     makephrase(stname)));
+  nialptr     sym,
+              tbl = Null;
+  nialint     i,
+              six = 6;
+
+  if (prop == stpglobal) {
+    nialint     sz = dfsymtblsize;
+
+    tbl = new_create_array(atype, 1, 0, &sz);
+    for (i = 0; i < sz; i++)
+      store_array(tbl, i, grounded);
+  }
+  sym = new_create_array(atype, 1, 0, &six);
+  store_array(sym, 0, grounded);
+  store_array(sym, 1, createint(-1));
+  store_array(sym, 2, createint((nialint) prop));
+  store_array(sym, 3, makephrase(stname));
+  store_array(sym, 4, tbl);
+  store_array(sym, 5, createint(0));
+  return (sym);
 }
 
 /* routine to create a symbol table entry */
@@ -155,6 +190,11 @@ mkSymtabEntry(nialptr sym, nialptr name, nialptr role, nialptr value, int sysfla
 {
   nialptr     entr;
 
+  if (get_hashtbl(sym) != Null) {  /* add new entry to the hash table */
+    entr = create_entry();
+    hashenter(sym, entr, name);
+  }
+  else
   if (get_root(sym) == grounded) {  /* add new entry at the root */
     entr = create_entry();
     store_root(sym, entr);
@@ -293,6 +333,64 @@ enter_binary(nialptr entr, nialptr name)
     return (enter_binary(sym_rght(entr), name));
 }
 
+/* the hash function for the names in a symbol table (FNV-1a) */
+
+static      nialint
+namehash(nialptr name)
+{
+  unsigned    z = 2166136261u;
+  unsigned char *p;
+
+  for (p = (unsigned char *) pfirstchar(name); *p != '\0'; p++) {
+    z ^= *p;
+    z *= 16777619u;
+  }
+  return ((nialint) z);
+}
+
+/* internal routine to place a new entry in the hash table of a symbol
+   table, doubling the table first if it would become half full */
+
+static void
+hashenter(nialptr sym, nialptr entr, nialptr name)
+{
+  nialptr     tbl = get_hashtbl(sym);
+  nialint     cnt = get_hashcnt(sym) + 1,
+              sz = tally(tbl),
+              mask,
+              posn;
+
+  if (2 * cnt > sz) {
+    nialptr     newtbl;
+    nialint     i,
+                newsz = 2 * sz;
+
+    newtbl = new_create_array(atype, 1, 0, &newsz);
+    for (i = 0; i < newsz; i++)
+      store_array(newtbl, i, grounded);
+    tbl = get_hashtbl(sym);  /* the heap may have moved */
+    for (i = 0; i < sz; i++) {
+      nialptr     e = fetch_array(tbl, i);
+
+      if (e != grounded) {
+        posn = namehash(sym_name(e)) & (newsz - 1);
+        while (fetch_array(newtbl, posn) != grounded)
+          posn = (posn + 1) & (newsz - 1);
+        replace_array(newtbl, posn, e);
+      }
+    }
+    store_hashtbl(sym, newtbl); /* frees the old table */
+    tbl = newtbl;
+    sz = newsz;
+  }
+  mask = sz - 1;
+  posn = namehash(name) & mask;
+  while (fetch_array(tbl, posn) != grounded)
+    posn = (posn + 1) & mask;
+  replace_array(tbl, posn, entr);
+  store_hashcnt(sym, cnt);
+}
+
 /* routine to create a symbol table entry. All its fields are
    set to grounded. */
 
@@ -332,6 +430,29 @@ Blookup(nialptr entr, nialptr name)
     return (Blookup(sym_rght(entr), name)); /* search on the right */
 }
 
+/* routine to find a name in a symbol table, using its hash table if it
+   has one and the binary tree otherwise */
+
+nialptr
+symfind(nialptr sym, nialptr name)
+{
+  nialptr     tbl = get_hashtbl(sym),
+              entr;
+  nialint     mask,
+              posn;
+
+  if (tbl == Null)
+    return (Blookup(get_root(sym), name));
+  mask = tally(tbl) - 1;
+  posn = namehash(name) & mask;
+  while ((entr = fetch_array(tbl, posn)) != grounded) {
+    if (sym_name(entr) == name)
+      return (entr);
+    posn = (posn + 1) & mask;
+  }
+  return (notfound);
+}
+
 /*  lookup routine: general symbol table lookup routine.
     This routine is primarily designed to meet the needs of
     scope handling for the parser. It implies much of the semantics
@@ -402,7 +523,7 @@ lookup(nialptr name, nialptr * sym, int searchtype)
       }
 
       if (!found) { /* not in the local list, search the tree */
-        entr = Blookup(get_root(*sym), name);
+        entr = symfind(*sym, name);
         if (entr != notfound || searchtype == statics ||
             (searchtype == active && prop == stpclosed))
           return (entr);
@@ -416,14 +537,14 @@ lookup(nialptr name, nialptr * sym, int searchtype)
       /* loop over the environments */
       while (entr == notfound && i < tce) {
         *sym = fetch_array(current_env, i);
-        entr = Blookup(get_root(*sym), name);
+        entr = symfind(*sym, name);
         i++;
       }
     }
   }
   if (entr == notfound) {    /* look in the global symbol table */
     *sym = global_symtab;
-    entr = Blookup(get_root(*sym), name);
+    entr = symfind(*sym, name);
   }
   return (entr);
 }
@@ -445,9 +566,14 @@ isymbols()
   }
   else {
     int         sysnames = intval(x) == 1;
+    nialptr     tbl = get_hashtbl(global_symtab);
+    nialint     i;
 
+    /* the global entries are in the hash table and are not linked to
+       each other, so Olookup visits just the one */
     defcnt = 0;
-    Olookup(get_root(global_symtab), sysnames);
+    for (i = 0; i < tally(tbl); i++)
+      Olookup(fetch_array(tbl, i), sysnames);
     if (defcnt != 0)
       mklist(defcnt);
     else
@@ -65,6 +65,9 @@
 
 static int  allwhitespace(char *x);
 
+static int  loadinexpr = false;  /* set while a loaddefs called from an
+                                    expression is running */
+
 
 /* this set of routines manages workspace saving and loading.
    It uses the binary read and write routines of the host
@@ -84,11 +87,20 @@ wsdump(FILE * f1)
 {
   nialptr     startaddr,
               addr,
-              highest,
-              next;
+              highest;
+#ifndef SIZECLASSES
+  nialptr     next;
+#endif
   nialint     cnt;
 
+  settle_heap();             /* finish pending releases before writing */
+
   /* find the address of the highest free block */
+#ifdef SIZECLASSES
+  /* only a free block at the end of memory matters. Its trailer
+     identifies it. */
+  highest = (isprevfree(memsize) ? prevblk(memsize) : freelisthdr);
+#else
   highest = freelisthdr,
   next = freelisthdr;
   while (next != TERMINATOR) {
@@ -96,6 +108,7 @@ wsdump(FILE * f1)
       highest = next;
     next = fwdlink(next);
   }
+#endif
 
   /* store global giving workspace size */
   if (highest + blksize(highest) == memsize)
@@ -172,11 +185,14 @@ void
 wsload(FILE * f1)
 {
   nialptr     addr,
-              cnt,
-              lastfree,
               nextaddr;
+#ifndef SIZECLASSES
+  nialptr     lastfree;
+#endif
+  nialint     cnt;           /* written by wsdump as a nialint */
 
 
+  settle_heap();             /* the old heap is about to be replaced */
 
   /* read global structure */
   testrderr(readblock(f1, (char *) &G, sizeof G, false, 0L, 0));
@@ -193,12 +209,17 @@ wsload(FILE * f1)
     }
   }
 
+#ifdef SIZECLASSES
+  /* the free space is rebuilt from the gaps between the blocks read */
+  clear_freelists();
+#else
   /* set the link to the first free block */
   fwdlink(freelisthdr) = firstfree;
+  lastfree = freelisthdr;
+#endif
 
   /* read memory blocks */
 
-  lastfree = freelisthdr;
   nextaddr = membase;
 
   testrderr(readblock(f1, (char *) &cnt, sizeof cnt, false, 0L, 0));
@@ -217,6 +238,9 @@ wsload(FILE * f1)
     if (cnt != 0) {          /* still blocks to read */
       testrderr(readblock(f1, (char *) &addr, sizeof addr, false, 0L, 0));
 
+#ifdef SIZECLASSES
+      link_free_block(nextaddr, addr - nextaddr);
+#else
       /* set up free block between used blocks */
       fwdlink(lastfree) = nextaddr;
       blksize(nextaddr) = addr - nextaddr;
@@ -227,9 +251,14 @@ wsload(FILE * f1)
       set_freetag(nextaddr); /* sets free tag */
       set_endinfo(nextaddr);
       lastfree = nextaddr;
+#endif
     }
   }
 
+#ifdef SIZECLASSES
+  if (nextaddr < memsize)    /* add in last free block */
+    link_free_block(nextaddr, memsize - nextaddr);
+#else
   if (nextaddr < memsize) {  /* add in last free block */
     fwdlink(lastfree) = nextaddr;
     blksize(nextaddr) = memsize - nextaddr;
@@ -243,11 +272,14 @@ wsload(FILE * f1)
   }
   else
     fwdlink(lastfree) = TERMINATOR; /* to complete the chain */
+#endif
 
 /* reset atomtbl stuff */
 atomtblsize = tally(atomtblbase);
 atomtbl = pfirstitem(atomtblbase);
 
+  reset_heapstats();         /* the loaded blocks were not counted */
+
 #ifdef DEBUG
   memchk();
 #endif
@@ -374,7 +406,9 @@ iloaddefs(void)
 {
   nialptr     nm,
               x = apop();
-  int         mode;
+  int         mode,
+              loaded,
+              oldinexpr;
 
   /* get the file name as a Nial array */
   if (atomic(x) || kind(x) == chartype)
@@ -409,7 +443,11 @@ iloaddefs(void)
     check_ext(gcharbuf, ".ndf",NOFORCE_EXTENSION);
     freeup(x);      /* do freeup here so file name doesn't show in iusedspace */
     /* load the definition file */
-    if (loaddefs(true, gcharbuf, mode)) {
+    oldinexpr = loadinexpr;
+    loadinexpr = true;
+    loaded = loaddefs(true, gcharbuf, mode);
+    loadinexpr = oldinexpr;
+    if (loaded) {
       apush(Nullexpr);
     }
     else
@@ -590,6 +628,12 @@ loaddefs(int fromfile, char *fname, int mode)
         freeup(apop());
       exit_cover1("Stack has grown during loaddefs", NC_FATAL);
     }
+#ifdef HEAPCOMPACTION
+    /* between actions of a loaddefs started from the top level the
+       only arrays held are on the stack */
+    if (!loadinexpr)
+      heap_safepoint();
+#endif
   } 
 
   /* done reading groups of lines */